@@ -110,6 +110,61 @@ if not success:
     fi
 }
 
+# 导出固定输入尺寸的YOLOv11n模型，尺寸列表取自环境变量MODEL_SIZES(如"320 416 512")
+export_fixed_sizes() {
+    if [ -z "$MODEL_SIZES" ]; then
+        return 0
+    fi
+
+    local pending=()
+    for size in $MODEL_SIZES; do
+        if [ ! -f "models/yolov11n-${size}.onnx" ]; then
+            pending+=("$size")
+        fi
+    done
+    if [ ${#pending[@]} -eq 0 ]; then
+        echo -e "${GREEN}固定尺寸模型已存在，跳过导出${NC}"
+        return 0
+    fi
+
+    if [ ! -f "models/yolov11n.pt" ]; then
+        if ! download_model \
+            "https://github.com/ultralytics/assets/releases/download/v8.3.0/yolo11n.pt" \
+            "models/yolov11n.pt"; then
+            echo -e "${RED}错误: YOLOv11n PT模型下载失败${NC}"
+            return 1
+        fi
+    fi
+
+    if [ ! -f "venv/bin/activate" ]; then
+        echo -e "${RED}错误: 未找到Python虚拟环境，请删除models/yolov11n.onnx后重新运行以完成安装${NC}"
+        return 1
+    fi
+    source venv/bin/activate
+    for size in "${pending[@]}"; do
+        echo "正在导出${size}x${size}模型..."
+        # 以带尺寸的文件名复制权重，导出结果与之同名，不覆盖输入尺寸可变的主模型
+        cp models/yolov11n.pt "models/yolov11n-${size}.pt"
+        python3 -c "
+from ultralytics import YOLO
+model = YOLO('models/yolov11n-${size}.pt')
+if not model.export(format='onnx', imgsz=${size}, dynamic=False, simplify=False, opset=11):
+    raise RuntimeError('Model export failed')
+"
+        rm -f "models/yolov11n-${size}.pt"
+        if [ ! -f "models/yolov11n-${size}.onnx" ]; then
+            echo -e "${RED}错误: ${size}x${size}模型导出失败${NC}"
+            deactivate
+            return 1
+        fi
+    done
+    deactivate
+    rm -f models/yolov11n.pt
+
+    echo -e "${GREEN}固定尺寸模型导出完成，请在config/camera.json的model.variants中登记${NC}"
+    return 0
+}
+
 # 下载COCO类别名称
 download_coco_names() {
     echo "正在下载COCO类别名称..."
@@ -292,6 +347,12 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
+# 导出固定尺寸模型(可选)
+export_fixed_sizes
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
 # 下载COCO类别名称
 download_coco_names
 if [ $? -ne 0 ]; then
@@ -0,0 +1,45 @@
+/**
+ * @file bench_utils.h
+ * @brief 基准和评估程序共用的小工具
+ * @details 命令行列表解析和延迟统计，供test_model、test_eval等示例程序包含
+ */
+
+#pragma once
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 拆分逗号分隔的命令行列表，忽略空项
+ */
+inline std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+/**
+ * @brief 分位数，取最近的样本
+ * @param values 样本
+ * @param p 分位(0.0-1.0)
+ */
+inline double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+/**
+ * @brief 平均值，无样本时为0
+ */
+inline double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    return values.empty() ? 0.0 : sum / values.size();
+}
@@ -0,0 +1,54 @@
+# 检测流程示例程序的公共构建规则
+# add_detection_example(名称 源文件...)：直接编译检测流程用到的源文件，
+# OpenCV包含dnn模块时一并编译OpenCV DNN推理后端
+set(DETECTION_EXAMPLE_COMMON_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+function(add_detection_example name)
+    find_package(OpenCV REQUIRED core imgproc imgcodecs OPTIONAL_COMPONENTS dnn)
+    find_package(Poco REQUIRED COMPONENTS Foundation JSON)
+
+    add_executable(${name}
+        ${ARGN}
+        ${CMAKE_SOURCE_DIR}/src/image_processor.cpp
+        ${CMAKE_SOURCE_DIR}/src/inference_backend.cpp
+        ${CMAKE_SOURCE_DIR}/src/ort_backend.cpp
+        ${CMAKE_SOURCE_DIR}/src/runtime_config.cpp
+        ${CMAKE_SOURCE_DIR}/src/kernel_dispatch.cpp
+        ${CMAKE_SOURCE_DIR}/src/tensor_kernels.cpp
+        ${CMAKE_SOURCE_DIR}/src/decode_kernels.cpp
+        ${CMAKE_SOURCE_DIR}/src/coro_executor.cpp
+        ${CMAKE_SOURCE_DIR}/src/frame_mailbox.cpp
+        ${CMAKE_SOURCE_DIR}/src/thread_tuning.cpp
+    )
+
+    if(TARGET opencv_dnn)
+        target_compile_definitions(${name} PRIVATE USE_OPENCV_DNN)
+        target_sources(${name} PRIVATE ${CMAKE_SOURCE_DIR}/src/dnn_backend.cpp)
+        target_link_libraries(${name} PRIVATE opencv_dnn)
+    endif()
+
+    # 添加包含目录
+    target_include_directories(${name}
+        PRIVATE
+        ${CMAKE_SOURCE_DIR}/include
+        ${DETECTION_EXAMPLE_COMMON_DIR}
+        ${ONNX_INCLUDE_DIRS}
+        ${OpenCV_INCLUDE_DIRS}
+    )
+
+    # 链接库
+    target_link_libraries(${name}
+        PRIVATE
+        ${ONNX_LIBRARIES}
+        ${OpenCV_LIBS}
+        Poco::Foundation
+        Poco::JSON
+    )
+
+    # 设置rpath
+    set_target_properties(${name} PROPERTIES
+        INSTALL_RPATH "${CMAKE_INSTALL_PREFIX}/lib"
+        BUILD_WITH_INSTALL_RPATH TRUE
+        INSTALL_RPATH_USE_LINK_PATH TRUE
+    )
+endfunction()
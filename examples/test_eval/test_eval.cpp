@@ -0,0 +1,517 @@
+/**
+ * @file test_eval.cpp
+ * @brief 检测精度和速度评估程序
+ * @details 在本地COCO格式数据集上运行完整检测流程(ImageProcessor)，对模型、输入边长、推理后端和线程数的每个组合
+ *          输出mAP@0.5、mAP@0.5:0.95和单图延迟；指定基线报告时与之比较，mAP下降或变慢超过阈值时返回非0，
+ *          用于在预处理、解码或量化改动后确认检测质量没有下降
+ */
+#include "image_processor.h"
+#include "runtime_config.h"
+#include "bench_utils.h"
+#include <Poco/JSON/Array.h>
+#include <Poco/JSON/Object.h>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kMaxDetections = 100;     ///< 每张图片参与评估的检测数上限，与COCO的maxDets一致
+constexpr int kRecallPoints = 101;      ///< 插值召回点数，与COCO一致
+
+/**
+ * @brief 浮点矩形框，COCO标注为浮点坐标
+ */
+struct Box {
+    double x{0}, y{0}, w{0}, h{0};
+
+    double area() const { return w * h; }
+
+    double intersection(const Box& other) const {
+        double iw = std::min(x + w, other.x + other.w) - std::max(x, other.x);
+        double ih = std::min(y + h, other.y + other.h) - std::max(y, other.y);
+        return iw > 0 && ih > 0 ? iw * ih : 0.0;
+    }
+};
+
+/**
+ * @brief 一个标注框
+ */
+struct GroundTruth {
+    int category{0};    ///< COCO类别ID
+    Box box;            ///< 边界框
+    bool crowd{false};  ///< 人群标注，与之重叠的检测既不算命中也不算误检
+};
+
+/**
+ * @brief 一张评估图片
+ */
+struct EvalImage {
+    int id{0};                          ///< COCO图片ID
+    std::string path;                   ///< 图片文件
+    std::vector<GroundTruth> truths;    ///< 标注
+};
+
+/**
+ * @brief 一个检测框
+ */
+struct Detection {
+    size_t image{0};    ///< 图片序号
+    double score{0};    ///< 置信度
+    Box box;            ///< 边界框
+};
+
+/**
+ * @brief 一个组合的评估结果
+ */
+struct EvalResult {
+    std::string model;          ///< 模型文件
+    std::string backend;        ///< 推理后端
+    int threads{1};             ///< 推理线程数
+    int requested{0};           ///< 请求的输入边长
+    int actual{0};              ///< 实际使用的输入边长
+    double map50{0};            ///< mAP@0.5
+    double map{0};              ///< mAP@0.5:0.95
+    std::vector<double> ms;     ///< 每张图片的耗时
+
+    /// 与基线报告对应的键
+    std::string key() const {
+        return model + "|" + backend + "|" + std::to_string(threads) + "|" + std::to_string(requested);
+    }
+};
+
+void usage(const char* program) {
+    std::cerr << "用法: " << program << " --annotations instances.json --images 图片目录\n"
+              << "    [--config 配置文件] [--models a.onnx,b.onnx] [--backends ort,ort-xnnpack,opencv]\n"
+              << "    [--threads 1,2,4] [--sizes 320,416,...] [--limit 图片数] [--confidence 阈值]\n"
+              << "    [--report 报告文件] [--baseline 基线报告] [--max-drop mAP允许下降] [--max-slowdown 允许变慢比例]"
+              << std::endl;
+}
+
+/**
+ * @brief 读取COCO格式标注
+ * @param path 标注文件
+ * @param directory 图片目录，file_name相对于此
+ * @param limit 图片数上限，0表示全部
+ * @param images 输出，评估图片
+ * @param categories 输出，类别名称→COCO类别ID
+ */
+bool loadCoco(const std::string& path, const std::string& directory, int limit,
+              std::vector<EvalImage>& images, std::map<std::string, int>& categories) {
+    auto json = loadJsonFile(path);
+    if (json.isNull()) return false;
+    auto image_array = json->getArray("images");
+    auto annotation_array = json->getArray("annotations");
+    auto category_array = json->getArray("categories");
+    if (image_array.isNull() || annotation_array.isNull() || category_array.isNull()) {
+        std::cerr << "标注文件缺少images、annotations或categories: " << path << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < category_array->size(); ++i) {
+        auto category = category_array->getObject(static_cast<unsigned>(i));
+        categories[category->getValue<std::string>("name")] = category->getValue<int>("id");
+    }
+
+    std::map<int, size_t> index;
+    for (size_t i = 0; i < image_array->size(); ++i) {
+        if (limit > 0 && static_cast<int>(images.size()) >= limit) break;
+        auto image = image_array->getObject(static_cast<unsigned>(i));
+        EvalImage entry;
+        entry.id = image->getValue<int>("id");
+        entry.path = directory + "/" + image->getValue<std::string>("file_name");
+        index[entry.id] = images.size();
+        images.push_back(std::move(entry));
+    }
+
+    for (size_t i = 0; i < annotation_array->size(); ++i) {
+        auto annotation = annotation_array->getObject(static_cast<unsigned>(i));
+        auto it = index.find(annotation->getValue<int>("image_id"));
+        if (it == index.end()) continue;
+        auto bbox = annotation->getArray("bbox");
+        if (bbox.isNull() || bbox->size() != 4) continue;
+
+        GroundTruth truth;
+        truth.category = annotation->getValue<int>("category_id");
+        truth.box = {bbox->getElement<double>(0), bbox->getElement<double>(1),
+                     bbox->getElement<double>(2), bbox->getElement<double>(3)};
+        truth.crowd = annotation->optValue<int>("iscrowd", 0) != 0;
+        images[it->second].truths.push_back(truth);
+    }
+    return !images.empty();
+}
+
+/**
+ * @brief 一个类别在一个IoU阈值下的AP
+ * @param images 评估图片
+ * @param detections 该类别的检测，按置信度从高到低
+ * @param category COCO类别ID
+ * @param threshold IoU阈值
+ * @return 该类别没有标注时返回负数
+ * @details 与COCO评估一致：每个检测贪心匹配IoU最高的未匹配标注，未命中但与人群标注重叠的检测忽略，
+ *          精确率取右侧最大值后在101个召回点上平均
+ */
+double averagePrecision(const std::vector<EvalImage>& images, const std::vector<Detection>& detections,
+                        int category, double threshold) {
+    int positives = 0;
+    std::vector<std::vector<bool>> matched(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        matched[i].assign(images[i].truths.size(), false);
+        for (const auto& truth : images[i].truths) {
+            if (truth.category == category && !truth.crowd) ++positives;
+        }
+    }
+    if (positives == 0) return -1.0;
+
+    std::vector<double> precision;
+    std::vector<double> recall;
+    int tp = 0, fp = 0;
+    for (const auto& det : detections) {
+        const auto& truths = images[det.image].truths;
+        int best = -1;
+        double best_iou = threshold;
+        bool ignored = false;
+        for (size_t j = 0; j < truths.size(); ++j) {
+            const auto& truth = truths[j];
+            if (truth.category != category) continue;
+            double inter = det.box.intersection(truth.box);
+            if (truth.crowd) {
+                // 人群标注按检测框自身面积计算重叠，可以被任意多个检测命中
+                if (det.box.area() > 0 && inter / det.box.area() >= threshold) ignored = true;
+                continue;
+            }
+            if (matched[det.image][j]) continue;
+            double iou = inter / (det.box.area() + truth.box.area() - inter);
+            if (iou >= best_iou) {
+                best_iou = iou;
+                best = static_cast<int>(j);
+            }
+        }
+        if (best >= 0) {
+            matched[det.image][best] = true;
+            ++tp;
+        } else if (ignored) {
+            continue;
+        } else {
+            ++fp;
+        }
+        precision.push_back(static_cast<double>(tp) / (tp + fp));
+        recall.push_back(static_cast<double>(tp) / positives);
+    }
+
+    for (size_t i = precision.size(); i-- > 1;) {
+        precision[i - 1] = std::max(precision[i - 1], precision[i]);
+    }
+    double sum = 0.0;
+    for (int r = 0; r < kRecallPoints; ++r) {
+        double target = static_cast<double>(r) / (kRecallPoints - 1);
+        auto it = std::lower_bound(recall.begin(), recall.end(), target);
+        if (it != recall.end()) sum += precision[it - recall.begin()];
+    }
+    return sum / kRecallPoints;
+}
+
+/**
+ * @brief 计算mAP@0.5和mAP@0.5:0.95
+ * @param detections COCO类别ID→检测
+ */
+void meanAveragePrecision(const std::vector<EvalImage>& images, std::map<int, std::vector<Detection>>& detections,
+                          const std::map<std::string, int>& categories, double& map50, double& map) {
+    for (auto& entry : detections) {
+        std::stable_sort(entry.second.begin(), entry.second.end(), [](const Detection& a, const Detection& b) {
+            return a.score > b.score;
+        });
+    }
+
+    double total = 0.0;
+    map50 = 0.0;
+    for (int t = 0; t < 10; ++t) {
+        double threshold = 0.5 + 0.05 * t;
+        double sum = 0.0;
+        int count = 0;
+        for (const auto& category : categories) {
+            double ap = averagePrecision(images, detections[category.second], category.second, threshold);
+            if (ap < 0) continue;
+            sum += ap;
+            ++count;
+        }
+        double value = count > 0 ? sum / count : 0.0;
+        if (t == 0) map50 = value;
+        total += value;
+    }
+    map = total / 10;
+}
+
+/**
+ * @brief 读取基线报告
+ * @return 组合键→结果
+ */
+std::map<std::string, EvalResult> loadBaseline(const std::string& path) {
+    std::map<std::string, EvalResult> baseline;
+    auto json = loadJsonFile(path);
+    if (json.isNull()) return baseline;
+    auto results = json->getArray("results");
+    if (results.isNull()) return baseline;
+    for (size_t i = 0; i < results->size(); ++i) {
+        auto item = results->getObject(static_cast<unsigned>(i));
+        EvalResult result;
+        result.map50 = item->getValue<double>("map50");
+        result.map = item->getValue<double>("map");
+        result.ms.push_back(item->getValue<double>("mean_ms"));
+        baseline[item->getValue<std::string>("key")] = result;
+    }
+    return baseline;
+}
+
+void writeReport(const std::string& path, const std::vector<EvalResult>& results, size_t images, double confidence) {
+    Poco::JSON::Array items;
+    for (const auto& result : results) {
+        Poco::JSON::Object item;
+        item.set("key", result.key());
+        item.set("model", result.model);
+        item.set("backend", result.backend);
+        item.set("threads", result.threads);
+        item.set("requested_size", result.requested);
+        item.set("input_size", result.actual);
+        item.set("map50", result.map50);
+        item.set("map", result.map);
+        item.set("mean_ms", mean(result.ms));
+        item.set("p50_ms", percentile(result.ms, 0.5));
+        item.set("p99_ms", percentile(result.ms, 0.99));
+        items.add(item);
+    }
+    Poco::JSON::Object report;
+    report.set("images", static_cast<int>(images));
+    report.set("confidence", confidence);
+    report.set("results", items);
+
+    std::ofstream file(path);
+    report.stringify(file, 2);
+    if (!file.good()) {
+        std::cerr << "写入报告失败: " << path << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string config_path = "config/camera.json";
+    std::string annotations_path;
+    std::string images_dir;
+    std::string report_path;
+    std::string baseline_path;
+    std::vector<std::string> models;
+    std::vector<std::string> backends;
+    std::vector<int> threads;
+    std::vector<int> sizes;
+    int limit = 0;
+    double confidence = 0.01;
+    double max_drop = 0.01;
+    double max_slowdown = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--config" && has_value) {
+            config_path = argv[++i];
+        } else if (arg == "--annotations" && has_value) {
+            annotations_path = argv[++i];
+        } else if (arg == "--images" && has_value) {
+            images_dir = argv[++i];
+        } else if (arg == "--models" && has_value) {
+            models = splitList(argv[++i]);
+        } else if (arg == "--backends" && has_value) {
+            backends = splitList(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            for (const auto& item : splitList(argv[++i])) threads.push_back(std::max(1, std::atoi(item.c_str())));
+        } else if (arg == "--sizes" && has_value) {
+            for (const auto& item : splitList(argv[++i])) sizes.push_back(std::atoi(item.c_str()));
+        } else if (arg == "--limit" && has_value) {
+            limit = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--confidence" && has_value) {
+            confidence = std::atof(argv[++i]);
+        } else if (arg == "--report" && has_value) {
+            report_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--max-drop" && has_value) {
+            max_drop = std::atof(argv[++i]);
+        } else if (arg == "--max-slowdown" && has_value) {
+            max_slowdown = std::atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (annotations_path.empty() || images_dir.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<EvalImage> images;
+    std::map<std::string, int> categories;
+    if (!loadCoco(annotations_path, images_dir, limit, images, categories)) {
+        std::cerr << "无法读取标注: " << annotations_path << std::endl;
+        return 1;
+    }
+
+    // 检测参数与应用一致，只是降低置信度阈值以得到完整的精确率-召回率曲线，并对整帧检测
+    auto config = std::make_shared<RuntimeConfigStore>();
+    ModelOptions model_options;
+    auto file = loadJsonFile(config_path);
+    if (!file.isNull()) {
+        std::string error;
+        if (!config->applyJson(*file, error)) {
+            std::cerr << "配置文件" << config_path << "无效: " << error << std::endl;
+        }
+        model_options = ModelOptions::fromJson(file->getObject("model"));
+    }
+    config->update([confidence](RuntimeConfig& c) {
+        c.detection_enabled = true;
+        c.confidence_threshold = static_cast<float>(confidence);
+        c.roi = cv::Rect();
+        c.roi_polygons.clear();
+    });
+    if (models.empty()) models.push_back(model_options.path);
+    if (backends.empty()) backends.push_back(model_options.backend);
+    if (threads.empty()) threads.push_back(model_options.threads);
+
+    std::vector<EvalResult> results;
+    for (const auto& model : models) {
+        for (const auto& backend : backends) {
+            for (int thread_count : threads) {
+                ModelOptions options = model_options;
+                if (model != options.path) {
+                    // 配置中的固定尺寸模型属于配置的主模型，换模型时不再使用
+                    options.path = model;
+                    options.variants.clear();
+                }
+                options.backend = backend;
+                options.threads = thread_count;
+                ImageProcessor processor(config, options);
+                if (!processor.modelLoaded()) {
+                    std::cerr << "模型" << model << "(" << backend << ")加载失败，跳过" << std::endl;
+                    continue;
+                }
+
+                // 模型类别按名称对应到COCO类别ID，数据集中没有的类别的检测不参与评估
+                std::vector<int> category_of;
+                for (const auto& name : processor.classNames()) {
+                    auto it = categories.find(name);
+                    category_of.push_back(it != categories.end() ? it->second : -1);
+                }
+
+                std::vector<int> model_sizes = sizes.empty() ? processor.inputSizes() : sizes;
+                std::sort(model_sizes.begin(), model_sizes.end());
+                for (int size : model_sizes) {
+                    EvalResult result;
+                    result.model = model;
+                    result.backend = backend;
+                    result.threads = thread_count;
+                    result.requested = size;
+                    config->update([size](RuntimeConfig& c) { c.model_input_size = size; });
+
+                    std::map<int, std::vector<Detection>> detections;
+                    bool warmed = false;
+                    for (size_t i = 0; i < images.size(); ++i) {
+                        cv::Mat image = cv::imread(images[i].path);
+                        if (image.empty()) {
+                            std::cerr << "无法读取图片: " << images[i].path << std::endl;
+                            continue;
+                        }
+                        // 首张图片先预热一次(内存分配、图优化)，不计时
+                        if (!warmed) {
+                            processor.processFrame(image);
+                            warmed = true;
+                        }
+                        auto start = std::chrono::steady_clock::now();
+                        auto found = processor.processFrame(image);
+                        result.ms.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count());
+
+                        std::sort(found.begin(), found.end(), [](const DetectionResult& a, const DetectionResult& b) {
+                            return a.confidence > b.confidence;
+                        });
+                        if (found.size() > static_cast<size_t>(kMaxDetections)) found.resize(kMaxDetections);
+                        for (const auto& det : found) {
+                            if (det.class_id < 0 || det.class_id >= static_cast<int>(category_of.size())) continue;
+                            int category = category_of[det.class_id];
+                            if (category < 0) continue;
+                            detections[category].push_back({i, det.confidence,
+                                {static_cast<double>(det.bbox.x), static_cast<double>(det.bbox.y),
+                                 static_cast<double>(det.bbox.width), static_cast<double>(det.bbox.height)}});
+                        }
+                    }
+                    result.actual = processor.activeInputSize();
+                    meanAveragePrecision(images, detections, categories, result.map50, result.map);
+                    std::cerr << "完成 " << result.key() << std::endl;
+                    results.push_back(std::move(result));
+                }
+            }
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "没有完成任何组合" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed;
+    std::cout << "图片" << images.size() << "张，置信度阈值" << confidence << std::endl;
+    std::cout << "| 模型 | 后端 | 线程 | 输入边长 | 实际边长 | mAP@0.5 | mAP@0.5:0.95 | 平均(ms) | P50(ms) | P99(ms) |"
+              << std::endl;
+    std::cout << "|------|------|-----|---------|---------|---------|--------------|---------|---------|---------|"
+              << std::endl;
+    for (const auto& result : results) {
+        std::cout << "| " << result.model << " | " << result.backend << " | " << result.threads
+                  << " | " << result.requested << " | " << result.actual << std::setprecision(3)
+                  << " | " << result.map50 << " | " << result.map << std::setprecision(1)
+                  << " | " << mean(result.ms) << " | " << percentile(result.ms, 0.5)
+                  << " | " << percentile(result.ms, 0.99) << " |" << std::endl;
+    }
+
+    if (!report_path.empty()) {
+        writeReport(report_path, results, images.size(), confidence);
+    }
+
+    // 与基线比较：任一mAP下降超过max_drop，或平均延迟超过基线(1+max_slowdown)倍时视为回归
+    if (baseline_path.empty()) return 0;
+    auto baseline = loadBaseline(baseline_path);
+    if (baseline.empty()) {
+        std::cerr << "无法读取基线报告: " << baseline_path << std::endl;
+        return 1;
+    }
+    int regressions = 0;
+    std::cout << std::endl << "与基线" << baseline_path << "比较:" << std::endl;
+    for (const auto& result : results) {
+        auto it = baseline.find(result.key());
+        if (it == baseline.end()) {
+            std::cout << "  " << result.key() << ": 基线中没有此组合" << std::endl;
+            continue;
+        }
+        const EvalResult& base = it->second;
+        double slowdown = base.ms.front() > 0 ? mean(result.ms) / base.ms.front() - 1.0 : 0.0;
+        std::vector<std::string> reasons;
+        if (base.map50 - result.map50 > max_drop) reasons.push_back("mAP@0.5下降");
+        if (base.map - result.map > max_drop) reasons.push_back("mAP@0.5:0.95下降");
+        if (max_slowdown > 0 && slowdown > max_slowdown) reasons.push_back("变慢");
+
+        std::cout << "  " << result.key() << std::setprecision(3)
+                  << ": mAP@0.5 " << base.map50 << "→" << result.map50
+                  << "，mAP@0.5:0.95 " << base.map << "→" << result.map << std::setprecision(1)
+                  << "，延迟" << (slowdown >= 0 ? "+" : "") << 100.0 * slowdown << "%";
+        for (const auto& reason : reasons) std::cout << " [" << reason << "]";
+        std::cout << std::endl;
+        if (!reasons.empty()) ++regressions;
+    }
+    if (regressions > 0) {
+        std::cerr << regressions << "个组合相对基线回归" << std::endl;
+        return 2;
+    }
+    return 0;
+}
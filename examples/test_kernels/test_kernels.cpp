@@ -0,0 +1,276 @@
+/**
+ * @file test_kernels.cpp
+ * @brief 热点内核测试程序
+ * @details 对每个内核(颜色转换、输入张量生成、输出解码)运行当前CPU支持的所有指令集实现，
+ *          与标量实现逐一比较并统计耗时；输入张量另以OpenCV的"cvtColor→resize→convertTo→CHW"为参照。
+ *          任一实现结果不符时返回非0
+ */
+#include "color_kernels.h"
+#include "decode_kernels.h"
+#include "kernel_dispatch.h"
+#include "tensor_kernels.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr float kReferenceTolerance = 2.0f / 255.0f;   ///< 与OpenCV参照的误差上限(参照实现两次8位取整)
+constexpr float kScalarTolerance = 1e-5f;              ///< 浮点内核与标量实现的误差上限(FMA舍入差异)
+constexpr int kIterations = 20;                        ///< 计时的重复次数
+
+/**
+ * @brief 测试用的源图像
+ */
+struct TestImage {
+    const char* name;
+    cv::Mat data;           ///< 原始数据
+    TensorSource source;    ///< 内核的输入视图
+    int conversion{-1};     ///< 参照实现转换到BGR的cvtColor代码，-1表示已是BGR
+};
+
+TestImage makeImage(TensorFormat format, int width, int height) {
+    TestImage image;
+    switch (format) {
+    case TensorFormat::kBGR:
+        image.name = "bgr";
+        image.data.create(height, width, CV_8UC3);
+        cv::randu(image.data, 0, 256);
+        image.source = TensorSource::fromBgr(image.data);
+        return image;
+    case TensorFormat::kYUYV:
+        image.name = "yuyv";
+        image.data.create(height, width, CV_8UC2);
+        cv::randu(image.data, 0, 256);
+        image.conversion = cv::COLOR_YUV2BGR_YUYV;
+        image.source.stride = image.data.step;
+        break;
+    case TensorFormat::kNV12:
+        image.name = "nv12";
+        image.data.create(height * 3 / 2, width, CV_8UC1);
+        cv::randu(image.data, 0, 256);
+        image.conversion = cv::COLOR_YUV2BGR_NV12;
+        image.source.stride = image.data.step;
+        image.source.uv = image.data.ptr(height);
+        image.source.uv_stride = image.data.step;
+        break;
+    }
+    image.source.format = format;
+    image.source.data = image.data.data;
+    image.source.width = width;
+    image.source.height = height;
+    return image;
+}
+
+/**
+ * @brief 参照实现：整帧转换为BGR后按ImageProcessor原有的预处理生成张量
+ */
+void reference(const TestImage& image, const cv::Rect& region, const cv::Size& size, float* dst) {
+    cv::Mat bgr = image.data;
+    if (image.conversion >= 0) {
+        cv::cvtColor(image.data, bgr, image.conversion);
+    }
+    cv::Mat resized, float_img;
+    cv::resize(bgr(region), resized, size);
+    resized.convertTo(float_img, CV_32F, 1.0 / 255.0);
+    for (int c = 0; c < 3; c++) {
+        for (int h = 0; h < size.height; h++) {
+            for (int w = 0; w < size.width; w++) {
+                dst[c * size.area() + h * size.width + w] = float_img.at<cv::Vec3f>(h, w)[c];
+            }
+        }
+    }
+}
+
+template <typename Fn>
+double averageMs(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kIterations;
+}
+
+template <typename T>
+float maxError(const std::vector<T>& a, const std::vector<T>& b) {
+    float error = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        error = std::max(error, static_cast<float>(std::fabs(static_cast<double>(a[i]) - static_cast<double>(b[i]))));
+    }
+    return error;
+}
+
+/**
+ * @brief 当前CPU可运行的实现
+ */
+std::vector<KernelIsa> runnable(KernelId kernel) {
+    std::vector<KernelIsa> result;
+    for (KernelIsa isa : KernelDispatch::variants(kernel)) {
+        if (KernelDispatch::supported(isa)) result.push_back(isa);
+    }
+    return result;
+}
+
+void report(bool ok, const std::string& what, KernelIsa isa, const std::string& detail, double ms, double baseline_ms) {
+    std::cout << (ok ? "[通过] " : "[失败] ") << what << " " << KernelDispatch::isaName(isa) << " " << detail
+              << " 耗时" << ms << "ms(对照" << baseline_ms << "ms)" << std::endl;
+}
+
+int testColor() {
+    int failures = 0;
+    std::cout << "== 颜色转换(color) ==" << std::endl;
+    // 宽度覆盖SIMD分组的整数倍和带尾部的情况
+    const cv::Size sizes[] = {{640, 480}, {646, 2}, {1282, 720}};
+    for (const auto& size : sizes) {
+        cv::Mat yuyv(size, CV_8UC2);
+        cv::randu(yuyv, 0, 256);
+
+        cv::Mat opencv;
+        double opencv_ms = averageMs([&] { cv::cvtColor(yuyv, opencv, cv::COLOR_YUV2BGR_YUYV); });
+        cv::Mat expected(size, CV_8UC3);
+        ColorKernels::yuyvToBgr(yuyv.data, yuyv.step, expected.data, expected.step, size.width, size.height,
+                                KernelIsa::kScalar);
+
+        // 定点算法与OpenCV相同，OpenCV自身的SIMD路径可能有1的舍入差异
+        double opencv_error = cv::norm(expected, opencv, cv::NORM_INF);
+        bool opencv_ok = opencv_error <= 1.0;
+        failures += opencv_ok ? 0 : 1;
+        std::cout << (opencv_ok ? "[通过] " : "[失败] ") << "color " << size.width << "x" << size.height
+                  << " scalar与OpenCV最大差" << opencv_error << std::endl;
+
+        for (KernelIsa isa : runnable(KernelId::kColor)) {
+            cv::Mat actual(size, CV_8UC3, cv::Scalar(0));
+            double ms = averageMs([&] {
+                ColorKernels::yuyvToBgr(yuyv.data, yuyv.step, actual.data, actual.step, size.width, size.height, isa);
+            });
+            bool ok = cv::norm(expected, actual, cv::NORM_INF) == 0.0;
+            failures += ok ? 0 : 1;
+            report(ok, "color", isa, std::to_string(size.width) + "x" + std::to_string(size.height) + " 与标量逐字节一致",
+                   ms, opencv_ms);
+        }
+    }
+    return failures;
+}
+
+int testPreprocess() {
+    int failures = 0;
+    std::cout << "== 输入张量(preprocess) ==" << std::endl;
+    const cv::Size sources[] = {{640, 480}, {1280, 720}};
+    const cv::Size targets[] = {{320, 320}, {640, 640}, {416, 256}};
+    const TensorFormat formats[] = {TensorFormat::kBGR, TensorFormat::kYUYV, TensorFormat::kNV12};
+
+    for (const auto& source_size : sources) {
+        for (auto format : formats) {
+            TestImage image = makeImage(format, source_size.width, source_size.height);
+            // 整帧和奇数起点的子区域(检测区域、分块)
+            const cv::Rect regions[] = {
+                {0, 0, source_size.width, source_size.height},
+                {101, 37, source_size.width / 2 + 3, source_size.height / 2 + 1},
+            };
+            for (const auto& region : regions) {
+                for (const auto& size : targets) {
+                    std::vector<float> opencv(3 * size.area());
+                    double reference_ms = averageMs([&] { reference(image, region, size, opencv.data()); });
+                    std::vector<float> scalar(opencv.size());
+                    TensorKernels::convert(image.source, region, size, scalar.data(), KernelIsa::kScalar);
+
+                    for (KernelIsa isa : runnable(KernelId::kPreprocess)) {
+                        std::vector<float> actual(opencv.size(), -1.0f);
+                        double ms = averageMs([&] {
+                            TensorKernels::convert(image.source, region, size, actual.data(), isa);
+                        });
+                        float reference_error = maxError(actual, opencv);
+                        float scalar_error = maxError(actual, scalar);
+                        bool ok = reference_error <= kReferenceTolerance && scalar_error <= kScalarTolerance;
+                        failures += ok ? 0 : 1;
+
+                        std::ostringstream detail;
+                        detail << image.name << " " << source_size.width << "x" << source_size.height
+                               << " 区域" << region.width << "x" << region.height
+                               << " → " << size.width << "x" << size.height
+                               << " 与OpenCV最大差" << reference_error * 255.0f << "/255"
+                               << " 与标量最大差" << scalar_error;
+                        report(ok, "preprocess", isa, detail.str(), ms, reference_ms);
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+int testDecode() {
+    int failures = 0;
+    std::cout << "== 输出解码(decode) ==" << std::endl;
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    struct Case {
+        int boxes;
+        int classes;
+    };
+    const Case cases[] = {{8400, 80}, {2101, 79}, {17, 3}};
+    for (const auto& c : cases) {
+        std::vector<float> scores(static_cast<size_t>(c.boxes) * c.classes);
+        for (auto& v : scores) {
+            // 量化到1/64，制造大量同分以检查取最小类别号的规则
+            v = std::floor(dist(rng) * 64.0f) / 64.0f;
+        }
+
+        // [类别][框]和[框][类别]两种布局
+        struct Layout {
+            const char* name;
+            size_t box_stride;
+            size_t class_stride;
+        };
+        const Layout layouts[] = {
+            {"按类别存放", 1, static_cast<size_t>(c.boxes)},
+            {"按框存放", static_cast<size_t>(c.classes), 1},
+        };
+        for (const auto& layout : layouts) {
+            std::vector<float> expected_score(c.boxes);
+            std::vector<int> expected_class(c.boxes);
+            double scalar_ms = averageMs([&] {
+                DecodeKernels::bestClass(scores.data(), c.boxes, c.classes, layout.box_stride, layout.class_stride,
+                                         expected_score.data(), expected_class.data(), KernelIsa::kScalar);
+            });
+
+            for (KernelIsa isa : runnable(KernelId::kDecode)) {
+                std::vector<float> best_score(c.boxes, -1.0f);
+                std::vector<int> best_class(c.boxes, -1);
+                double ms = averageMs([&] {
+                    DecodeKernels::bestClass(scores.data(), c.boxes, c.classes, layout.box_stride, layout.class_stride,
+                                             best_score.data(), best_class.data(), isa);
+                });
+                bool ok = best_score == expected_score && best_class == expected_class;
+                failures += ok ? 0 : 1;
+                report(ok, "decode", isa, std::string(layout.name) + " " + std::to_string(c.boxes) + "框×"
+                       + std::to_string(c.classes) + "类 与标量完全一致", ms, scalar_ms);
+            }
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "CPU特性:";
+    for (const auto& name : KernelDispatch::features().names()) {
+        std::cout << " " << name;
+    }
+    std::cout << std::endl << std::fixed << std::setprecision(3);
+
+    int failures = testColor() + testPreprocess() + testDecode();
+    if (failures > 0) {
+        std::cerr << failures << "项结果不符" << std::endl;
+        return 1;
+    }
+    std::cout << "全部通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file test_model.cpp
+ * @brief 模型输入尺寸和推理后端基准测试程序
+ * @details 按config/camera.json加载检测模型，对一组图片依次以每个推理后端、每个可切换的输入边长运行ImageProcessor，
+ *          输出单帧延迟、每帧堆分配次数和检测结果与参照结果(第一个后端的最大边长)的一致程度(召回率、精确率)，
+ *          最后按最大边长的平均延迟给后端排名，用于选择backend、model_input_size以及在精度和延迟之间取舍
+ */
+#include "image_processor.h"
+#include "runtime_config.h"
+#include "alloc_stats.h"
+#include "bench_utils.h"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr float kMatchIou = 0.5f;   ///< 与参照结果匹配的IoU阈值
+
+/**
+ * @brief 一个输入边长的测试结果
+ */
+struct SizeResult {
+    std::string backend;        ///< 推理后端
+    int requested{0};           ///< 请求的输入边长
+    int actual{0};              ///< 实际使用的输入边长
+    std::vector<double> ms;     ///< 每帧耗时
+    uint64_t allocations{0};    ///< 计时各轮的堆分配总次数
+    std::vector<std::vector<DetectionResult>> detections;  ///< 每张图片的检测结果
+};
+
+void usage(const char* program) {
+    std::cerr << "用法: " << program << " [--config 配置文件] [--backends ort,ort-xnnpack,opencv] [--sizes 320,416,...]"
+              << " [--repeat 次数] 图片或目录..."
+              << std::endl;
+}
+
+std::vector<std::string> collectImages(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> images;
+    for (const auto& path : paths) {
+        if (fs::is_directory(path)) {
+            for (const auto& entry : fs::directory_iterator(path)) {
+                std::string ext = entry.path().extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+                if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp") {
+                    images.push_back(entry.path().string());
+                }
+            }
+        } else {
+            images.push_back(path);
+        }
+    }
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+double iou(const cv::Rect& a, const cv::Rect& b) {
+    double inter = (a & b).area();
+    double uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+/**
+ * @brief 按置信度从高到低贪心匹配同类别、IoU不低于kMatchIou的检测框
+ * @return 匹配上的框数
+ */
+int countMatches(std::vector<DetectionResult> detections, const std::vector<DetectionResult>& reference) {
+    std::sort(detections.begin(), detections.end(), [](const DetectionResult& a, const DetectionResult& b) {
+        return a.confidence > b.confidence;
+    });
+    std::vector<bool> used(reference.size(), false);
+    int matches = 0;
+    for (const auto& det : detections) {
+        int best = -1;
+        double best_iou = kMatchIou;
+        for (size_t i = 0; i < reference.size(); ++i) {
+            if (used[i] || reference[i].class_id != det.class_id) continue;
+            double v = iou(det.bbox, reference[i].bbox);
+            if (v >= best_iou) {
+                best_iou = v;
+                best = static_cast<int>(i);
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            ++matches;
+        }
+    }
+    return matches;
+}
+
+/**
+ * @brief 全部线程(含分块推理线程)累计的堆分配次数
+ */
+uint64_t totalAllocations() {
+    uint64_t total = 0;
+    for (const auto& group : AllocStats::snapshot()) {
+        total += group.allocations;
+    }
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string config_path = "config/camera.json";
+    std::vector<int> sizes;
+    std::vector<std::string> backends;
+    int repeat = 3;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--backends" && i + 1 < argc) {
+            backends = splitList(argv[++i]);
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            for (const auto& item : splitList(argv[++i])) {
+                sizes.push_back(std::atoi(item.c_str()));
+            }
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    std::vector<cv::Mat> images;
+    for (const auto& path : collectImages(paths)) {
+        cv::Mat image = cv::imread(path);
+        if (image.empty()) {
+            std::cerr << "无法读取图片: " << path << std::endl;
+            continue;
+        }
+        images.push_back(image);
+    }
+    if (images.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 检测参数与应用一致，只在测试中切换推理后端和输入边长
+    auto config = std::make_shared<RuntimeConfigStore>();
+    ModelOptions model_options;
+    auto file = loadJsonFile(config_path);
+    if (!file.isNull()) {
+        std::string error;
+        if (!config->applyJson(*file, error)) {
+            std::cerr << "配置文件" << config_path << "无效: " << error << std::endl;
+        }
+        model_options = ModelOptions::fromJson(file->getObject("model"));
+    }
+    config->update([](RuntimeConfig& c) { c.detection_enabled = true; });
+
+    // 未指定时测试配置的后端和当前构建支持的全部后端，配置的后端排在最前作为参照
+    if (backends.empty()) {
+        backends.push_back(model_options.backend);
+        for (const auto& name : InferenceBackend::available()) {
+            if (name != model_options.backend) backends.push_back(name);
+        }
+    }
+
+    std::vector<SizeResult> results;
+    for (const auto& backend : backends) {
+        ModelOptions options = model_options;
+        options.backend = backend;
+        ImageProcessor processor(config, options);
+        if (!processor.modelLoaded()) {
+            std::cerr << "后端" << backend << "加载模型失败，跳过" << std::endl;
+            continue;
+        }
+        std::vector<int> backend_sizes = sizes.empty() ? processor.inputSizes() : sizes;
+        std::sort(backend_sizes.begin(), backend_sizes.end());
+
+        for (int size : backend_sizes) {
+            SizeResult result;
+            result.backend = backend;
+            result.requested = size;
+            config->update([size](RuntimeConfig& c) { c.model_input_size = size; });
+
+            // 首轮预热(内存分配、图优化)，不计时
+            for (const auto& image : images) {
+                result.detections.push_back(processor.processFrame(image));
+            }
+            result.actual = processor.activeInputSize();
+            uint64_t allocations = totalAllocations();
+            for (int r = 0; r < repeat; ++r) {
+                for (const auto& image : images) {
+                    auto start = std::chrono::steady_clock::now();
+                    processor.processFrame(image);
+                    result.ms.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            }
+            result.allocations = totalAllocations() - allocations;
+            results.push_back(std::move(result));
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "没有可用的推理后端" << std::endl;
+        return 1;
+    }
+
+    // 以第一个后端最大边长的结果为参照，衡量其他后端和较小边长漏检和误检的程度
+    const SizeResult* reference = &results.front();
+    for (const auto& result : results) {
+        if (result.backend == reference->backend && result.actual > reference->actual) reference = &result;
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "图片" << images.size() << "张，每个边长计时" << repeat << "轮，参照" << reference->backend
+              << "@" << reference->actual << std::endl;
+    std::cout << "| 后端 | 输入边长 | 实际边长 | 平均(ms) | P50(ms) | P99(ms) | 分配/帧 | 检测数 | 召回率 | 精确率 |" << std::endl;
+    std::cout << "|------|---------|---------|---------|---------|---------|--------|-------|-------|-------|" << std::endl;
+    for (const auto& result : results) {
+        int count = 0, reference_count = 0, matches = 0;
+        for (size_t i = 0; i < images.size(); ++i) {
+            count += static_cast<int>(result.detections[i].size());
+            reference_count += static_cast<int>(reference->detections[i].size());
+            matches += countMatches(result.detections[i], reference->detections[i]);
+        }
+
+        std::cout << "| " << result.backend << " | " << result.requested << " | " << result.actual
+                  << " | " << mean(result.ms) << " | " << percentile(result.ms, 0.5)
+                  << " | " << percentile(result.ms, 0.99)
+                  << " | " << (AllocStats::enabled() ? std::to_string(result.allocations / result.ms.size()) : "-")
+                  << " | " << count
+                  << " | " << (reference_count > 0 ? 100.0 * matches / reference_count : 100.0) << "%"
+                  << " | " << (count > 0 ? 100.0 * matches / count : 100.0) << "%"
+                  << " |" << std::endl;
+    }
+
+    // 后端排名：各后端在参照边长下的平均延迟，从快到慢
+    std::vector<const SizeResult*> ranking;
+    for (const auto& result : results) {
+        if (result.actual == reference->actual) ranking.push_back(&result);
+    }
+    std::sort(ranking.begin(), ranking.end(), [](const SizeResult* a, const SizeResult* b) {
+        return mean(a->ms) < mean(b->ms);
+    });
+    std::cout << std::endl << "后端排名(输入边长" << reference->actual << "):" << std::endl;
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        std::cout << "  " << (i + 1) << ". " << ranking[i]->backend << " 平均" << mean(ranking[i]->ms)
+                  << "ms P99 " << percentile(ranking[i]->ms, 0.99) << "ms";
+        if (i > 0) {
+            std::cout << "(慢" << 100.0 * (mean(ranking[i]->ms) / mean(ranking[0]->ms) - 1.0) << "%)";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file aligned_file.h
+ * @brief 大块对齐缓冲的顺序写文件
+ * @details 用于录像等持续顺序写入的场景，减少系统调用次数并避免页缓存无限增长
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AlignedFileWriter
+ * @brief 顺序写文件
+ * @details 数据先写入按页对齐的大块缓冲区，缓冲区写满后整块落盘。
+ *          已落盘的区域通过sync_file_range异步回写，并提示内核释放对应页缓存，
+ *          长时间录像不会挤占其他进程的内存。
+ */
+class AlignedFileWriter {
+public:
+    /**
+     * @brief 构造函数
+     * @param buffer_size 缓冲区大小，向上对齐到4096字节
+     */
+    explicit AlignedFileWriter(size_t buffer_size = 1 << 20);
+
+    /**
+     * @brief 析构函数
+     * @details 未关闭的文件会被刷新并关闭
+     */
+    ~AlignedFileWriter();
+
+    AlignedFileWriter(const AlignedFileWriter&) = delete;
+    AlignedFileWriter& operator=(const AlignedFileWriter&) = delete;
+
+    /**
+     * @brief 创建并打开文件
+     * @param path 文件路径，已存在时截断
+     * @return 是否成功
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 追加数据
+     * @param data 数据指针
+     * @param size 数据长度
+     * @return 是否成功
+     */
+    bool write(const void* data, size_t size);
+
+    /**
+     * @brief 覆写已写入区域中的数据
+     * @param offset 文件偏移
+     * @param data 数据指针
+     * @param size 数据长度
+     * @return 是否成功
+     * @details 用于回填文件头中的长度字段，目标区域可以仍在缓冲区中
+     */
+    bool patch(uint64_t offset, const void* data, size_t size);
+
+    /**
+     * @brief 刷新缓冲区并关闭文件
+     * @return 是否成功
+     */
+    bool close();
+
+    /**
+     * @brief 当前写入位置(逻辑文件长度)
+     */
+    uint64_t position() const { return flushed_ + used_; }
+
+    /**
+     * @brief 文件是否已打开
+     */
+    bool isOpen() const { return fd_ >= 0; }
+
+private:
+    /**
+     * @brief 把缓冲区内容写入文件
+     */
+    bool flush();
+
+    int fd_{-1};                 ///< 文件描述符
+    uint8_t* buffer_{nullptr};   ///< 对齐缓冲区
+    size_t capacity_;            ///< 缓冲区容量
+    size_t used_{0};             ///< 缓冲区已用字节数
+    uint64_t flushed_{0};        ///< 已写入文件的字节数
+    uint64_t synced_{0};         ///< 已提交回写的字节数
+};
@@ -0,0 +1,45 @@
+/**
+ * @file alloc_stats.h
+ * @brief 堆分配计数
+ * @details 替换glibc的malloc系列入口(实际分配仍由glibc完成)，按线程所属的隔离组累计分配次数和字节数，
+ *          用于核对稳态推流是否真的不分配内存。operator new以及OpenCV、FFmpeg等库内部的分配都经过这些入口，一并计入。
+ *          需要在构建时开启USE_ALLOC_STATS；sanitizer构建自带malloc替换，此时不计数
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class AllocStats
+ * @brief 按隔离组统计的堆分配计数
+ */
+class AllocStats {
+public:
+    /**
+     * @struct Group
+     * @brief 一个隔离组的累计分配
+     */
+    struct Group {
+        std::string name;           ///< 隔离组名，未归组的线程(主线程、第三方库线程)计入other
+        uint64_t allocations{0};    ///< 累计分配次数(malloc、calloc、realloc和对齐分配)
+        uint64_t bytes{0};          ///< 累计申请字节数
+    };
+
+    /**
+     * @brief 当前线程之后的分配计入指定隔离组
+     * @details 由ThreadTuning::apply在线程启动时调用；组数超过上限时计入other
+     */
+    static void setThreadGroup(const char* group);
+
+    /**
+     * @brief 是否在计数
+     */
+    static bool enabled();
+
+    /**
+     * @brief 获取各隔离组的累计分配
+     */
+    static std::vector<Group> snapshot();
+};
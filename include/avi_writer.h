@@ -0,0 +1,110 @@
+/**
+ * @file avi_writer.h
+ * @brief MJPEG格式AVI文件写入
+ * @details 直接封装捕获端已编码的JPEG帧，无需重新编码
+ */
+
+#pragma once
+#include "aligned_file.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class AviWriter
+ * @brief 单路MJPEG视频的AVI写入器
+ * @details 帧数据顺序追加到movi列表，关闭时写入idx1索引并回填文件头中的长度字段，
+ *          生成的文件可直接拖动进度条播放。帧率在打开时固定，
+ *          缺失的帧位置写入空数据块，保证回放时间轴与实际时间一致。
+ */
+class AviWriter {
+public:
+    AviWriter() = default;
+
+    /**
+     * @brief 析构函数
+     * @details 未关闭的文件会被正常收尾
+     */
+    ~AviWriter();
+
+    AviWriter(const AviWriter&) = delete;
+    AviWriter& operator=(const AviWriter&) = delete;
+
+    /**
+     * @brief 创建文件并写入文件头
+     * @param path 文件路径
+     * @param width 帧宽度
+     * @param height 帧高度
+     * @param fps 帧率
+     * @return 是否成功
+     */
+    bool open(const std::string& path, int width, int height, int fps);
+
+    /**
+     * @brief 写入一帧JPEG数据
+     * @param jpeg JPEG数据
+     * @param size 数据长度
+     * @return 是否成功
+     */
+    bool writeFrame(const void* jpeg, size_t size);
+
+    /**
+     * @brief 按时间位置写入一帧
+     * @param jpeg JPEG数据
+     * @param size 数据长度
+     * @param offset 帧时间相对文件起点的偏移
+     * @param written 输出帧是否被写入；帧超前于时间轴时被丢弃
+     * @return 是否成功
+     * @details 按帧率换算帧位置，之前缺失的位置以空帧补齐(最多补1秒)，
+     *          回放时长与实际时间一致
+     */
+    bool writeFrameAt(const void* jpeg, size_t size, std::chrono::microseconds offset, bool& written);
+
+    /**
+     * @brief 写入一个空帧
+     * @details 播放器将其视为重复上一帧，用于填补丢失的帧位置
+     */
+    bool writeEmptyFrame() { return writeFrame(nullptr, 0); }
+
+    /**
+     * @brief 写入索引、回填文件头并关闭
+     * @return 是否成功
+     */
+    bool close();
+
+    /**
+     * @brief 文件是否已打开
+     */
+    bool isOpen() const { return file_.isOpen(); }
+
+    /**
+     * @brief 已写入的帧数(含空帧)
+     */
+    uint32_t frameCount() const { return static_cast<uint32_t>(index_.size()); }
+
+    /**
+     * @brief 当前文件长度
+     */
+    uint64_t bytesWritten() const { return file_.position(); }
+
+    /**
+     * @brief 打开时指定的帧率
+     */
+    int fps() const { return fps_; }
+
+private:
+    /**
+     * @struct IndexEntry
+     * @brief idx1索引项
+     */
+    struct IndexEntry {
+        uint32_t offset;   ///< 相对movi列表类型字段的偏移
+        uint32_t size;     ///< 数据长度
+    };
+
+    AlignedFileWriter file_;         ///< 底层文件
+    std::vector<IndexEntry> index_;  ///< 帧索引
+    uint32_t max_frame_size_{0};     ///< 最大帧长度
+    int fps_{0};                     ///< 帧率
+};
@@ -5,7 +5,104 @@
  */
 
 #pragma once
+#include "latency_histogram.h"
+#include <opencv2/core.hpp>
 #include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct RawFrame
+ * @brief 驱动缓冲中的原始图像
+ * @details 数据直接位于驱动缓冲(或以USERPTR方式交给驱动的用户缓冲)中，不做拷贝；
+ *          最后一个引用释放后缓冲才归还驱动，持有者应尽快释放
+ */
+struct RawFrame {
+    const uint8_t* data{nullptr};   ///< 图像数据(只读)
+    size_t size{0};                 ///< 有效字节数
+    int width{0};                   ///< 图像宽度
+    int height{0};                  ///< 图像高度
+    size_t bytes_per_line{0};       ///< 行字节数
+    uint32_t pixel_format{0};       ///< V4L2像素格式(fourcc)
+    int dmabuf_fd{-1};              ///< 导出的DMABUF描述符，未导出时为-1；归捕获端所有，跨进程传递时由接收方dup
+    uint32_t index{0};              ///< 驱动缓冲序号
+};
+
+/// 共享的原始图像指针
+using RawFramePtr = std::shared_ptr<const RawFrame>;
+
+/**
+ * @struct EncodedFrame
+ * @brief 已编码的视频帧
+ * @details 帧数据发布后不再修改，多个发送方可共享同一份JPEG数据而无需拷贝
+ */
+struct EncodedFrame {
+    std::vector<uchar> jpeg;    ///< JPEG编码数据，捕获端直接编码到此缓冲
+    uint64_t sequence{0};       ///< 帧序号，从1开始单调递增
+    int width{0};               ///< 图像宽度
+    int height{0};              ///< 图像高度
+    std::chrono::system_clock::time_point wall_time; ///< 采集时刻的系统时间
+    std::chrono::steady_clock::time_point capture_time; ///< 采集时刻(单调时钟)，驱动提供时间戳时取驱动时间，
+                                                        ///< 用于计算帧在各级的时延
+    uint32_t device_sequence{0}; ///< 驱动帧序号(v4l2_buffer.sequence)，不连续说明驱动丢帧
+    RawFramePtr raw;            ///< 驱动缓冲中的原始图像，零拷贝供下游使用；空闲驱动缓冲不足时为空
+    cv::Mat image;              ///< 颜色转换后的BGR图像，供缩放档位和推理复用，捕获端未提供时为空；
+                                ///< 可能来自帧缓冲池，只在持有帧期间有效
+
+    // 推流级为本帧生成的消息存放在帧内，随帧缓冲池槽位复用容量，随帧的引用一起释放；
+    // 只由推流协程在广播本帧之前写入一次，之后与帧数据一样只读
+    mutable std::string info;   ///< JSON格式推流的帧信息文本
+    mutable std::string prefix; ///< 二进制格式推流的消息前缀(帧头和检测框)
+};
+
+/// 共享的只读帧指针
+using EncodedFramePtr = std::shared_ptr<const EncodedFrame>;
+
+class FrameMailbox;
+struct MailboxOptions;
+
+/**
+ * @enum MailboxPolicy
+ * @brief 下游级处理不过来时的丢帧策略
+ */
+enum class MailboxPolicy {
+    kLatest,    ///< 只保留最新一帧，未取走的旧帧被替换(推流、推理)
+    kQueue      ///< 定长队列，队满时丢弃新帧(录像)
+};
+
+/**
+ * @struct MailboxStats
+ * @brief 一个下游级信箱的运行统计
+ */
+struct MailboxStats {
+    std::string stage;          ///< 级名称
+    MailboxPolicy policy{MailboxPolicy::kLatest}; ///< 丢帧策略
+    size_t depth{1};            ///< 队列深度
+    uint64_t pushed{0};         ///< 投递的帧数
+    uint64_t delivered{0};      ///< 下游取走的帧数
+    uint64_t dropped{0};        ///< 下游来不及处理而丢弃的帧数
+};
+
+/**
+ * @struct CaptureStats
+ * @brief 捕获端运行统计
+ */
+struct CaptureStats {
+    uint64_t frames_published{0};   ///< 已发布的帧数
+    size_t pool_capacity{0};        ///< 帧缓冲池槽位数，0表示未使用缓冲池
+    size_t pool_in_use{0};          ///< 正在使用的槽位数
+    uint64_t pool_exhausted{0};     ///< 缓冲池耗尽退化为堆分配的次数
+    LatencyHistogram::Snapshot dequeue_latency; ///< 驱动填充完成到捕获线程取出的延迟
+    uint64_t late_dequeues{0};      ///< 出队延迟超过一个帧间隔的次数
+    LatencyHistogram::Snapshot publish_latency; ///< 采集到发布(颜色转换和JPEG编码完成)的时延
+    uint64_t driver_drops{0};       ///< 按驱动帧序号缺口统计的驱动丢帧数
+    size_t buffers{0};              ///< 驱动缓冲数
+    size_t buffers_held{0};         ///< 被下游持有、尚未归还驱动的缓冲数
+    uint64_t raw_fallbacks{0};      ///< 空闲驱动缓冲不足、帧未携带原始图像的次数
+    std::vector<MailboxStats> stages; ///< 各下游级信箱的统计
+};
 
 /**
  * @class CaptureInterface
@@ -40,4 +137,28 @@ public:
      * @details 以字符串形式返回最新捕获的视频帧，使用JPEG编码
      */
     virtual std::string getLatestFrame() = 0;
+
+    /**
+     * @brief 获取最新的已编码帧
+     * @return 最新帧的共享指针，尚无帧时返回nullptr
+     * @details 与getLatestFrame不同，返回的帧数据不会被拷贝
+     */
+    virtual EncodedFramePtr getLatestEncodedFrame() = 0;
+
+    /**
+     * @brief 订阅新帧
+     * @param stage 下游级名称，用于统计和按级配置丢帧策略
+     * @param defaults 配置文件未指定该级时使用的丢帧策略
+     * @return 该级专属的信箱(定义见frame_mailbox.h)，捕获端每发布一帧即投递一次；
+     *         消费者从信箱取帧，退出时关闭信箱即取消订阅，捕获停止时信箱被关闭
+     * @details 每个信箱只允许一个消费者线程，投递从不阻塞捕获线程
+     */
+    virtual std::shared_ptr<FrameMailbox> subscribe(const std::string& stage,
+                                                    const MailboxOptions& defaults) = 0;
+
+    /**
+     * @brief 获取运行统计
+     * @details 默认实现返回空统计
+     */
+    virtual CaptureStats stats() const { return CaptureStats(); }
 }; 
\ No newline at end of file
@@ -0,0 +1,39 @@
+/**
+ * @file color_kernels.h
+ * @brief 捕获端的颜色转换内核
+ * @details 定点运算与OpenCV的COLOR_YUV2BGR_YUYV相同(BT.601有限范围，20位定点)，
+ *          各指令集实现与标量实现逐字节一致
+ */
+
+#pragma once
+#include "kernel_dispatch.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class ColorKernels
+ * @brief 颜色转换内核入口
+ */
+class ColorKernels {
+public:
+    /**
+     * @brief YUYV转打包BGR
+     * @param src 源图像首行
+     * @param src_stride 源图像行字节数
+     * @param dst 目标图像首行
+     * @param dst_stride 目标图像行字节数
+     * @param width 图像宽度(偶数)
+     * @param height 图像高度
+     * @param isa 指令集实现，当前CPU不支持或内核未实现时退回kScalar
+     */
+    static void yuyvToBgr(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                          int width, int height, KernelIsa isa);
+
+    /**
+     * @brief 以分派选定的实现(KernelId::kColor)转换
+     */
+    static void yuyvToBgr(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                          int width, int height) {
+        yuyvToBgr(src, src_stride, dst, dst_stride, width, height, KernelDispatch::select(KernelId::kColor));
+    }
+};
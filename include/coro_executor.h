@@ -0,0 +1,339 @@
+/**
+ * @file coro_executor.h
+ * @brief 基于C++20协程的流水线执行器
+ * @details 流水线各级写成co_await链：等待帧信箱、定时器或文件描述符就绪时挂起，
+ *          就绪时由执行器的工作线程恢复，不轮询、不超时复查。
+ *          GCC 12对while条件中的co_await生成的代码有误，循环写成for(;;)，在循环体内co_await后判断退出
+ */
+
+#pragma once
+#include "frame_mailbox.h"
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct CoroResult
+ * @brief 协程返回值的存放
+ */
+template <typename T>
+struct CoroResult {
+    std::optional<T> value;     ///< 返回值
+
+    void return_value(T v) { value = std::move(v); }
+    T take() { return std::move(*value); }
+};
+
+template <>
+struct CoroResult<void> {
+    void return_void() {}
+    void take() {}
+};
+
+/**
+ * @class CoroTask
+ * @brief 惰性协程任务
+ * @details 创建时不执行，被co_await时才开始，结束后直接切回等待者(对称转移)；
+ *          协程内未捕获的异常在co_await处重新抛出
+ */
+template <typename T = void>
+class CoroTask {
+public:
+    struct promise_type : CoroResult<T> {
+        std::coroutine_handle<> continuation;   ///< 等待本任务的协程
+        std::exception_ptr error;               ///< 未捕获的异常
+
+        /**
+         * @brief 结束时切回等待者
+         */
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                auto next = handle.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        CoroTask get_return_object() {
+            return CoroTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    CoroTask(CoroTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    CoroTask& operator=(CoroTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    CoroTask(const CoroTask&) = delete;
+    CoroTask& operator=(const CoroTask&) = delete;
+
+    ~CoroTask() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+
+    T await_resume() {
+        if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+        return handle_.promise().take();
+    }
+
+private:
+    explicit CoroTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;    ///< 协程帧
+};
+
+/**
+ * @struct ExecutorOptions
+ * @brief 执行器参数
+ */
+struct ExecutorOptions {
+    std::string name;           ///< 名称，用作工作线程名
+    std::string group;          ///< 工作线程的调度隔离组，见ThreadTuning
+    int threads{1};             ///< 工作线程数
+};
+
+/**
+ * @class CoroExecutor
+ * @brief 协程执行器
+ * @details 固定数量的工作线程从就绪队列中恢复协程。就绪队列为空时，其中一个线程在epoll上等待
+ *          文件描述符就绪和最近的定时器到期，其余线程在条件变量上休眠(领导者/跟随者)，
+ *          因此单线程执行器中文件描述符就绪到协程恢复之间没有线程切换。
+ *          stop()取消所有等待中的定时器和文件描述符，被取消的等待返回false或0，协程应据此退出
+ */
+class CoroExecutor {
+public:
+    /**
+     * @brief 构造函数
+     * @param options 执行器参数
+     */
+    explicit CoroExecutor(ExecutorOptions options);
+
+    /**
+     * @brief 析构函数，停止执行器
+     * @details 从未开始执行的独立任务(执行器未启动，或停止后才spawn)在此销毁，释放其中捕获的资源
+     */
+    ~CoroExecutor();
+
+    CoroExecutor(const CoroExecutor&) = delete;
+    CoroExecutor& operator=(const CoroExecutor&) = delete;
+
+    /**
+     * @brief 启动工作线程
+     */
+    void start();
+
+    /**
+     * @brief 取消所有等待，等待已启动的任务全部结束后停止工作线程
+     */
+    void stop();
+
+    /**
+     * @brief 是否正在停止
+     */
+    bool stopping() const;
+
+    /**
+     * @brief 工作线程数
+     */
+    int threads() const { return options_.threads; }
+
+    /**
+     * @brief 在执行器上启动一个独立任务
+     * @details 任务中未捕获的异常被打印后丢弃；stop()等待所有任务结束
+     */
+    void spawn(CoroTask<void> task);
+
+    /**
+     * @brief 将协程放入就绪队列
+     */
+    void post(std::coroutine_handle<> handle);
+
+    /**
+     * @brief 切换到执行器的工作线程继续执行
+     */
+    auto schedule() {
+        struct Awaiter {
+            CoroExecutor* executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor->post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    /**
+     * @brief 挂起到指定时刻
+     * @return 到期返回true，执行器停止而被取消返回false
+     */
+    auto sleepUntil(std::chrono::steady_clock::time_point deadline) {
+        struct Awaiter {
+            CoroExecutor* executor;
+            std::chrono::steady_clock::time_point deadline;
+            bool fired{true};
+            bool await_ready() const { return deadline <= std::chrono::steady_clock::now(); }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return executor->addTimer(deadline, handle, &fired);
+            }
+            bool await_resume() const noexcept { return fired; }
+        };
+        return Awaiter{this, deadline};
+    }
+
+    /**
+     * @brief 挂起指定时长
+     */
+    auto sleepFor(std::chrono::steady_clock::duration duration) {
+        return sleepUntil(std::chrono::steady_clock::now() + duration);
+    }
+
+    /**
+     * @brief 挂起到文件描述符就绪
+     * @param fd 文件描述符，同一时刻只能有一个协程等待
+     * @param events epoll事件掩码(EPOLLIN、EPOLLOUT等)
+     * @return 就绪的事件，执行器停止而被取消时返回0
+     */
+    auto ready(int fd, uint32_t events) {
+        struct Awaiter {
+            CoroExecutor* executor;
+            int fd;
+            uint32_t events;
+            uint32_t revents{0};
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return executor->watch(fd, events, handle, &revents);
+            }
+            uint32_t await_resume() const noexcept { return revents; }
+        };
+        return Awaiter{this, fd, events};
+    }
+
+    /**
+     * @brief 等待帧信箱中的下一帧
+     * @return 帧，信箱关闭或执行器停止时返回nullptr
+     * @details 信箱在生产者投递时写其eventfd，消费者在eventfd上等待；只应由一个协程消费同一个信箱
+     */
+    CoroTask<EncodedFramePtr> receive(FrameMailbox& mailbox);
+
+private:
+    /**
+     * @struct FdWaiter
+     * @brief 等待中的文件描述符
+     */
+    struct FdWaiter {
+        std::coroutine_handle<> handle;     ///< 等待的协程
+        uint32_t* revents;                  ///< 就绪事件的写入位置
+    };
+
+    /**
+     * @struct TimerWaiter
+     * @brief 等待中的定时器
+     */
+    struct TimerWaiter {
+        std::coroutine_handle<> handle;     ///< 等待的协程
+        bool* fired;                        ///< 是否到期的写入位置
+    };
+
+    /**
+     * @brief 独立任务的外层协程，负责计数和异常
+     */
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    Detached run(CoroTask<void> task);
+
+    /**
+     * @brief 独立任务首次进入就绪队列
+     * @details 记录尚未开始执行的任务，析构时销毁其协程帧
+     */
+    struct Launch {
+        CoroExecutor* executor;
+        std::coroutine_handle<> handle;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            executor->launch(h);
+        }
+        void await_resume() { executor->launched(handle); }
+    };
+
+    void launch(std::coroutine_handle<> handle);
+    void launched(std::coroutine_handle<> handle);
+
+    /**
+     * @brief 登记定时器
+     * @return 执行器正在停止时返回false，协程不挂起
+     */
+    bool addTimer(std::chrono::steady_clock::time_point deadline, std::coroutine_handle<> handle, bool* fired);
+
+    /**
+     * @brief 登记文件描述符等待
+     * @return 执行器正在停止或登记失败时返回false，协程不挂起
+     */
+    bool watch(int fd, uint32_t events, std::coroutine_handle<> handle, uint32_t* revents);
+
+    /**
+     * @brief 工作线程函数
+     */
+    void workerLoop();
+
+    /**
+     * @brief 在epoll上等待一轮，将就绪的协程放入队列
+     * @details 调用时持有锁，等待期间释放
+     */
+    void pollOnce(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief 唤醒在epoll上等待的线程
+     */
+    void interruptPoll();
+
+    ExecutorOptions options_;                                   ///< 执行器参数
+    int epoll_fd_{-1};                                          ///< epoll实例
+    int wake_fd_{-1};                                           ///< 唤醒epoll的eventfd
+
+    mutable std::mutex mutex_;                                  ///< 保护以下成员
+    std::condition_variable cv_;                                ///< 跟随者线程等待就绪队列
+    std::deque<std::coroutine_handle<>> ready_;                 ///< 就绪队列
+    std::multimap<std::chrono::steady_clock::time_point, TimerWaiter> timers_;  ///< 按到期时刻排列的定时器
+    std::unordered_map<int, FdWaiter> waiters_;                 ///< 文件描述符→等待者
+    std::unordered_set<void*> unstarted_;                       ///< 已投递但尚未开始执行的独立任务(协程帧地址)
+    bool polling_{false};                                       ///< 是否有线程在epoll上等待
+    int idle_{0};                                               ///< 在条件变量上休眠的线程数
+    int active_{0};                                             ///< 未结束的独立任务数
+    bool started_{false};                                       ///< 是否已启动
+    bool stopping_{false};                                      ///< 是否正在停止
+    std::vector<std::thread> threads_;                          ///< 工作线程
+};
@@ -0,0 +1,42 @@
+/**
+ * @file decode_kernels.h
+ * @brief 推理输出的解码内核
+ * @details 在每个候选框的类别得分中找出最高分及其类别，是输出后处理中唯一随类别数线性增长的部分
+ */
+
+#pragma once
+#include "kernel_dispatch.h"
+#include <cstddef>
+
+/**
+ * @class DecodeKernels
+ * @brief 解码内核入口
+ * @details 得分矩阵以两个步长描述，兼容按框存放([框][类别])和按类别存放([类别][框])两种输出布局；
+ *          前者在类别方向、后者在框方向向量化，其他步长使用标量实现。
+ *          得分相同时取类别号最小者，与std::max_element一致，各实现结果完全相同
+ */
+class DecodeKernels {
+public:
+    /**
+     * @brief 求每个框的最高类别得分
+     * @param scores 第0个框第0个类别的得分
+     * @param boxes 框数
+     * @param classes 类别数
+     * @param box_stride 相邻框的得分间距(以float计)
+     * @param class_stride 相邻类别的得分间距(以float计)
+     * @param best_score 输出，每个框的最高得分
+     * @param best_class 输出，每个框最高得分的类别
+     * @param isa 指令集实现，当前CPU不支持或内核未实现时退回kScalar
+     */
+    static void bestClass(const float* scores, int boxes, int classes, size_t box_stride, size_t class_stride,
+                          float* best_score, int* best_class, KernelIsa isa);
+
+    /**
+     * @brief 以分派选定的实现(KernelId::kDecode)求解
+     */
+    static void bestClass(const float* scores, int boxes, int classes, size_t box_stride, size_t class_stride,
+                          float* best_score, int* best_class) {
+        bestClass(scores, boxes, classes, box_stride, class_stride, best_score, best_class,
+                  KernelDispatch::select(KernelId::kDecode));
+    }
+};
@@ -0,0 +1,146 @@
+/**
+ * @file detection_store.h
+ * @brief 检测结果持久化存储
+ * @details 只追加、内存映射的列式日志，附带稀疏时间索引，支持按时间范围快速扫描
+ */
+
+#pragma once
+#include "frame_protocol.h"
+#include <Poco/JSON/Object.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct DetectionRecord
+ * @brief 一条持久化的检测记录
+ */
+struct DetectionRecord {
+    int64_t timestamp_us{0};   ///< 帧采集时间(Unix纪元微秒)
+    uint16_t camera{0};        ///< 摄像头编号
+    uint16_t class_id{0};      ///< 类别ID
+    float confidence{0.0f};    ///< 置信度
+    int16_t x{0};              ///< 目标框左上角x
+    int16_t y{0};              ///< 目标框左上角y
+    int16_t width{0};          ///< 目标框宽度
+    int16_t height{0};         ///< 目标框高度
+    uint32_t track_id{0};      ///< 跟踪ID，0表示未跟踪
+};
+
+/**
+ * @struct DetectionCursor
+ * @brief 扫描位置
+ * @details 由分段ID和分段内行号组成，用于分页查询时从上次结束处继续
+ */
+struct DetectionCursor {
+    int64_t segment{0};   ///< 分段ID(分段创建时间)
+    uint64_t row{0};      ///< 分段内行号
+};
+
+/**
+ * @struct DetectionQuery
+ * @brief 扫描条件
+ */
+struct DetectionQuery {
+    int64_t from_us{0};                 ///< 起始时间(含)
+    int64_t to_us{INT64_MAX};           ///< 结束时间(不含)
+    int camera{-1};                     ///< 摄像头编号，-1表示全部
+    int class_id{-1};                   ///< 类别ID，-1表示全部
+    float min_confidence{0.0f};         ///< 最低置信度
+};
+
+/**
+ * @struct DetectionStoreOptions
+ * @brief 存储参数
+ * @details 对应配置文件中的"detections"节
+ */
+struct DetectionStoreOptions {
+    std::string directory{"data/detections"};   ///< 存储目录
+    uint32_t segment_rows{1u << 22};            ///< 每个分段的行数
+    int retention_days{30};                     ///< 保留天数，超期的分段整体删除
+    bool enabled{true};                         ///< 是否启用
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段保持默认值
+     * @param json "detections"配置节，可以为空
+     */
+    static DetectionStoreOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class DetectionStore
+ * @brief 检测结果存储
+ * @details 数据按固定行数分段，每个分段是一个预先分配大小并整体映射的文件：
+ *          页对齐的文件头之后依次为块索引和各列数组。追加一行只是向各列写入一个值，
+ *          再以release语义发布行数，没有系统调用；落盘由内核页回写完成。
+ *          块索引记录每4096行的最小/最大时间，扫描时整块跳过不相交的区间，
+ *          只读取命中块中需要的列。读者不加锁，只读取已发布的行。
+ */
+class DetectionStore {
+public:
+    /// 记录访问函数，返回false时停止扫描
+    using Visitor = std::function<bool(const DetectionRecord& record, const DetectionCursor& next)>;
+
+    /**
+     * @brief 构造函数
+     * @param options 存储参数
+     */
+    explicit DetectionStore(DetectionStoreOptions options);
+
+    /**
+     * @brief 析构函数
+     */
+    ~DetectionStore();
+
+    DetectionStore(const DetectionStore&) = delete;
+    DetectionStore& operator=(const DetectionStore&) = delete;
+
+    /**
+     * @brief 打开存储目录并映射已有分段
+     * @return 是否成功
+     */
+    bool open();
+
+    /**
+     * @brief 追加一次检测的全部结果
+     * @param camera 摄像头编号
+     * @param detections 检测结果
+     * @return 是否成功
+     */
+    bool append(uint16_t camera, const DetectionSet& detections);
+
+    /**
+     * @brief 按条件扫描记录
+     * @param query 扫描条件
+     * @param visitor 对每条命中的记录调用，附带下一条记录的扫描位置
+     * @param start 起始扫描位置，默认为最早的记录
+     * @details 按写入顺序返回，同一摄像头内即时间顺序
+     */
+    void scan(const DetectionQuery& query, const Visitor& visitor,
+              const DetectionCursor& start = DetectionCursor()) const;
+
+    /**
+     * @brief 删除超过保留期的分段
+     */
+    void applyRetention();
+
+    /**
+     * @brief 已存储的记录总数
+     */
+    uint64_t recordCount() const;
+
+private:
+    class Segment;
+
+    /**
+     * @brief 创建新分段作为写入分段
+     */
+    bool createSegment(int64_t id);
+
+    DetectionStoreOptions options_;                   ///< 存储参数
+    mutable std::mutex mutex_;                        ///< 保护分段列表和写入
+    std::vector<std::shared_ptr<Segment>> segments_;  ///< 分段列表，按ID升序
+};
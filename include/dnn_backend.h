@@ -0,0 +1,33 @@
+/**
+ * @file dnn_backend.h
+ * @brief OpenCV DNN推理后端
+ * @details 仅在OpenCV包含dnn模块时编译(USE_OPENCV_DNN)
+ */
+
+#pragma once
+#include "inference_backend.h"
+#include <opencv2/dnn.hpp>
+#include <mutex>
+#include <string>
+
+/**
+ * @class DnnBackend
+ * @brief OpenCV DNN推理后端
+ * @details cv::dnn::Net不能被多个线程同时执行，run()在内部串行化；
+ *          输入尺寸是否可变按ONNX模型声明的输入维度判断，与ONNX Runtime后端一致。线程数由OpenCV全局线程池决定
+ */
+class DnnBackend : public InferenceBackend {
+public:
+    std::string name() const override { return "opencv"; }
+    void load(const std::string& path) override;
+    bool dynamicInput() const override { return dynamic_; }
+    cv::Size inputSize() const override { return input_size_; }
+    std::unique_ptr<InferenceBinding> bind(const cv::Size& input_size) override;
+    void run(InferenceBinding& binding) override;
+
+private:
+    std::mutex mutex_;      ///< 串行化forward
+    cv::dnn::Net net_;      ///< 网络
+    bool dynamic_{false};   ///< 模型输入尺寸是否可变
+    cv::Size input_size_;   ///< 固定输入尺寸
+};
@@ -0,0 +1,165 @@
+/**
+ * @file event_recorder.h
+ * @brief 检测事件触发的短片录像
+ * @details 内存中始终保留最近若干秒的已编码帧，检测规则命中时把事件前后的画面写成短片
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "frame_protocol.h"
+#include "frame_ring.h"
+#include "avi_writer.h"
+#include "runtime_config.h"
+#include <Poco/JSON/Object.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct EventRule
+ * @brief 事件触发规则
+ * @details 类别、置信度和区域同时满足时触发
+ */
+struct EventRule {
+    int class_id{-1};          ///< 类别ID，-1表示不按ID匹配
+    std::string label;         ///< 类别名称，为空表示不按名称匹配
+    float min_confidence{0.5f}; ///< 最低置信度
+    cv::Rect zone;             ///< 目标框中心须位于该区域内，为空表示整帧
+
+    /**
+     * @brief 判断检测结果是否命中规则
+     */
+    bool matches(const DetectionResult& det) const;
+};
+
+/**
+ * @struct EventOptions
+ * @brief 事件录像参数
+ * @details 对应配置文件中的"events"节
+ */
+struct EventOptions {
+    std::string directory{"events"};   ///< 短片目录
+    int pre_seconds{5};                ///< 事件前保留时长(秒)
+    int post_seconds{5};               ///< 最后一次触发后继续录制的时长(秒)
+    size_t buffer_bytes{64 << 20};     ///< 事件前缓冲的内存上限
+    uint64_t quota_bytes{1ULL << 30};  ///< 短片目录占用上限
+    std::vector<EventRule> rules;      ///< 触发规则，为空时不启用事件录像
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段保持默认值
+     * @param json "events"配置节，可以为空
+     */
+    static EventOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class EventRecorder
+ * @brief 事件短片录像器
+ * @details 采集线程从捕获端取帧拷贝进FrameRing，写盘线程在事件触发后从环中依次取出
+ *          预录部分和后续帧写入短片。推理线程只做规则匹配并更新触发时间，
+ *          捕获、推理线程都不会因写盘而阻塞；写盘慢于环的覆盖速度时丢失的帧计入统计。
+ */
+class EventRecorder {
+public:
+    /**
+     * @struct Status
+     * @brief 事件录像状态
+     */
+    struct Status {
+        bool active{false};            ///< 是否正在写入短片
+        std::string current_file;      ///< 当前短片文件名
+        uint64_t events{0};            ///< 已触发的事件数
+        uint64_t clips{0};             ///< 已完成的短片数
+        uint64_t frames_written{0};    ///< 已写入的帧数
+        uint64_t frames_lost{0};       ///< 写入前已被环覆盖的帧数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param capture 视频捕获对象
+     * @param config 运行时配置，用于确定短片帧率
+     * @param options 事件录像参数
+     */
+    EventRecorder(std::shared_ptr<CaptureInterface> capture,
+                  std::shared_ptr<RuntimeConfigStore> config,
+                  EventOptions options);
+
+    /**
+     * @brief 析构函数
+     */
+    ~EventRecorder();
+
+    /**
+     * @brief 启动采集和写盘线程
+     * @return 短片目录可用时返回true
+     */
+    bool start();
+
+    /**
+     * @brief 停止线程，正在写入的短片正常收尾
+     */
+    void stop();
+
+    /**
+     * @brief 提交一次检测结果
+     * @param detections 检测结果
+     * @details 在推理线程中调用，仅做规则匹配和更新触发时间
+     */
+    void onDetections(const DetectionSet& detections);
+
+    /**
+     * @brief 获取事件录像状态
+     */
+    Status status() const;
+
+    /**
+     * @brief 将状态转换为JSON对象
+     */
+    static Poco::JSON::Object toJson(const Status& status);
+
+private:
+    /**
+     * @brief 采集线程函数，把新帧拷贝进环形缓冲
+     */
+    void ingestLoop();
+
+    /**
+     * @brief 写盘线程函数
+     */
+    void writerLoop();
+
+    /**
+     * @brief 打开新短片
+     */
+    bool openClip(const FrameRing::FrameInfo& first, const std::string& label);
+
+    /**
+     * @brief 关闭当前短片并执行配额检查
+     */
+    void closeClip();
+
+    std::shared_ptr<CaptureInterface> capture_;     ///< 视频捕获对象
+    std::shared_ptr<RuntimeConfigStore> config_;    ///< 运行时配置
+    EventOptions options_;                          ///< 事件录像参数
+    FrameRing ring_;                                ///< 事件前帧缓冲
+    AviWriter writer_;                              ///< 当前短片，仅写盘线程访问
+    std::chrono::system_clock::time_point clip_start_;  ///< 当前短片起始时间
+    std::thread ingest_thread_;                     ///< 采集线程
+    std::thread writer_thread_;                     ///< 写盘线程
+    std::atomic<bool> running_{false};              ///< 运行标志
+
+    mutable std::mutex mutex_;                      ///< 保护以下触发状态和统计
+    std::condition_variable cv_;                    ///< 新帧或新事件通知
+    bool triggered_{false};                         ///< 是否有未结束的事件
+    std::chrono::system_clock::time_point event_start_;  ///< 事件首次触发的帧时间
+    std::chrono::system_clock::time_point event_end_;    ///< 事件结束时间(最后一次触发加后续时长)
+    std::string event_label_;                       ///< 首次触发的类别名称
+    uint64_t latest_sequence_{0};                   ///< 环中最新的帧序号
+    Status status_;                                 ///< 状态统计
+};
@@ -1,7 +1,7 @@
 #pragma once
 #include "capture_interface.h"
+#include "frame_mailbox.h"
 #include <thread>
-#include <mutex>
 #include <atomic>
 
 extern "C" {
@@ -19,6 +19,9 @@ public:
     bool start(int device_id = 0) override;
     void stop() override;
     std::string getLatestFrame() override;
+    EncodedFramePtr getLatestEncodedFrame() override;
+    std::shared_ptr<FrameMailbox> subscribe(const std::string& stage,
+                                            const MailboxOptions& defaults) override;
 
 private:
     void captureLoop();
@@ -29,7 +32,7 @@ private:
     int video_stream_index_{-1};
     
     std::thread capture_thread_;
-    std::mutex frame_mutex_;
     std::atomic<bool> running_{false};
-    std::string latest_frame_;
+    EncodedFramePtr latest_frame_;
+    FrameFanout fanout_;
 }; 
\ No newline at end of file
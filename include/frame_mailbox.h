@@ -0,0 +1,208 @@
+/**
+ * @file frame_mailbox.h
+ * @brief 流水线各级之间的帧信箱
+ * @details 捕获端向每个下游级(推流、缩放档位、推理、录像)各投递一个信箱，
+ *          投递和取出都不加锁，下游处理再慢也不会阻塞捕获
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include <Poco/JSON/Object.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct MailboxOptions
+ * @brief 信箱的丢帧策略
+ */
+struct MailboxOptions {
+    MailboxPolicy policy{MailboxPolicy::kLatest};   ///< 丢帧策略
+    size_t depth{1};                                ///< 队列深度，仅kQueue策略有效
+
+    /**
+     * @brief 从JSON对象解析
+     * @details 格式为{"policy": "latest"}或{"policy": "queue", "depth": 8}，队列深度默认为4
+     */
+    static MailboxOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @struct PipelineOptions
+ * @brief 各级信箱的配置
+ * @details 配置文件中的"pipeline"段，键为级名称(broadcast、simulcast、detection、recorder、event-ring)
+ */
+struct PipelineOptions {
+    std::map<std::string, MailboxOptions> stages;   ///< 级名称 → 信箱配置
+
+    /**
+     * @brief 从JSON对象解析
+     */
+    static PipelineOptions fromJson(const Poco::JSON::Object::Ptr& json);
+
+    /**
+     * @brief 取指定级的信箱配置，未配置时返回defaults
+     */
+    MailboxOptions forStage(const std::string& stage, MailboxOptions defaults) const;
+};
+
+/**
+ * @class FrameMailbox
+ * @brief 单生产者单消费者的帧信箱
+ * @details kLatest策略为三缓冲：生产者写入后台槽并与中间槽交换，消费者取走中间槽的最新帧，
+ *          未被取走就被替换的帧计为丢弃。kQueue策略为定长环形队列，队满时丢弃新帧。
+ *          消费者无帧可取时在futex(线程消费者)或eventfd(协程消费者)上休眠，
+ *          生产者仅在有消费者休眠时才发起唤醒系统调用
+ */
+class FrameMailbox {
+public:
+    /**
+     * @brief 构造函数
+     * @param stage 级名称，用于统计
+     * @param options 丢帧策略
+     */
+    FrameMailbox(std::string stage, MailboxOptions options);
+
+    /**
+     * @brief 析构函数，关闭eventfd
+     */
+    ~FrameMailbox();
+
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    /**
+     * @brief 投递一帧(仅生产者线程调用)
+     * @return 队满丢弃新帧时返回false
+     */
+    bool push(EncodedFramePtr frame);
+
+    /**
+     * @brief 取出一帧(仅消费者线程调用)
+     * @param timeout 无帧时的最长等待时间
+     * @return 帧，超时或信箱已关闭时返回nullptr
+     */
+    EncodedFramePtr pop(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 不等待地取出一帧(仅消费者线程调用)
+     * @return 帧，无帧时返回nullptr
+     */
+    EncodedFramePtr tryPop();
+
+    /**
+     * @brief 声明以eventfd等待新帧(仅消费者调用)，供协程消费者在执行器上等待
+     * @return 可等待的eventfd；已有新帧或信箱已关闭时返回-1，应直接再取
+     * @details 首次调用时创建eventfd，此后生产者唤醒消费者时写eventfd而不是futex；
+     *          返回非负值时，等待结束后须调用endWait
+     */
+    int beginWait();
+
+    /**
+     * @brief 结束eventfd等待，清除eventfd计数
+     */
+    void endWait();
+
+    /**
+     * @brief 关闭信箱，唤醒等待中的消费者，此后的投递被忽略
+     * @details 可在任意线程调用；消费者退出时关闭信箱即取消订阅
+     */
+    void close();
+
+    /**
+     * @brief 是否已关闭
+     */
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 获取运行统计
+     */
+    MailboxStats stats() const;
+
+private:
+    /**
+     * @brief 是否有未取走的帧
+     */
+    bool hasFrame() const;
+
+    /**
+     * @brief 唤醒等待中的消费者
+     */
+    void wake();
+
+    static constexpr uint32_t kFresh = 4;       ///< 中间槽含未取走的帧
+    static constexpr uint32_t kIndexMask = 3;   ///< 槽位序号掩码
+
+    std::string stage_;                         ///< 级名称
+    MailboxOptions options_;                    ///< 丢帧策略
+
+    // kLatest：三缓冲，back_归生产者、front_归消费者，middle_在两者间交换
+    EncodedFramePtr slots_[3];                  ///< 三个槽位
+    std::atomic<uint32_t> middle_{1};           ///< 中间槽序号及kFresh标志
+    uint32_t back_{0};                          ///< 生产者持有的槽位
+    uint32_t front_{2};                         ///< 消费者持有的槽位
+
+    // kQueue：环形队列，tail_只由生产者写、head_只由消费者写
+    std::unique_ptr<EncodedFramePtr[]> ring_;   ///< 队列槽位
+    std::atomic<uint64_t> head_{0};             ///< 下一个取出位置
+    std::atomic<uint64_t> tail_{0};             ///< 下一个写入位置
+
+    std::atomic<uint32_t> signal_{0};           ///< 每次投递递增，消费者在其上futex等待
+    std::atomic<bool> waiting_{false};          ///< 消费者是否在等待
+    std::atomic<bool> closed_{false};           ///< 是否已关闭
+    std::atomic<int> event_fd_{-1};             ///< 协程消费者等待的eventfd，未使用时为-1
+
+    std::atomic<uint64_t> pushed_{0};           ///< 投递次数
+    std::atomic<uint64_t> delivered_{0};        ///< 取出次数
+    std::atomic<uint64_t> dropped_{0};          ///< 丢弃次数
+};
+
+/**
+ * @class FrameFanout
+ * @brief 捕获端向各级信箱分发帧
+ * @details 订阅表写时复制，分发时只做一次原子加载，不与订阅、取消订阅互斥；
+ *          已关闭的信箱在下次订阅时从表中移除
+ */
+class FrameFanout {
+public:
+    FrameFanout();
+
+    /**
+     * @brief 设置各级信箱配置，应在订阅之前调用
+     */
+    void configure(PipelineOptions options);
+
+    /**
+     * @brief 订阅
+     * @param stage 级名称
+     * @param defaults 配置文件未指定时使用的策略
+     */
+    std::shared_ptr<FrameMailbox> subscribe(const std::string& stage, MailboxOptions defaults);
+
+    /**
+     * @brief 向所有未关闭的信箱投递一帧(仅生产者线程调用)
+     */
+    void publish(const EncodedFramePtr& frame);
+
+    /**
+     * @brief 关闭所有信箱
+     */
+    void closeAll();
+
+    /**
+     * @brief 各级信箱的统计
+     */
+    std::vector<MailboxStats> stats() const;
+
+private:
+    using MailboxList = std::vector<std::shared_ptr<FrameMailbox>>;
+
+    std::mutex mutex_;                                  ///< 串行化订阅表的修改
+    PipelineOptions options_;                           ///< 各级信箱配置
+    std::shared_ptr<const MailboxList> mailboxes_;      ///< 订阅表，以原子操作读写
+};
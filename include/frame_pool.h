@@ -0,0 +1,87 @@
+/**
+ * @file frame_pool.h
+ * @brief 帧缓冲池
+ * @details 按协商的图像格式预先分配固定数量的帧，帧的最后一个引用释放后回到池中复用，
+ *          稳态下帧图像、JPEG输出和推流消息都复用槽位中的存储；
+ *          JPEG编码器等第三方库内部的分配不在此列，实际分配次数见AllocStats
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class FramePool
+ * @brief 帧缓冲池
+ * @details 每个槽位包含一个EncodedFrame(BGR图像、JPEG缓冲和推流消息缓冲均已预留容量)
+ *          以及存放shared_ptr控制块的内存，空闲槽位以带版本号的无锁栈管理。
+ *          取出的帧以shared_ptr交给各发送方共享，控制块销毁时槽位自动归还，
+ *          归还可以发生在任意线程(如反应器线程发完最后一个连接之后)。
+ *          池耗尽时退化为堆分配并计数，不阻塞捕获。
+ *          帧内的图像和JPEG缓冲会被下一次复用覆盖，持有者不应在释放帧后继续引用其中的数据。
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    /**
+     * @struct Stats
+     * @brief 运行统计
+     */
+    struct Stats {
+        size_t capacity{0};         ///< 槽位数
+        size_t in_use{0};           ///< 正在使用的槽位数
+        uint64_t acquired{0};       ///< 累计取出次数
+        uint64_t exhausted{0};      ///< 池耗尽退化为堆分配的次数
+    };
+
+    /**
+     * @brief 创建缓冲池
+     * @param slots 槽位数，应覆盖同时在途的帧数(最新帧、推理中、各连接写队列中)
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @param jpeg_capacity 每帧预留的JPEG缓冲大小
+     * @details 槽位的shared_ptr控制块持有池的引用，池在最后一帧释放后才销毁
+     */
+    static std::shared_ptr<FramePool> create(size_t slots, int width, int height, size_t jpeg_capacity);
+
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * @brief 取出一个空闲帧
+     * @return 可写的帧，序号等元数据需由调用方重新填写
+     */
+    std::shared_ptr<EncodedFrame> acquire();
+
+    /**
+     * @brief 获取运行统计
+     */
+    Stats stats() const;
+
+private:
+    struct Slot;
+    template <typename T> class SlotAllocator;
+
+    FramePool(size_t slots, int width, int height, size_t jpeg_capacity);
+
+    /**
+     * @brief 槽位的控制块已销毁，归还到空闲栈
+     */
+    void release(uint32_t index);
+
+    static constexpr uint32_t kNil = UINT32_MAX;   ///< 空栈标记
+
+    std::unique_ptr<Slot[]> slots_;           ///< 槽位数组
+    size_t capacity_;                         ///< 槽位数
+    int width_;                               ///< 图像宽度
+    int height_;                              ///< 图像高度
+    size_t jpeg_capacity_;                    ///< JPEG缓冲预留大小
+    std::atomic<uint64_t> free_head_;         ///< 空闲栈顶：高32位为版本号，低32位为槽位序号
+    std::atomic<size_t> in_use_{0};           ///< 正在使用的槽位数
+    std::atomic<uint64_t> acquired_{0};       ///< 累计取出次数
+    std::atomic<uint64_t> exhausted_{0};      ///< 池耗尽次数
+};
@@ -0,0 +1,63 @@
+/**
+ * @file frame_protocol.h
+ * @brief 紧凑二进制帧消息格式
+ * @details 将检测结果以定长二进制结构置于JPEG数据之前，与图像在同一条WebSocket消息中发送。
+ *          所有多字节字段均为小端序。
+ *
+ * 消息布局:
+ * | 偏移 | 长度 | 字段 |
+ * |------|------|------|
+ * | 0    | 4    | 魔数 "CAMF" |
+ * | 4    | 1    | 版本号 |
+ * | 5    | 1    | 头部长度(字节) |
+ * | 6    | 2    | 检测框数量 |
+ * | 8    | 2    | 图像宽度 |
+ * | 10   | 2    | 图像高度 |
+ * | 12   | 2    | 单个检测框长度(字节) |
+ * | 14   | 2    | 保留 |
+ * | 16   | 8    | 帧序号 |
+ * | 24   | 8    | 帧时间戳(Unix微秒) |
+ * | 32   | 8    | 检测结果对应的帧序号 |
+ * | 40   | 4    | 采集到发送的时延(微秒) |
+ * | 44   | 4    | 驱动帧序号 |
+ * | 48   | N*12 | 检测框: 类别ID(u16) 置信度(u16, 乘65535) x y w h(各i16) |
+ * | ...  | ...  | JPEG数据 |
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "image_processor.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct DetectionSet
+ * @brief 一次检测的完整结果
+ */
+struct DetectionSet {
+    uint64_t frame_sequence{0};               ///< 检测所用帧的序号
+    std::chrono::system_clock::time_point frame_time;  ///< 检测所用帧的采集时间
+    std::vector<DetectionResult> detections;  ///< 检测结果
+};
+
+/**
+ * @class FrameProtocol
+ * @brief 二进制帧消息编码
+ */
+class FrameProtocol {
+public:
+    static constexpr uint8_t kVersion = 2;        ///< 协议版本
+    static constexpr size_t kHeaderSize = 48;     ///< 固定头部长度
+    static constexpr size_t kBoxSize = 12;        ///< 单个检测框长度
+
+    /**
+     * @brief 编码消息前缀(头部和检测框)
+     * @param frame 本条消息携带的帧
+     * @param detections 最近一次检测结果，可为空
+     * @param age 帧从采集到交给发送的时延
+     * @param out 输出的消息前缀，后面直接接JPEG数据；原有内容被覆盖，容量足够时不分配内存
+     */
+    static void encodePrefix(const EncodedFrame& frame, const DetectionSet* detections,
+                             std::chrono::microseconds age, std::string& out);
+};
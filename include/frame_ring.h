@@ -0,0 +1,97 @@
+/**
+ * @file frame_ring.h
+ * @brief 按字节容量限定的已编码帧环形缓冲
+ * @details 为事件录像保存最近若干秒的JPEG帧，内存在构造时一次性分配
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class FrameRing
+ * @brief 已编码帧环形缓冲
+ * @details 帧数据依次拷贝进固定大小的字节区，空间不足时覆盖最早的帧；
+ *          帧描述信息保存在固定长度的描述符数组中。运行期间不再分配内存，
+ *          占用与分辨率和画面复杂度无关，始终等于构造时指定的容量。
+ */
+class FrameRing {
+public:
+    /**
+     * @struct FrameInfo
+     * @brief 缓冲中帧的描述信息
+     */
+    struct FrameInfo {
+        uint64_t sequence{0};                              ///< 帧序号
+        std::chrono::system_clock::time_point wall_time;   ///< 采集时间
+        int width{0};                                      ///< 帧宽度
+        int height{0};                                     ///< 帧高度
+    };
+
+    /**
+     * @brief 构造函数
+     * @param capacity_bytes 字节区容量
+     * @param max_frames 最多保存的帧数
+     */
+    explicit FrameRing(size_t capacity_bytes, size_t max_frames = 1024);
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * @brief 追加一帧
+     * @return 帧大于整个缓冲时返回false
+     */
+    bool push(const EncodedFrame& frame);
+
+    /**
+     * @brief 读取指定序号之后的第一帧
+     * @param after_sequence 起始序号(不含)
+     * @param since 只返回不早于该时间的帧
+     * @param info 输出帧描述
+     * @param jpeg 输出JPEG数据，调用方可复用同一个缓冲
+     * @return 找到时返回true
+     * @details 数据在锁内拷贝出来，调用方写盘期间不阻塞push
+     */
+    bool readNext(uint64_t after_sequence, std::chrono::system_clock::time_point since,
+                  FrameInfo& info, std::string& jpeg) const;
+
+    /**
+     * @brief 缓冲中最早的帧序号，为空时返回0
+     */
+    uint64_t oldestSequence() const;
+
+    /**
+     * @brief 字节区容量
+     */
+    size_t capacity() const { return capacity_; }
+
+private:
+    /**
+     * @struct Slot
+     * @brief 帧描述符
+     */
+    struct Slot {
+        size_t offset{0};   ///< 在字节区中的偏移
+        size_t size{0};     ///< 数据长度
+        FrameInfo info;     ///< 帧描述
+    };
+
+    /**
+     * @brief 丢弃最早的一帧
+     */
+    void popOldest();
+
+    mutable std::mutex mutex_;           ///< 互斥锁
+    std::unique_ptr<uint8_t[]> arena_;   ///< 字节区
+    size_t capacity_;                    ///< 字节区容量
+    std::vector<Slot> slots_;            ///< 描述符环
+    size_t head_{0};                     ///< 最早一帧的描述符下标
+    size_t count_{0};                    ///< 当前帧数
+    size_t write_offset_{0};             ///< 下一帧的写入位置
+};
@@ -0,0 +1,164 @@
+/**
+ * @file h264_streamer.h
+ * @brief H.264实时编码推流
+ * @details 每个摄像头每个档位只编码一次，以分片MP4(fMP4)的形式通过WebSocket推送，
+ *          浏览器用Media Source Extensions直接播放
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "stream_reactor.h"
+#include "runtime_config.h"
+#include <Poco/JSON/Object.h>
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct AVCodec;
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+
+/**
+ * @struct H264Options
+ * @brief H.264推流参数
+ * @details 对应配置文件中的"h264"节
+ */
+struct H264Options {
+    bool enabled{true};                 ///< 是否启用
+    int bitrate_kbps{600};              ///< 目标码率
+    int gop_seconds{2};                 ///< 关键帧最大间隔(秒)
+    std::string encoder;                ///< 指定编码器名称，为空时依次尝试libx264、libopenh264
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段保持默认值
+     * @param json "h264"配置节，可以为空
+     */
+    static H264Options fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class H264Streamer
+ * @brief H.264推流器
+ * @details 由调用方的编码线程逐帧送入图像，仅在有订阅者时编码。编码器使用零延迟参数(无B帧、无前瞻)，
+ *          每帧输出一个moof+mdat分片，经反应器广播给订阅键相同的全部连接，
+ *          编码结果由所有观看者共享。初始化段(ftyp+moov)在编码器打开时生成，
+ *          新观看者加入时先收到初始化段，并请求编码器立即输出关键帧，无需等待下一个GOP。
+ *          同一摄像头的多个推流器(如不同分辨率档位)使用相同的时间零点，观看者在档位间切换时时间轴连续。
+ */
+class H264Streamer {
+public:
+    /**
+     * @brief 构造函数
+     * @param reactor 连接反应器，生命周期须长于推流器
+     * @param stream_key 推流使用的订阅键
+     * @param config 运行时配置，用于确定编码帧率
+     * @param options 推流参数
+     * @param origin 时间戳零点
+     */
+    H264Streamer(StreamReactor* reactor, uint32_t stream_key,
+                 std::shared_ptr<RuntimeConfigStore> config, H264Options options,
+                 std::chrono::system_clock::time_point origin);
+
+    /**
+     * @brief 析构函数
+     */
+    ~H264Streamer();
+
+    H264Streamer(const H264Streamer&) = delete;
+    H264Streamer& operator=(const H264Streamer&) = delete;
+
+    /**
+     * @brief 选择编码器
+     * @return 找到可用的H.264编码器时返回true
+     */
+    bool start();
+
+    /**
+     * @brief 释放编码器
+     * @details 须在编码线程结束后调用
+     */
+    void stop();
+
+    /**
+     * @brief 是否有观看者需要编码输出
+     */
+    bool active() const {
+        return !failed_ && reactor_->subscriberCount(stream_key_) > 0;
+    }
+
+    /**
+     * @brief 编码一帧并广播生成的分片
+     * @param image BGR图像
+     * @param frame 图像所属的帧，提供采集时间和序号
+     * @return 是否成功，失败后推流器停止工作
+     * @details 只能由同一个编码线程调用，图像尺寸变化时自动重新打开编码器。
+     *          每个分片之前发送一条帧信息文本消息，携带帧序号和采集到发送的时延
+     */
+    bool encode(const cv::Mat& image, const EncodedFrame& frame);
+
+    /**
+     * @brief 接管一个观看者连接
+     * @param fd 已完成WebSocket握手的套接字，所有权转移给反应器
+     * @return 连接ID，失败返回0
+     * @details 保证初始化段先于任何媒体分片到达该连接
+     */
+    uint64_t addViewer(int fd);
+
+    /**
+     * @brief 把已有连接切换为本推流器的观看者
+     * @param conn_id 连接ID
+     * @details 顺序保证同addViewer
+     */
+    void attachViewer(uint64_t conn_id);
+
+    /**
+     * @brief 请求下一帧编码为关键帧
+     */
+    void requestKeyframe() { keyframe_requested_ = true; }
+
+private:
+    /**
+     * @brief 按帧尺寸打开编码器和封装器，生成初始化段
+     */
+    bool openEncoder(int width, int height);
+
+    /**
+     * @brief 释放编码器和封装器
+     */
+    void closeEncoder();
+
+    /**
+     * @brief 在持有viewers_mutex_时为新观看者补发初始化段
+     */
+    void greetViewer(uint64_t conn_id);
+
+    StreamReactor* reactor_;                      ///< 连接反应器
+    uint32_t stream_key_;                         ///< 推流订阅键
+    std::shared_ptr<RuntimeConfigStore> config_;  ///< 运行时配置
+    H264Options options_;                         ///< 推流参数
+    std::chrono::system_clock::time_point origin_; ///< 时间戳零点
+    const AVCodec* codec_{nullptr};               ///< 选定的编码器
+    std::atomic<bool> keyframe_requested_{false}; ///< 下一帧强制为关键帧
+    std::atomic<bool> failed_{false};             ///< 编码失败后不再工作
+
+    // 以下编码状态只由编码线程访问
+    AVCodecContext* encoder_{nullptr};            ///< 编码器
+    AVFormatContext* muxer_{nullptr};             ///< fMP4封装器
+    AVFrame* picture_{nullptr};                   ///< 编码输入帧
+    AVPacket* packet_{nullptr};                   ///< 编码输出包
+    std::string output_;                          ///< 封装器写出、尚未取走的数据
+    int width_{0};                                ///< 当前编码宽度
+    int height_{0};                               ///< 当前编码高度
+    int64_t last_pts_{-1};                        ///< 上一帧的时间戳
+
+    std::mutex viewers_mutex_;                    ///< 保证初始化段与观看者加入的顺序
+    std::shared_ptr<const std::string> init_segment_; ///< 当前初始化段，编码器未打开时为空
+    std::vector<uint64_t> pending_viewers_;       ///< 加入时尚无初始化段的连接
+};
@@ -1,77 +1,258 @@
 /**
  * @file image_processor.h
  * @brief 图像处理和目标检测类的定义
- * @details 使用YOLOv8和ONNX Runtime实现目标检测
+ * @details 使用YOLOv8模型实现目标检测，推理由可选的推理后端执行
  */
 
 #pragma once
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <vector>
 #include <string>
-#include <onnxruntime/onnxruntime_cxx_api.h>
+#include <Poco/JSON/Object.h>
+#include "inference_backend.h"
+#include "runtime_config.h"
+#include "tensor_kernels.h"
+#include "coro_executor.h"
 
 /**
  * @struct DetectionResult
  * @brief 目标检测结果结构
  */
 struct DetectionResult {
+    int class_id{-1};       ///< 目标类别ID，对应coco.names中的行号
     std::string label;      ///< 目标类别标签
     float confidence;       ///< 检测置信度
     cv::Rect bbox;         ///< 边界框坐标
+    int track_id{0};       ///< 跟踪ID，0表示未关联到轨迹
+};
+
+/**
+ * @struct ModelOptions
+ * @brief 模型文件配置
+ * @details 固定输入尺寸的模型每个尺寸须单独导出，启动时全部加载，运行中按model_input_size切换
+ */
+struct ModelOptions {
+    std::string path{"models/yolov11n.onnx"};   ///< 主模型文件，输入尺寸可变时可切换到任意边长
+    std::string names{"models/coco.names"};     ///< 类别名称文件
+    std::map<int, std::string> variants;        ///< 预加载的固定尺寸模型，输入边长→模型文件
+    std::string backend{"ort"};                 ///< 推理后端：ort、ort-xnnpack或opencv
+    int threads{1};                             ///< 每次推理使用的线程数
+
+    /**
+     * @brief 从config/camera.json的model节解析，缺省项取默认值
+     */
+    static ModelOptions fromJson(const Poco::JSON::Object::Ptr& json);
 };
 
 /**
  * @class ImageProcessor
  * @brief 图像处理和目标检测类
- * @details 使用YOLOv8模型进行目标检测，支持实时处理视频帧
+ * @details 使用YOLOv8模型进行目标检测，支持实时处理视频帧。
+ *          模型输入边长取自运行时配置的model_input_size：输入尺寸可变的模型直接按该边长推理，
+ *          否则在预加载的固定尺寸模型中选择相同边长、不大于它的最大边长或最小边长的模型
  */
 class ImageProcessor {
 public:
     /**
      * @brief 构造函数
-     * @details 初始化ONNX Runtime环境和加载模型
+     * @param config 运行时配置，为空时使用独立的默认配置
+     * @param options 模型文件配置
+     * @details 创建推理后端并加载模型
      */
-    ImageProcessor();
+    explicit ImageProcessor(std::shared_ptr<RuntimeConfigStore> config = nullptr,
+                            const ModelOptions& options = ModelOptions());
     
     /**
      * @brief 处理单帧图像
      * @param frame OpenCV格式的输入图像
+     * @param raw 同一帧的驱动缓冲，格式受支持时直接从中生成输入张量，省去BGR图像的缩放和重排
      * @return 检测结果数组
+     * @details 检测参数取自运行时配置的最新快照，应由同一个推理线程调用
      */
-    std::vector<DetectionResult> processFrame(const cv::Mat& frame);
+    std::vector<DetectionResult> processFrame(const cv::Mat& frame, const RawFramePtr& raw = nullptr);
     
     /**
      * @brief 设置是否启用检测
      * @param enabled 启用状态
+     * @details 通过运行时配置发布，推理线程在下一帧生效
      */
-    void setDetectionEnabled(bool enabled) { detection_enabled_ = enabled; }
+    void setDetectionEnabled(bool enabled) {
+        config_->update([enabled](RuntimeConfig& c) { c.detection_enabled = enabled; });
+    }
     
     /**
      * @brief 设置检测置信度阈值
      * @param threshold 阈值值(0.0-1.0)
      */
-    void setConfidenceThreshold(float threshold) { confidence_threshold_ = threshold; }
+    void setConfidenceThreshold(float threshold) {
+        config_->update([threshold](RuntimeConfig& c) { c.confidence_threshold = threshold; });
+    }
+
+    /**
+     * @brief 获取运行时配置
+     */
+    std::shared_ptr<RuntimeConfigStore> config() const { return config_; }
+
+    /**
+     * @brief 获取类别名称列表
+     * @return 按类别ID排列的名称
+     */
+    const std::vector<std::string>& classNames() const { return class_names_; }
+
+    /**
+     * @brief 模型和类别名称是否加载成功
+     */
+    bool modelLoaded() const { return model_loaded_; }
+
+    /**
+     * @brief 可切换的模型输入边长
+     * @return 升序排列；主模型输入尺寸可变时包含kStandardSizes
+     */
+    std::vector<int> inputSizes() const;
+
+    /**
+     * @brief 最近一帧实际使用的模型输入边长，尚未推理时为0
+     */
+    int activeInputSize() const { return active_input_size_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 使用的推理后端名称
+     */
+    const std::string& backendName() const { return backend_name_; }
+
+    static constexpr int kStandardSizes[] = {320, 416, 512, 640};  ///< 输入尺寸可变的模型推荐的边长
 
 private:
     /**
-     * @brief 加载模型和配置
+     * @struct ModelSession
+     * @brief 一个已加载的模型
+     */
+    struct ModelSession {
+        std::string path;                           ///< 模型文件
+        std::unique_ptr<InferenceBackend> backend;  ///< 加载了该模型的推理后端
+        bool dynamic{false};                        ///< 模型输入尺寸是否可变
+        cv::Size input_size;                        ///< 固定输入尺寸
+        mutable std::mutex bindings_mutex;          ///< 保护bindings
+        /// 跨帧复用的输入输出绑定，(输入宽, 输入高, 任务槽位)→绑定；同一帧中各分块任务占用不同槽位
+        mutable std::map<std::tuple<int, int, int>, std::unique_ptr<InferenceBinding>> bindings;
+
+        /// 输入边长，用于按尺寸选择模型
+        int edge() const { return std::max(input_size.width, input_size.height); }
+    };
+
+    /**
+     * @brief 加载模型和类别名称
+     */
+    void loadModel(const ModelOptions& options);
+
+    /**
+     * @brief 加载一个模型文件
+     * @param path 模型文件
+     * @param options 推理后端配置
+     * @return 已加载的模型，输入尺寸取自模型本身
      */
-    void loadModel();
+    std::unique_ptr<ModelSession> loadSession(const std::string& path, const ModelOptions& options) const;
+
+    /**
+     * @brief 按请求的输入边长选择模型
+     * @param requested 运行时配置的model_input_size
+     * @param input_size 输出，推理使用的输入尺寸
+     */
+    const ModelSession& selectSession(int requested, cv::Size& input_size) const;
     
     /**
-     * @brief 图像预处理
-     * @param frame 输入图像
-     * @return 预处理后的张量数据
+     * @brief 对整帧中的一个区域执行一次推理
+     * @param model 使用的模型
+     * @param source 整帧图像
+     * @param region 推理区域(整帧或其中的分块)，结果框据此平移
+     * @param input_size 模型输入尺寸
+     * @param confidence_threshold 置信度阈值
+     * @param slot 任务槽位，同一帧中并行的推理使用不同槽位
+     * @return 整帧坐标下的检测结果，未做NMS
+     * @details 预处理由张量内核一次完成，直接写入推理输入张量；只读访问成员，槽位不同时可在多个线程中同时调用
      */
-    std::vector<float> preprocess(const cv::Mat& frame);
+    std::vector<DetectionResult> detect(const ModelSession& model, const TensorSource& source, const cv::Rect& region,
+                                        const cv::Size& input_size, float confidence_threshold, int slot);
+
+    /**
+     * @brief 取出模型在指定输入尺寸和槽位上的绑定，首次使用时创建
+     * @details 输入张量和输出跨帧复用，稳态推理不再分配张量内存
+     */
+    static InferenceBinding& binding(const ModelSession& model, const cv::Size& input_size, int slot);
+
+    /**
+     * @struct TileBatch
+     * @brief 一帧的分块推理任务
+     * @details 各任务结束时递减计数，推理线程等待计数归零后汇总结果
+     */
+    struct TileBatch {
+        std::mutex mutex;                           ///< 保护以下成员
+        std::condition_variable done;               ///< 计数归零时通知
+        size_t remaining{0};                        ///< 未结束的任务数
+        std::exception_ptr error;                   ///< 第一个失败任务的异常
+    };
+
+    /**
+     * @brief 在分块执行器上对一个区域推理
+     * @param results 输出，该区域的检测结果
+     * @details 参数含义同detect()；结束时通知batch，异常记录到batch中由推理线程重新抛出
+     */
+    CoroTask<void> detectTask(const ModelSession& model, const TensorSource& source, cv::Rect region,
+                              cv::Size input_size, float confidence_threshold, int slot,
+                              std::vector<DetectionResult>& results, TileBatch& batch);
+
+    /**
+     * @brief 解析检测输出
+     * @param binding 已执行推理的绑定
+     * @param region 推理区域，结果框据此缩放和平移
+     * @param input_size 模型输入尺寸
+     * @param confidence_threshold 置信度阈值
+     * @param results 输出，追加检测结果
+     * @details 属性数比类别数多5时第5个属性为目标置信度(YOLOv5)，否则只有框坐标和类别得分(YOLOv8/11)；
+     *          框坐标为模型输入像素下的中心点和宽高
+     */
+    void decode(const InferenceBinding& binding, const cv::Rect& region, const cv::Size& input_size,
+                float confidence_threshold, std::vector<DetectionResult>& results) const;
+
+    /**
+     * @brief 规划分块
+     * @param image 检测区域尺寸
+     * @param tile 模型输入尺寸
+     * @param overlap 相邻分块重叠像素数
+     * @param max_tiles 分块数上限
+     * @return 分块区域，检测区域不大于模型输入时为空
+     */
+    static std::vector<cv::Rect> planTiles(const cv::Size& image, const cv::Size& tile,
+                                           int overlap, int max_tiles);
+
+    /**
+     * @brief 按类别的非极大值抑制
+     * @param detections 检测结果，原地保留抑制后的结果
+     * @param sources 每个结果来自的分块编号，为空表示同一来源
+     * @param iou_threshold IoU阈值
+     */
+    static void nonMaxSuppression(std::vector<DetectionResult>& detections,
+                                  const std::vector<int>& sources, float iou_threshold);
+
+    /**
+     * @brief 判断目标框中心是否位于检测区域多边形内
+     * @details 未配置多边形时总是返回true
+     */
+    static bool insideRoiPolygons(const RuntimeConfig& config, const cv::Rect& box);
     
-    std::unique_ptr<Ort::Session> session_;    ///< ONNX会话对象
-    std::unique_ptr<Ort::Env> env_;           ///< ONNX运行环境
+    static constexpr float kNmsIouThreshold = 0.45f;  ///< 非极大值抑制的IoU阈值
+
+    std::string backend_name_;                ///< 推理后端名称
+    std::vector<std::unique_ptr<ModelSession>> sessions_;  ///< 已加载的模型，第一个为主模型
+    std::unique_ptr<CoroExecutor> tile_executor_;  ///< 分块推理执行器，首次分块时创建，分块数增加时重建
     std::vector<std::string> class_names_;    ///< 类别名称列表
-    std::vector<const char*> input_names_;    ///< 模型输入节点名称
-    std::vector<const char*> output_names_;   ///< 模型输出节点名称
-    bool detection_enabled_{true};            ///< 检测启用状态
-    float confidence_threshold_{0.5f};        ///< 置信度阈值
-    const int input_width_{640};              ///< 模型输入宽度
-    const int input_height_{640};             ///< 模型输入高度
+    std::shared_ptr<RuntimeConfigStore> config_; ///< 运行时配置
+    RuntimeConfigReader config_reader_;       ///< 推理线程的配置读取缓存
+    bool model_loaded_{false};                ///< 模型是否加载成功
+    std::atomic<int> active_input_size_{0};   ///< 最近一帧使用的输入边长
 }; 
\ No newline at end of file
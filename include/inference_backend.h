@@ -0,0 +1,123 @@
+/**
+ * @file inference_backend.h
+ * @brief 推理后端接口
+ * @details 把模型加载、输入输出绑定和执行从ImageProcessor中分离，
+ *          同一模型文件可以由ONNX Runtime(CPU、XNNPACK)或OpenCV DNN执行
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @struct OutputLayout
+ * @brief 检测输出的内存布局
+ * @details 输出视为"框×属性"矩阵，属性依次为cx、cy、w、h、[目标置信度]、各类别得分；
+ *          两个步长兼容[1, 属性, 框](YOLOv8/11导出)和[1, 框, 属性](YOLOv5导出)两种排列
+ */
+struct OutputLayout {
+    int boxes{0};                   ///< 候选框数
+    int attributes{0};              ///< 每个框的属性数
+    size_t box_stride{0};           ///< 相邻框的间距(以float计)
+    size_t attribute_stride{0};     ///< 相邻属性的间距(以float计)
+
+    /**
+     * @brief 由输出形状推断布局
+     * @param shape 输出形状，须为[1, a, b]
+     * @return 布局，形状不符时boxes为0
+     * @details 候选框数总是远多于属性数，较长的一维即为框
+     */
+    static OutputLayout fromShape(const std::vector<int64_t>& shape);
+};
+
+/**
+ * @class InferenceBinding
+ * @brief 一次推理的输入输出绑定
+ * @details 由InferenceBackend::bind创建，持有输入张量和run()之后的输出；同一输入尺寸的推理可以反复复用
+ *          同一个绑定，同时进行的推理须使用各自的绑定
+ */
+class InferenceBinding {
+public:
+    virtual ~InferenceBinding() = default;
+
+    /**
+     * @brief NCHW格式的输入缓冲，长度为3×高×宽
+     */
+    virtual float* input() = 0;
+
+    /**
+     * @brief 第一个输出的数据，run()之前为空
+     */
+    virtual const float* output() const = 0;
+
+    /**
+     * @brief 第一个输出的形状
+     */
+    virtual std::vector<int64_t> outputShape() const = 0;
+
+    /**
+     * @brief 第一个输出的布局
+     */
+    virtual OutputLayout outputLayout() const { return OutputLayout::fromShape(outputShape()); }
+};
+
+/**
+ * @class InferenceBackend
+ * @brief 推理后端接口
+ * @details load()之后bind()和run()可以被多个线程同时调用，不能并发执行的后端在内部串行化
+ */
+class InferenceBackend {
+public:
+    virtual ~InferenceBackend() = default;
+
+    /**
+     * @brief 后端名称，与配置中的backend一致
+     */
+    virtual std::string name() const = 0;
+
+    /**
+     * @brief 加载模型
+     * @param path 模型文件
+     * @details 失败时抛出std::runtime_error
+     */
+    virtual void load(const std::string& path) = 0;
+
+    /**
+     * @brief 模型输入尺寸是否可变
+     */
+    virtual bool dynamicInput() const = 0;
+
+    /**
+     * @brief 模型固定输入尺寸，可变时为空
+     */
+    virtual cv::Size inputSize() const = 0;
+
+    /**
+     * @brief 为一次推理分配输入输出
+     * @param input_size 输入尺寸
+     */
+    virtual std::unique_ptr<InferenceBinding> bind(const cv::Size& input_size) = 0;
+
+    /**
+     * @brief 执行推理，输出保存在绑定中
+     * @details 失败时抛出异常
+     */
+    virtual void run(InferenceBinding& binding) = 0;
+
+    /**
+     * @brief 创建后端
+     * @param type 后端名称："ort"(ONNX Runtime CPU)、"ort-xnnpack"(ONNX Runtime XNNPACK)、"opencv"(OpenCV DNN)
+     * @param threads 推理线程数
+     * @return 未知或未编译的后端返回nullptr
+     */
+    static std::unique_ptr<InferenceBackend> create(const std::string& type, int threads);
+
+    /**
+     * @brief 当前构建和运行库支持的后端名称
+     */
+    static std::vector<std::string> available();
+};
@@ -0,0 +1,123 @@
+/**
+ * @file kernel_dispatch.h
+ * @brief 热点内核的运行时指令集分派
+ * @details 启动时检测CPU特性，为每个内核选择受支持的最佳实现，同一个二进制在不同CPU上各取所长；
+ *          可通过配置或环境变量强制指定实现，便于对比测试
+ */
+
+#pragma once
+#include <Poco/JSON/Object.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// 各内核按目标架构编译对应的SIMD实现，是否可用在运行时判断
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL_DISPATCH_X86 1
+#endif
+#if defined(__aarch64__)
+#define KERNEL_DISPATCH_NEON 1
+#endif
+
+/**
+ * @enum KernelIsa
+ * @brief 内核的指令集实现，按优先级从低到高排列
+ */
+enum class KernelIsa {
+    kScalar,    ///< 纯C++实现，所有平台可用，作为其他实现的参照
+    kNeon,      ///< ARM NEON
+    kSse4,      ///< x86 SSE4.1/4.2
+    kAvx2,      ///< x86 AVX2+FMA
+    kAvx512,    ///< x86 AVX-512F/BW
+};
+
+/**
+ * @enum KernelId
+ * @brief 经分派的热点内核
+ */
+enum class KernelId {
+    kColor,         ///< 捕获端YUYV→BGR颜色转换
+    kPreprocess,    ///< 推理输入张量生成
+    kDecode,        ///< 推理输出的类别得分解码
+    kCount,
+};
+
+/**
+ * @struct CpuFeatures
+ * @brief 运行时检测到的CPU特性
+ */
+struct CpuFeatures {
+    bool sse42{false};      ///< x86 SSE4.2
+    bool avx2{false};       ///< x86 AVX2
+    bool fma{false};        ///< x86 FMA3
+    bool avx512f{false};    ///< x86 AVX-512F
+    bool avx512bw{false};   ///< x86 AVX-512BW
+    bool neon{false};       ///< ARM NEON(Advanced SIMD)
+    bool dotprod{false};    ///< ARM点积指令(ASIMDDP)
+
+    /**
+     * @brief 特性名称列表，用于日志和统计
+     */
+    std::vector<std::string> names() const;
+};
+
+/**
+ * @struct KernelOptions
+ * @brief 内核实现的强制选择
+ * @details 配置文件中的"kernels"段，如{"isa": "avx2", "decode": "scalar"}：
+ *          "isa"作用于所有内核，按内核名(color、preprocess、decode)的设置优先；"auto"或缺省表示自动选择。
+ *          环境变量CAMERA_KERNEL_ISA覆盖"isa"
+ */
+struct KernelOptions {
+    std::string isa{"auto"};                        ///< 所有内核的实现
+    std::map<std::string, std::string> kernels;     ///< 内核名 → 实现
+
+    /**
+     * @brief 从JSON对象解析
+     */
+    static KernelOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class KernelDispatch
+ * @brief 内核分派入口
+ * @details 选择结果在设置时一次算出，内核每次调用只做一次原子读取。
+ *          强制指定的实现不受当前CPU或该内核支持时打印警告，退回自动选择
+ */
+class KernelDispatch {
+public:
+    /**
+     * @brief 设置强制选择，应在流水线线程启动前调用
+     */
+    static void configure(const KernelOptions& options);
+
+    /**
+     * @brief 当前CPU的特性
+     */
+    static const CpuFeatures& features();
+
+    /**
+     * @brief 当前CPU是否支持指定实现
+     */
+    static bool supported(KernelIsa isa);
+
+    /**
+     * @brief 内核当前使用的实现
+     */
+    static KernelIsa select(KernelId kernel);
+
+    /**
+     * @brief 内核提供的全部实现(不论当前CPU是否支持)
+     */
+    static std::vector<KernelIsa> variants(KernelId kernel);
+
+    /**
+     * @brief 实现名称
+     */
+    static const char* isaName(KernelIsa isa);
+
+    /**
+     * @brief 内核名称
+     */
+    static const char* kernelName(KernelId kernel);
+};
@@ -0,0 +1,53 @@
+/**
+ * @file latency_histogram.h
+ * @brief 延迟直方图
+ * @details 对数分桶的无锁直方图，记录端只做原子加，可在任意线程读取分位数
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief 延迟直方图
+ * @details 以微秒为单位，每个2的幂区间再均分为4个桶，分位数误差不超过25%。
+ *          记录和读取都不加锁，读取结果是近似一致的快照
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @struct Snapshot
+     * @brief 统计快照
+     */
+    struct Snapshot {
+        uint64_t count{0};      ///< 样本数
+        double mean_us{0};      ///< 平均值(微秒)
+        uint64_t p50_us{0};     ///< 中位数(微秒，取桶上界)
+        uint64_t p99_us{0};     ///< 99分位(微秒，取桶上界)
+        uint64_t max_us{0};     ///< 最大值(微秒)
+    };
+
+    /**
+     * @brief 记录一个样本
+     * @param us 延迟(微秒)，负值按0记录
+     */
+    void record(int64_t us);
+
+    /**
+     * @brief 获取统计快照
+     */
+    Snapshot snapshot() const;
+
+private:
+    static constexpr int kSubBuckets = 4;                    ///< 每个2的幂区间的桶数
+    static constexpr int kBuckets = 40 * kSubBuckets;        ///< 覆盖到约2^40微秒
+
+    static int bucketOf(uint64_t us);
+    static uint64_t upperBound(int bucket);
+
+    std::atomic<uint64_t> buckets_[kBuckets]{};   ///< 各桶计数
+    std::atomic<uint64_t> count_{0};              ///< 样本数
+    std::atomic<uint64_t> sum_us_{0};             ///< 样本总和
+    std::atomic<uint64_t> max_us_{0};             ///< 最大值
+};
@@ -0,0 +1,47 @@
+/**
+ * @file ort_backend.h
+ * @brief ONNX Runtime推理后端
+ * @details 默认的CPU执行提供者，或XNNPACK执行提供者(ARM等平台上通常更快)
+ */
+
+#pragma once
+#include "inference_backend.h"
+#include <onnxruntime/onnxruntime_cxx_api.h>
+#include <memory>
+#include <string>
+
+/**
+ * @class OrtBackend
+ * @brief ONNX Runtime推理后端
+ * @details Session::Run可以被多个线程同时调用，run()不加锁
+ */
+class OrtBackend : public InferenceBackend {
+public:
+    /**
+     * @brief 构造函数
+     * @param xnnpack 是否使用XNNPACK执行提供者
+     * @param threads 推理线程数
+     */
+    OrtBackend(bool xnnpack, int threads);
+
+    std::string name() const override { return xnnpack_ ? "ort-xnnpack" : "ort"; }
+    void load(const std::string& path) override;
+    bool dynamicInput() const override { return dynamic_; }
+    cv::Size inputSize() const override { return input_size_; }
+    std::unique_ptr<InferenceBinding> bind(const cv::Size& input_size) override;
+    void run(InferenceBinding& binding) override;
+
+    /**
+     * @brief 运行库是否包含XNNPACK执行提供者
+     */
+    static bool xnnpackAvailable();
+
+private:
+    bool xnnpack_;                              ///< 是否使用XNNPACK执行提供者
+    int threads_;                               ///< 推理线程数
+    std::unique_ptr<Ort::Session> session_;     ///< ONNX会话对象
+    std::string input_name_;                    ///< 模型输入节点名称
+    std::string output_name_;                   ///< 模型输出节点名称
+    bool dynamic_{false};                       ///< 模型输入尺寸是否可变
+    cv::Size input_size_;                       ///< 固定输入尺寸
+};
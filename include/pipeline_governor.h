@@ -0,0 +1,206 @@
+/**
+ * @file pipeline_governor.h
+ * @brief 流水线负载调节器
+ * @details 周期性测量CPU占用和各级时延，过载时按优先级逐级降低推理帧率、模型输入尺寸、
+ *          编码质量和采集帧率，负载恢复后逐级撤销，保证采集和实时预览不落后
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "latency_histogram.h"
+#include "runtime_config.h"
+#include <Poco/JSON/Object.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct GovernorOptions
+ * @brief 负载调节参数
+ * @details 对应配置文件中的"governor"节
+ */
+struct GovernorOptions {
+    bool enabled{true};                     ///< 是否启用负载调节
+    int interval_ms{1000};                  ///< 测量周期(毫秒)
+    double cpu_high{0.90};                  ///< CPU占用高于此值视为过载
+    double cpu_low{0.70};                   ///< CPU占用低于此值且各级时延正常时视为空闲
+    int send_budget_ms{150};                ///< 采集到发送平均时延上限(毫秒)
+    int inference_budget_ms{1000};          ///< 采集到推理完成平均时延上限(毫秒)
+    double stream_drop_ratio{0.2};          ///< 推流级丢帧比例上限
+    int degrade_periods{2};                 ///< 连续过载多少个周期后降一级
+    int recover_periods{10};                ///< 连续空闲多少个周期后恢复一级
+    std::vector<int> inference_fps{10, 5, 2, 1};   ///< 第一梯队：推理帧率上限，逐级收紧
+    bool model_sizes{true};                 ///< 第二梯队：是否逐级换用更小的模型输入尺寸
+    std::vector<int> jpeg_quality{70, 50};  ///< 第三梯队：JPEG编码质量上限
+    std::vector<int> target_fps{20, 15, 10};   ///< 第四梯队：采集帧率上限
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段保持默认值
+     * @param json "governor"配置节，可以为空
+     */
+    static GovernorOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class PipelineGovernor
+ * @brief 流水线负载调节器
+ * @details 降级动作组成一条有序阶梯，第N级生效前N个动作，通过RuntimeConfigStore::setLimits叠加到用户配置上，
+ *          各级按原有方式读取配置即可生效，用户配置本身不被修改。连续过载时降一级、连续空闲时升一级，
+ *          对当前配置不起作用的动作(如用户已设置更低的值)被跳过。
+ */
+class PipelineGovernor {
+public:
+    /**
+     * @struct Transition
+     * @brief 一次级别变化
+     */
+    struct Transition {
+        int64_t time_ms{0};     ///< 发生时间(Unix毫秒)
+        int from{0};            ///< 原级别
+        int to{0};              ///< 新级别
+        std::string reason;     ///< 原因
+    };
+
+    /**
+     * @struct Status
+     * @brief 调节器状态
+     */
+    struct Status {
+        int level{0};               ///< 当前级别，0表示未降级
+        int levels{0};              ///< 最高级别
+        std::string state;          ///< 最近一个周期的判断：overloaded、idle或steady
+        std::string reason;         ///< 最近一个周期的过载原因
+        double cpu_busy{0};         ///< 最近一个周期的CPU占用(0-1)
+        double capture_ms{0};       ///< 最近一个周期采集到发布的平均时延
+        double send_ms{0};          ///< 最近一个周期采集到发送的平均时延
+        double inference_ms{0};     ///< 最近一个周期采集到推理完成的平均时延
+        RuntimeLimits limits;       ///< 当前生效的限制
+        uint64_t transitions{0};    ///< 级别变化次数
+        std::vector<Transition> history;   ///< 最近的级别变化，按时间先后
+    };
+
+    /**
+     * @brief 构造函数
+     * @param capture 视频捕获对象，提供采集时延和推流丢帧统计
+     * @param config 运行时配置，降级动作以负载限制的形式施加于此
+     * @param send_latency 采集到发送的时延直方图
+     * @param inference_latency 采集到推理完成的时延直方图
+     * @param model_sizes 可切换的模型输入边长
+     * @param options 调节参数
+     * @details 两个直方图须在调节器停止前保持有效
+     */
+    PipelineGovernor(std::shared_ptr<CaptureInterface> capture,
+                     std::shared_ptr<RuntimeConfigStore> config,
+                     const LatencyHistogram* send_latency,
+                     const LatencyHistogram* inference_latency,
+                     std::vector<int> model_sizes,
+                     GovernorOptions options);
+
+    /**
+     * @brief 析构函数
+     */
+    ~PipelineGovernor();
+
+    /**
+     * @brief 启动测量线程
+     */
+    void start();
+
+    /**
+     * @brief 停止测量线程并解除所有限制
+     */
+    void stop();
+
+    /**
+     * @brief 获取调节器状态
+     */
+    Status status() const;
+
+    /**
+     * @brief 将状态转换为JSON对象
+     */
+    static Poco::JSON::Object toJson(const Status& status);
+
+private:
+    /**
+     * @struct Step
+     * @brief 阶梯上的一个降级动作
+     */
+    struct Step {
+        int RuntimeLimits::*field;  ///< 收紧的限制项
+        int value;                  ///< 上限
+    };
+
+    /**
+     * @struct Sample
+     * @brief 累计计数的快照，相邻两次相减得到一个周期的测量值
+     */
+    struct Sample {
+        uint64_t cpu_total{0};                  ///< /proc/stat中的CPU总时间
+        uint64_t cpu_idle{0};                   ///< 其中的空闲和IO等待时间
+        LatencyHistogram::Snapshot capture;     ///< 采集到发布
+        LatencyHistogram::Snapshot send;        ///< 采集到发送
+        LatencyHistogram::Snapshot inference;   ///< 采集到推理完成
+        uint64_t late_dequeues{0};              ///< 捕获线程出队超时次数
+        uint64_t stream_pushed{0};              ///< 推流级收到的帧数
+        uint64_t stream_dropped{0};             ///< 推流级丢弃的帧数
+    };
+
+    /**
+     * @brief 测量线程函数
+     */
+    void run();
+
+    /**
+     * @brief 执行一个测量周期
+     */
+    void evaluate();
+
+    /**
+     * @brief 采集当前的累计计数
+     */
+    Sample sample() const;
+
+    /**
+     * @brief 第level级对应的限制
+     */
+    RuntimeLimits limitsFor(int level) const;
+
+    /**
+     * @brief 两个级别叠加到当前用户配置后的效果是否相同
+     */
+    bool sameEffect(int a, int b) const;
+
+    /**
+     * @brief 切换级别，记录并打印变化
+     */
+    void moveTo(int level, const std::string& reason);
+
+    /**
+     * @brief 限制的可读描述
+     */
+    static std::string describe(const RuntimeLimits& limits);
+
+    static constexpr size_t kHistorySize = 16;  ///< 保留的级别变化记录数
+
+    std::shared_ptr<CaptureInterface> capture_;     ///< 视频捕获对象
+    std::shared_ptr<RuntimeConfigStore> config_;    ///< 运行时配置
+    const LatencyHistogram* send_latency_;          ///< 采集到发送的时延
+    const LatencyHistogram* inference_latency_;     ///< 采集到推理完成的时延
+    GovernorOptions options_;                       ///< 调节参数
+    std::vector<Step> ladder_;                      ///< 降级阶梯，按执行顺序
+
+    Sample previous_;                               ///< 上一周期的累计计数，仅测量线程访问
+    int overloaded_periods_{0};                     ///< 连续过载的周期数，仅测量线程访问
+    int idle_periods_{0};                           ///< 连续空闲的周期数，仅测量线程访问
+
+    mutable std::mutex mutex_;                      ///< 保护status_和running_
+    std::condition_variable cv_;                    ///< 唤醒测量线程退出
+    Status status_;                                 ///< 当前状态
+    bool running_{false};                           ///< 测量线程是否运行
+    std::thread thread_;                            ///< 测量线程
+};
@@ -0,0 +1,210 @@
+/**
+ * @file runtime_config.h
+ * @brief 运行时配置
+ * @details 以不可变快照的形式发布配置，读者无锁获取，写者复制-修改-原子替换(RCU方式)。
+ *          发布的是用户配置叠加负载限制后的生效配置，负载限制解除后自动恢复用户配置
+ */
+
+#pragma once
+#include <opencv2/core.hpp>
+#include <Poco/JSON/Object.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct RuntimeConfig
+ * @brief 可在运行中修改的参数
+ * @details 发布后的实例不再修改，需要变更时复制一份再整体替换
+ */
+struct RuntimeConfig {
+    bool detection_enabled{true};       ///< 是否启用目标检测
+    float confidence_threshold{0.5f};   ///< 检测置信度阈值(0.0-1.0)
+    int target_fps{30};                 ///< 目标帧率，超出部分在捕获端丢弃
+    int inference_fps{0};               ///< 推理帧率上限，0表示不限制
+    int jpeg_quality{90};               ///< JPEG编码质量(1-100)
+    cv::Rect roi;                       ///< 检测区域，为空表示整帧
+    std::vector<std::vector<cv::Point>> roi_polygons;  ///< 检测区域多边形，中心不在任一多边形内的目标被丢弃
+    int model_input_size{640};          ///< 模型输入边长，固定尺寸的模型按此选择预加载的模型
+    bool tiling_enabled{false};         ///< 是否启用分块推理，检测区域大于模型输入时生效
+    int tile_overlap{64};               ///< 相邻分块的重叠像素数(按模型输入尺度)
+    int max_tiles{6};                   ///< 分块数上限，超出时放大分块并缩放后推理
+    bool tile_full_frame{true};         ///< 分块之外是否追加一次整幅缩放推理，用于检测大目标
+};
+
+/// 共享的只读配置快照
+using RuntimeConfigPtr = std::shared_ptr<const RuntimeConfig>;
+
+/**
+ * @struct RuntimeLimits
+ * @brief 负载限制
+ * @details 由负载调节器设置，各字段为对应配置项的上限，0表示不限制
+ */
+struct RuntimeLimits {
+    int inference_fps{0};       ///< 推理帧率上限
+    int model_input_size{0};    ///< 模型输入边长上限
+    int jpeg_quality{0};        ///< JPEG编码质量上限
+    int target_fps{0};          ///< 采集帧率上限
+
+    bool operator==(const RuntimeLimits& other) const {
+        return inference_fps == other.inference_fps && model_input_size == other.model_input_size
+            && jpeg_quality == other.jpeg_quality && target_fps == other.target_fps;
+    }
+    bool operator!=(const RuntimeLimits& other) const { return !(*this == other); }
+};
+
+/**
+ * @class RuntimeConfigStore
+ * @brief 运行时配置的发布点
+ * @details 写操作之间用互斥锁串行化，读操作不加锁。每次发布递增版本号，
+ *          热路径上的读者通过RuntimeConfigReader只比较版本号，配置未变时无需任何同步开销。
+ */
+class RuntimeConfigStore {
+public:
+    /**
+     * @brief 构造函数
+     * @param initial 初始配置
+     */
+    explicit RuntimeConfigStore(const RuntimeConfig& initial = RuntimeConfig());
+
+    /**
+     * @brief 获取当前配置快照
+     * @return 生效配置的快照(已叠加负载限制)，持有期间内容不会改变
+     */
+    RuntimeConfigPtr current() const { return std::atomic_load(&config_); }
+
+    /**
+     * @brief 获取用户配置快照
+     * @return 未叠加负载限制的配置，用于展示和在其基础上修改
+     */
+    RuntimeConfigPtr requested() const { return std::atomic_load(&requested_); }
+
+    /**
+     * @brief 获取当前负载限制
+     */
+    RuntimeLimits limits() const {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return limits_;
+    }
+
+    /**
+     * @brief 设置负载限制并重新发布生效配置
+     * @param limits 新的限制，全部为0表示解除限制
+     */
+    void setLimits(const RuntimeLimits& limits);
+
+    /**
+     * @brief 计算用户配置叠加负载限制后的生效配置
+     */
+    static RuntimeConfig applyLimits(const RuntimeConfig& config, const RuntimeLimits& limits);
+
+    /**
+     * @brief 当前配置版本号
+     * @details 每次发布新配置后递增
+     */
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 修改并发布配置
+     * @param mutate 在用户配置副本上执行的修改函数
+     * @return 发布后的生效配置
+     * @details 修改结果会先经过合法性约束，再叠加负载限制后发布
+     */
+    template <typename F>
+    RuntimeConfigPtr update(F&& mutate) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        auto next = std::make_shared<RuntimeConfig>(*requested());
+        mutate(*next);
+        sanitize(*next);
+        std::atomic_store(&requested_, RuntimeConfigPtr(next));
+        return publish();
+    }
+
+    /**
+     * @brief 应用JSON中出现的字段
+     * @param json 配置对象，字段名与RuntimeConfig成员相同，缺失的字段保持不变
+     * @param error 失败时的错误描述
+     * @return 是否成功
+     */
+    bool applyJson(const Poco::JSON::Object& json, std::string& error);
+
+    /**
+     * @brief 从JSON文件加载初始配置
+     * @param path 配置文件路径
+     * @return 文件存在且解析成功时返回true
+     */
+    bool loadFile(const std::string& path);
+
+    /**
+     * @brief 将配置转换为JSON对象
+     */
+    static Poco::JSON::Object toJson(const RuntimeConfig& config);
+
+private:
+    /**
+     * @brief 把各字段约束到合法范围
+     */
+    static void sanitize(RuntimeConfig& config);
+
+    /**
+     * @brief 把JSON中出现的字段写入配置，缺失的字段保持不变
+     * @return 字段格式错误时返回false，此时配置可能已被部分修改
+     */
+    static bool applyFields(const Poco::JSON::Object& json, RuntimeConfig& config, std::string& error);
+
+    /**
+     * @brief 由用户配置和负载限制生成并发布生效配置，调用者持有write_mutex_
+     */
+    RuntimeConfigPtr publish();
+
+    std::shared_ptr<const RuntimeConfig> config_;   ///< 生效配置快照
+    std::shared_ptr<const RuntimeConfig> requested_; ///< 用户配置快照
+    RuntimeLimits limits_;                          ///< 负载限制，受write_mutex_保护
+    std::atomic<uint64_t> version_{1};              ///< 配置版本号
+    mutable std::mutex write_mutex_;                ///< 写者互斥锁
+};
+
+/**
+ * @brief 读取JSON配置文件
+ * @param path 文件路径
+ * @return 顶层JSON对象，文件不存在或解析失败时为空
+ * @details 配置文件中除运行时配置外的其他节(如"recording")也由此读取
+ */
+Poco::JSON::Object::Ptr loadJsonFile(const std::string& path);
+
+/**
+ * @class RuntimeConfigReader
+ * @brief 单线程使用的配置读取缓存
+ * @details 持有一份快照，每次读取只比较版本号，版本变化时才重新获取快照。
+ *          每个读取线程应使用自己的实例。
+ */
+class RuntimeConfigReader {
+public:
+    /**
+     * @brief 构造函数
+     * @param store 配置发布点
+     */
+    explicit RuntimeConfigReader(std::shared_ptr<RuntimeConfigStore> store)
+        : store_(std::move(store)) {}
+
+    /**
+     * @brief 获取最新配置
+     * @return 配置引用，在下一次调用get()之前有效
+     */
+    const RuntimeConfig& get() {
+        uint64_t version = store_->version();
+        if (!snapshot_ || version != version_) {
+            version_ = version;
+            snapshot_ = store_->current();
+        }
+        return *snapshot_;
+    }
+
+private:
+    std::shared_ptr<RuntimeConfigStore> store_;  ///< 配置发布点
+    RuntimeConfigPtr snapshot_;                  ///< 缓存的快照
+    uint64_t version_{0};                        ///< 快照对应的版本号
+};
@@ -0,0 +1,163 @@
+/**
+ * @file segment_recorder.h
+ * @brief 服务端分段录像
+ * @details 把捕获端已编码的JPEG帧直接封装为MJPEG格式的AVI分段文件，不做重新编码
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "avi_writer.h"
+#include "runtime_config.h"
+#include <Poco/JSON/Object.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @struct RecorderOptions
+ * @brief 录像参数
+ * @details 对应配置文件中的"recording"节
+ */
+struct RecorderOptions {
+    std::string directory{"recordings"};   ///< 录像目录
+    int segment_seconds{60};               ///< 单个分段时长(秒)
+    uint64_t quota_bytes{4ULL << 30};      ///< 录像目录占用上限，超出后删除最早的分段
+    bool enabled{false};                   ///< 启动后是否立即录像
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段保持默认值
+     * @param json "recording"配置节，可以为空
+     */
+    static RecorderOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class SegmentRecorder
+ * @brief 分段录像器
+ * @details 在独立的低优先级线程中等待新帧并顺序写入，捕获线程和广播线程不受磁盘速度影响；
+ *          写盘跟不上时直接跳过中间帧，并以空帧占位保持回放时间轴。
+ *          每个分段按固定时长切换，分段关闭后检查目录占用，超出配额时从最早的分段开始删除。
+ */
+class SegmentRecorder {
+public:
+    /**
+     * @struct Status
+     * @brief 录像状态
+     */
+    struct Status {
+        bool recording{false};          ///< 是否正在录像
+        std::string current_file;       ///< 当前分段文件名
+        uint64_t segments{0};           ///< 已完成的分段数
+        uint64_t frames_written{0};     ///< 已写入的帧数
+        uint64_t frames_skipped{0};     ///< 写盘不及时跳过的帧数
+        uint64_t bytes_written{0};      ///< 已写入的字节数
+        uint64_t disk_usage{0};         ///< 录像目录当前占用(字节)
+    };
+
+    /**
+     * @brief 构造函数
+     * @param capture 视频捕获对象
+     * @param config 运行时配置，用于确定分段帧率
+     * @param options 录像参数
+     */
+    SegmentRecorder(std::shared_ptr<CaptureInterface> capture,
+                    std::shared_ptr<RuntimeConfigStore> config,
+                    RecorderOptions options);
+
+    /**
+     * @brief 析构函数
+     */
+    ~SegmentRecorder();
+
+    /**
+     * @brief 启动录像线程
+     * @return 录像目录可用时返回true
+     */
+    bool start();
+
+    /**
+     * @brief 停止录像线程并关闭当前分段
+     */
+    void stop();
+
+    /**
+     * @brief 开始或停止录像
+     * @details 停止时当前分段在录像线程中正常收尾
+     */
+    void setRecording(bool recording) { recording_ = recording; }
+
+    /**
+     * @brief 是否正在录像
+     */
+    bool isRecording() const { return recording_; }
+
+    /**
+     * @brief 获取录像状态
+     */
+    Status status() const;
+
+    /**
+     * @brief 将录像状态转换为JSON对象
+     */
+    static Poco::JSON::Object toJson(const Status& status);
+
+    /**
+     * @brief 按文件名顺序删除最早的.avi文件，直到目录占用不超过配额
+     * @param directory 目录
+     * @param quota_bytes 配额(字节)
+     * @param keep 不删除的文件名(正在写入的文件)
+     * @return 清理后的目录占用(字节)
+     */
+    static uint64_t pruneDirectory(const std::string& directory, uint64_t quota_bytes,
+                                   const std::string& keep = std::string());
+
+    /**
+     * @brief 生成按时间排序的文件名主干
+     * @return 形如20240101-120000-000的本地时间字符串(精确到毫秒)
+     */
+    static std::string timestampName(std::chrono::system_clock::time_point time);
+
+    /**
+     * @brief 降低当前线程的CPU和IO优先级
+     * @details 用于录像等不应与捕获、推理争抢资源的后台写盘线程
+     */
+    static void lowerThreadPriority();
+
+private:
+    /**
+     * @brief 录像线程函数
+     */
+    void run();
+
+    /**
+     * @brief 以给定帧为起点打开新分段
+     */
+    bool openSegment(const EncodedFrame& frame);
+
+    /**
+     * @brief 关闭当前分段并执行配额检查
+     */
+    void closeSegment();
+
+    /**
+     * @brief 删除最早的分段直到目录占用不超过配额
+     */
+    void enforceQuota();
+
+    std::shared_ptr<CaptureInterface> capture_;       ///< 视频捕获对象
+    std::shared_ptr<RuntimeConfigStore> config_;      ///< 运行时配置
+    RecorderOptions options_;                         ///< 录像参数
+    AviWriter writer_;                                ///< 当前分段，仅录像线程访问
+    std::chrono::system_clock::time_point segment_start_;  ///< 当前分段起始时间
+    int segment_width_{0};                            ///< 当前分段帧宽度
+    int segment_height_{0};                           ///< 当前分段帧高度
+    std::thread thread_;                              ///< 录像线程
+    std::atomic<bool> running_{false};                ///< 线程运行标志
+    std::atomic<bool> recording_{false};              ///< 录像开关
+    mutable std::mutex status_mutex_;                 ///< 状态互斥锁
+    Status status_;                                   ///< 录像状态
+};
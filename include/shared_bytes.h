@@ -0,0 +1,46 @@
+/**
+ * @file shared_bytes.h
+ * @brief 共享所有权的只读字节区间
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @struct SharedBytes
+ * @brief 由所有者保持有效的只读字节区间
+ * @details 区间可以位于字符串、帧内的JPEG缓冲或帧缓冲池槽位中的任意位置，
+ *          持有者共享所有者的引用计数，传递时既不拷贝数据也不另行分配内存
+ */
+struct SharedBytes {
+    std::shared_ptr<const void> owner;  ///< 保持数据有效的所有者
+    const char* data{nullptr};          ///< 数据起始地址
+    size_t size{0};                     ///< 字节数
+
+    SharedBytes() = default;
+    SharedBytes(std::nullptr_t) {}
+
+    /**
+     * @brief 引用一段由owner保持有效的数据
+     */
+    SharedBytes(std::shared_ptr<const void> owner, const void* data, size_t size)
+        : owner(std::move(owner)), data(static_cast<const char*>(data)), size(size) {}
+
+    /**
+     * @brief 引用整个字符串
+     */
+    template <typename T, typename = std::enable_if_t<std::is_convertible_v<T*, const std::string*>>>
+    SharedBytes(std::shared_ptr<T> text) {
+        if (text) {
+            data = text->data();
+            size = text->size();
+            owner = std::move(text);
+        }
+    }
+
+    explicit operator bool() const { return owner != nullptr; }
+};
@@ -0,0 +1,62 @@
+/**
+ * @file snapshot_cache.h
+ * @brief 快照缩放图缓存
+ * @details 为/snapshot.jpg?w=提供按帧序号和宽度索引的缩放JPEG缓存
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "shared_bytes.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class SnapshotCache
+ * @brief 缩放快照的LRU缓存
+ * @details 同一帧的同一宽度只解码、缩放和编码一次，监控系统高频轮询时直接命中缓存。
+ *          帧更新后旧条目不再命中，按最近最少使用原则被替换。
+ */
+class SnapshotCache {
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 最多缓存的缩放图数量
+     */
+    explicit SnapshotCache(size_t capacity = 8);
+
+    /**
+     * @brief 获取指定宽度的快照
+     * @param frame 原始帧
+     * @param width 目标宽度，0或不小于原图宽度时直接返回原始JPEG
+     * @return JPEG数据，原图时直接引用帧内的缓冲；失败返回空
+     */
+    SharedBytes get(const EncodedFramePtr& frame, int width);
+
+    /**
+     * @brief 规范化请求的宽度
+     * @param frame 原始帧
+     * @param width 请求宽度
+     * @return 实际输出宽度，0表示使用原图
+     * @details 宽度向下对齐到8像素，限制缓存条目的种类
+     */
+    static int normalizeWidth(const EncodedFramePtr& frame, int width);
+
+private:
+    /**
+     * @struct Entry
+     * @brief 缓存条目
+     */
+    struct Entry {
+        uint64_t sequence{0};                   ///< 源帧序号
+        int width{0};                           ///< 缩放后宽度
+        SharedBytes jpeg;                       ///< 缩放后的JPEG数据
+        uint64_t last_used{0};                  ///< 最近一次访问的时钟值
+    };
+
+    size_t capacity_;                ///< 缓存容量
+    std::mutex mutex_;               ///< 条目互斥锁
+    std::vector<Entry> entries_;     ///< 缓存条目
+    uint64_t clock_{0};              ///< LRU访问时钟
+};
@@ -0,0 +1,358 @@
+/**
+ * @file stream_reactor.h
+ * @brief 基于epoll的事件驱动连接管理器
+ * @details 少量反应器线程以非阻塞方式服务全部WebSocket和MJPEG推流连接，
+ *          取代每个连接独占一个Poco工作线程的轮询模型
+ */
+
+#pragma once
+#include "shared_bytes.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class StreamReactor
+ * @brief epoll反应器
+ * @details 每个反应器线程拥有独立的epoll实例和eventfd，连接按轮询方式分配给线程，
+ *          之后只由该线程访问。跨线程操作(新增连接、广播)以任务形式投递并通过eventfd唤醒。
+ *          每个连接维护自己的写队列，消息体以共享指针引用，广播时不拷贝帧数据。
+ *          协议帧头存放在消息内，任务队列和写队列的容量只增不减，稳态推流时反应器不分配内存。
+ */
+class StreamReactor {
+public:
+    /**
+     * @brief 连接协议
+     */
+    enum class Protocol {
+        WebSocket,  ///< WebSocket帧
+        Mjpeg       ///< HTTP multipart/x-mixed-replace推流
+    };
+
+    /**
+     * @brief 收到客户端文本/二进制消息时的回调
+     * @details 在反应器线程中调用，实现中不应执行耗时操作
+     */
+    using MessageCallback = std::function<void(uint64_t conn_id, const std::string& message)>;
+
+    /**
+     * @brief WebSocket连接关闭时的回调
+     * @details 在反应器线程中调用，实现中不应执行耗时操作
+     */
+    using CloseCallback = std::function<void(uint64_t conn_id)>;
+
+    /**
+     * @struct Stats
+     * @brief 运行统计
+     */
+    struct Stats {
+        size_t connections{0};          ///< 当前连接数
+        uint64_t messages_sent{0};      ///< 已完整发送的消息数
+        uint64_t bytes_sent{0};         ///< 已发送字节数
+        uint64_t messages_dropped{0};   ///< 因写队列积压而丢弃的消息数
+        uint64_t resyncs{0};            ///< 解码链因积压而跳到下一个同步点的次数
+        uint64_t slow_closed{0};        ///< 写队列超过字节上限而被断开的连接数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param num_threads 反应器线程数
+     * @param max_queued_messages 每个连接允许积压的可丢弃消息数，超出后丢弃最旧的
+     * @param max_queued_bytes 每个连接写队列的字节上限，超出时先丢弃可丢弃消息和解码链，仍超出则断开
+     */
+    explicit StreamReactor(size_t num_threads = 2, size_t max_queued_messages = 4,
+                           size_t max_queued_bytes = 8 * 1024 * 1024);
+
+    /**
+     * @brief 析构函数
+     */
+    ~StreamReactor();
+
+    StreamReactor(const StreamReactor&) = delete;
+    StreamReactor& operator=(const StreamReactor&) = delete;
+
+    /**
+     * @brief 启动反应器线程
+     * @return 是否成功
+     */
+    bool start();
+
+    /**
+     * @brief 停止反应器线程并关闭全部连接
+     */
+    void stop();
+
+    /// WebSocket订阅键的取值上限
+    static constexpr uint32_t kMaxStreamKeys = 32;
+
+    /**
+     * @brief 接管一个已完成握手的WebSocket连接
+     * @param fd 套接字描述符，所有权转移给反应器
+     * @param stream_key 订阅键，广播时只发给订阅键相同的连接，取值小于kMaxStreamKeys
+     * @return 连接ID，失败返回0
+     */
+    uint64_t addWebSocket(int fd, uint32_t stream_key = 0);
+
+    /**
+     * @brief 接管一个已发送HTTP响应头的MJPEG推流连接
+     * @param fd 套接字描述符，所有权转移给反应器
+     * @return 连接ID，失败返回0
+     * @details 之后每帧以multipart分段的形式写出，分段边界为kMjpegBoundary
+     */
+    uint64_t addMjpegStream(int fd);
+
+    /**
+     * @brief 向全部MJPEG推流连接广播一帧
+     * @param jpeg JPEG数据，各连接共享同一份数据
+     * @details 写队列积压时丢弃旧帧，慢速读取方只会跳帧而不会阻塞捕获
+     */
+    void broadcastMjpeg(SharedBytes jpeg);
+
+    /**
+     * @brief 向指定MJPEG推流连接发送一帧
+     * @param conn_id 连接ID
+     * @param jpeg JPEG数据
+     */
+    void sendMjpeg(uint64_t conn_id, SharedBytes jpeg);
+
+    /**
+     * @brief 向WebSocket连接广播一条消息
+     * @param payload 消息内容，各连接共享同一份数据
+     * @param binary true为二进制帧，false为文本帧
+     * @param droppable 写队列积压时是否允许丢弃
+     * @param stream_key 只发给该订阅键的连接
+     */
+    void broadcast(SharedBytes payload, bool binary,
+                   bool droppable = true, uint32_t stream_key = 0);
+
+    /**
+     * @brief 广播解码链上的一条二进制消息
+     * @param payload 消息内容，如fMP4分片
+     * @param sync 是否为同步点(如IDR分片)，解码可从此处开始
+     * @param stream_key 只发给该订阅键的连接
+     * @details 链上的消息依赖之前的消息，不能单独丢弃：某连接积压时丢弃其后的全部消息直到下一个同步点，
+     *          并通过takeResync()请求生产者尽快输出同步点。新连接和切换订阅键的连接从同步点开始接收
+     */
+    void broadcastChain(SharedBytes payload, bool sync, uint32_t stream_key);
+
+    /**
+     * @brief 取出并清除订阅键上的同步点请求
+     * @return 自上次调用以来有连接因积压跳过了解码链时返回true
+     */
+    bool takeResync(uint32_t stream_key) {
+        return stream_key < kMaxStreamKeys && resync_[stream_key].exchange(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 广播一条由前缀和消息体拼成的二进制消息
+     * @param prefix 消息前缀(如帧头和检测框)
+     * @param payload 消息体(如JPEG数据)
+     * @param stream_key 只发给该订阅键的连接
+     * @details 两部分作为同一个WebSocket帧发出，发送时以writev合并，不做拼接拷贝
+     */
+    void broadcastPrefixed(SharedBytes prefix, SharedBytes payload, uint32_t stream_key);
+
+    /// MJPEG推流的multipart分段边界
+    static constexpr const char* kMjpegBoundary = "mjpegframe";
+
+    /**
+     * @brief 向指定连接发送一条消息
+     * @param conn_id 连接ID
+     * @param payload 消息内容
+     * @param binary true为二进制帧，false为文本帧
+     */
+    void send(uint64_t conn_id, SharedBytes payload, bool binary);
+
+    /**
+     * @brief 修改WebSocket连接的订阅键
+     * @param conn_id 连接ID
+     * @param stream_key 新的订阅键，取值小于kMaxStreamKeys
+     * @details 与之前投递给该连接的消息保持顺序：切换前的广播仍按旧键送达，之后的广播按新键送达
+     */
+    void setStreamKey(uint64_t conn_id, uint32_t stream_key);
+
+    /**
+     * @brief 设置消息回调
+     * @details 必须在start()之前调用
+     */
+    void setMessageCallback(MessageCallback callback) { on_message_ = std::move(callback); }
+
+    /**
+     * @brief 设置连接关闭回调
+     * @details 必须在start()之前调用
+     */
+    void setCloseCallback(CloseCallback callback) { on_close_ = std::move(callback); }
+
+    /**
+     * @brief 当前连接数
+     */
+    size_t connectionCount() const { return connection_count_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 指定协议的当前连接数
+     */
+    size_t connectionCount(Protocol protocol) const {
+        return protocol_count_[static_cast<int>(protocol)].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 指定订阅键的WebSocket连接数
+     */
+    size_t subscriberCount(uint32_t stream_key) const {
+        return stream_key < kMaxStreamKeys
+            ? key_count_[stream_key].load(std::memory_order_relaxed) : 0;
+    }
+
+    /**
+     * @brief 获取运行统计
+     */
+    Stats stats() const;
+
+private:
+    /**
+     * @struct OutMessage
+     * @brief 写队列中的一条消息
+     * @details 协议帧头直接存放在消息内，前缀和消息体以共享引用保存，发送时用writev合并，消息体由所有连接共享
+     */
+    struct OutMessage {
+        static constexpr size_t kMaxHeader = 96;     ///< 帧头存储上限，容纳WebSocket帧头和MJPEG分段头
+
+        char header[kMaxHeader]{};                   ///< 协议帧头
+        uint8_t header_size{0};                      ///< 帧头字节数
+        SharedBytes prefix;                          ///< 消息前缀，可为空
+        SharedBytes payload;                         ///< 消息体，可为空
+        uint32_t stream_key{0};                      ///< 广播目标订阅键
+        bool droppable{true};                        ///< 是否允许丢弃
+        bool chain{false};                           ///< 是否属于解码链，见broadcastChain()
+        bool sync{false};                            ///< 是否为解码链的同步点
+        size_t size() const { return header_size + prefix.size + payload.size; }
+    };
+
+    /**
+     * @class MessageQueue
+     * @brief 连接的写队列
+     * @details 环形缓冲，容量按需翻倍且不收缩，稳态下入队和出队不分配内存；
+     *          移出的槽位立即重置，不再持有帧数据的引用
+     */
+    class MessageQueue {
+    public:
+        bool empty() const { return size_ == 0; }
+        size_t size() const { return size_; }
+        OutMessage& operator[](size_t i) { return slots_[(head_ + i) & (slots_.size() - 1)]; }
+        const OutMessage& operator[](size_t i) const { return slots_[(head_ + i) & (slots_.size() - 1)]; }
+        OutMessage& front() { return (*this)[0]; }
+        void push_back(OutMessage message);
+        void pop_front();
+        void erase(size_t i);
+        void clear();
+
+    private:
+        std::vector<OutMessage> slots_;     ///< 槽位，数量为2的幂
+        size_t head_{0};                    ///< 队首槽位
+        size_t size_{0};                    ///< 消息数
+    };
+
+    /**
+     * @struct Connection
+     * @brief 单个连接的状态，只由所属反应器线程访问
+     */
+    struct Connection {
+        uint64_t id{0};                 ///< 连接ID
+        int fd{-1};                     ///< 套接字描述符
+        Protocol protocol{Protocol::WebSocket}; ///< 连接协议
+        uint32_t stream_key{0};         ///< WebSocket订阅键
+        MessageQueue queue;             ///< 待发送消息队列
+        size_t queued_bytes{0};         ///< 写队列中消息的总字节数
+        size_t front_offset{0};         ///< 队首消息已发送的字节数
+        bool awaiting_sync{true};       ///< 解码链等待下一个同步点，期间丢弃链上的其他消息
+        bool want_write{false};         ///< 是否已注册EPOLLOUT
+        bool closing{false};            ///< 写完队列后关闭
+        bool dead{false};               ///< 已关闭，等待回收
+        std::string read_buffer;        ///< 未解析完的输入数据
+        std::string fragments;          ///< 分片消息的累积内容
+        bool fragments_binary{false};   ///< 分片消息的类型
+    };
+
+    /**
+     * @struct Task
+     * @brief 投递给反应器线程的跨线程任务
+     * @details 以值类型保存在预留容量的数组中，投递时不构造std::function，也不分配内存
+     */
+    struct Task {
+        /**
+         * @brief 任务类型
+         */
+        enum class Kind {
+            Add,        ///< 接管新连接
+            Broadcast,  ///< 广播消息给同协议(和同订阅键)的连接
+            Send,       ///< 发送消息给指定连接
+            SetKey      ///< 修改连接的订阅键
+        };
+
+        Kind kind{Kind::Add};                   ///< 任务类型
+        uint64_t conn_id{0};                    ///< 目标连接ID
+        int fd{-1};                             ///< 新连接的套接字描述符
+        Protocol protocol{Protocol::WebSocket}; ///< 连接协议
+        uint32_t stream_key{0};                 ///< 订阅键
+        OutMessage message;                     ///< 待发送的消息
+    };
+
+    /**
+     * @struct Loop
+     * @brief 单个反应器线程的状态
+     */
+    struct Loop {
+        int epoll_fd{-1};                                        ///< epoll实例
+        int event_fd{-1};                                        ///< 任务唤醒描述符
+        std::thread thread;                                      ///< 反应器线程
+        std::mutex task_mutex;                                   ///< 任务队列互斥锁
+        std::vector<Task> tasks;                                 ///< 待执行的跨线程任务
+        std::vector<Task> running;                               ///< 正在执行的任务，与tasks交换以保留两者的容量
+        std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections; ///< 本线程的连接
+        std::vector<uint64_t> dead;                              ///< 已关闭待回收的连接
+    };
+
+    uint64_t addConnection(int fd, Protocol protocol, uint32_t stream_key);
+    void broadcastMessage(Protocol protocol, OutMessage message);
+    void sendMessage(uint64_t conn_id, OutMessage message);
+    static OutMessage makeMjpegPart(SharedBytes jpeg);
+    void run(Loop& loop);
+    void post(Loop& loop, Task task);
+    void runTasks(Loop& loop);
+    void runTask(Loop& loop, Task& task);
+    void handleReadable(Loop& loop, Connection& conn);
+    bool parseFrames(Loop& loop, Connection& conn);
+    void enqueue(Loop& loop, Connection& conn, OutMessage message);
+    size_t pendingCount(const Connection& conn, bool chain) const;
+    bool purge(Connection& conn, bool droppable, bool chain);
+    void skipToSync(Connection& conn);
+    void flush(Loop& loop, Connection& conn);
+    void updateInterest(Loop& loop, Connection& conn, bool want_write);
+    void closeConnection(Loop& loop, Connection& conn);
+    void reap(Loop& loop);
+
+    static void setFrameHeader(OutMessage& message, uint8_t opcode, size_t payload_size);
+
+    std::vector<std::unique_ptr<Loop>> loops_;       ///< 反应器线程
+    size_t max_queued_messages_;                     ///< 每连接可积压的可丢弃消息数
+    size_t max_queued_bytes_;                        ///< 每连接写队列的字节上限
+    MessageCallback on_message_;                     ///< 消息回调
+    CloseCallback on_close_;                         ///< 连接关闭回调
+    std::atomic<bool> running_{false};               ///< 运行状态标志
+    std::atomic<uint64_t> next_id_{1};               ///< 下一个连接序号
+    std::atomic<size_t> connection_count_{0};        ///< 当前连接数
+    std::atomic<size_t> protocol_count_[2]{};        ///< 各协议的连接数
+    std::atomic<size_t> key_count_[kMaxStreamKeys]{}; ///< 各订阅键的WebSocket连接数
+    std::atomic<uint64_t> messages_sent_{0};         ///< 已发送消息数
+    std::atomic<uint64_t> bytes_sent_{0};            ///< 已发送字节数
+    std::atomic<uint64_t> messages_dropped_{0};      ///< 已丢弃消息数
+    std::atomic<uint64_t> resyncs_{0};               ///< 解码链跳到同步点的次数
+    std::atomic<uint64_t> slow_closed_{0};           ///< 因写队列超限断开的连接数
+    std::atomic<bool> resync_[kMaxStreamKeys]{};     ///< 各订阅键上待处理的同步点请求
+};
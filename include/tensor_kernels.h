@@ -0,0 +1,80 @@
+/**
+ * @file tensor_kernels.h
+ * @brief 从原始图像直接生成模型输入张量的内核
+ * @details 一次遍历完成颜色转换、双线性缩放、归一化和CHW重排，直接写入推理输入张量，
+ *          不生成中间的BGR图像、缩放图像和浮点图像
+ */
+
+#pragma once
+#include "capture_interface.h"
+#include "kernel_dispatch.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum TensorFormat
+ * @brief 内核支持的源图像格式
+ */
+enum class TensorFormat {
+    kBGR,       ///< 打包BGR，即捕获端转换后或MJPEG解码后的图像
+    kYUYV,      ///< 打包YUV 4:2:2
+    kNV12,      ///< Y平面加交错UV平面的YUV 4:2:0
+};
+
+/**
+ * @struct TensorSource
+ * @brief 源图像视图，不持有数据
+ */
+struct TensorSource {
+    TensorFormat format{TensorFormat::kBGR};    ///< 像素格式
+    const uint8_t* data{nullptr};               ///< 首行数据(NV12为Y平面)
+    size_t stride{0};                           ///< 行字节数
+    const uint8_t* uv{nullptr};                 ///< NV12的UV平面
+    size_t uv_stride{0};                        ///< NV12的UV平面行字节数
+    int width{0};                               ///< 图像宽度
+    int height{0};                              ///< 图像高度
+
+    /**
+     * @brief 由BGR图像构造
+     */
+    static TensorSource fromBgr(const cv::Mat& image);
+
+    /**
+     * @brief 由驱动缓冲构造
+     * @return 像素格式不受支持时format为kBGR且data为空
+     */
+    static TensorSource fromRaw(const RawFrame& raw);
+
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+};
+
+/**
+ * @class TensorKernels
+ * @brief 张量内核入口
+ * @details 按源格式和目标尺寸模板特化：320/416/512/640的正方形输入使用编译期尺寸的特化，
+ *          其他尺寸使用运行时尺寸的通用版本。输出为1×3×H×W的平面浮点张量，像素值归一化到[0,1]，
+ *          通道顺序与ImageProcessor原有预处理一致(B、G、R)。缩放与cv::resize(INTER_LINEAR)取样位置相同，
+ *          与"cvtColor→resize→convertTo→CHW"参照实现的差异在量化误差以内
+ */
+class TensorKernels {
+public:
+    /**
+     * @brief 转换源图像的一个区域
+     * @param source 源图像
+     * @param region 源图像中的区域，须位于图像范围内
+     * @param size 目标张量的宽高
+     * @param dst 输出，至少3×size.area()个float
+     * @param isa 指令集实现，当前CPU不支持或内核未实现时退回kScalar
+     * @return 参数无效时返回false
+     */
+    static bool convert(const TensorSource& source, const cv::Rect& region, const cv::Size& size,
+                        float* dst, KernelIsa isa);
+
+    /**
+     * @brief 以分派选定的实现(KernelId::kPreprocess)转换
+     */
+    static bool convert(const TensorSource& source, const cv::Rect& region, const cv::Size& size, float* dst) {
+        return convert(source, region, size, dst, KernelDispatch::select(KernelId::kPreprocess));
+    }
+};
@@ -0,0 +1,73 @@
+/**
+ * @file thread_tuning.h
+ * @brief 流水线线程的调度策略
+ * @details 按隔离组为线程设置名称、CPU亲和性、实时优先级或nice值，
+ *          使捕获等时间敏感的线程不受推理负载影响
+ */
+
+#pragma once
+#include <Poco/JSON/Object.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ThreadPolicy
+ * @brief 一个隔离组的调度策略
+ */
+struct ThreadPolicy {
+    std::vector<int> cpus;          ///< 允许运行的CPU编号，为空表示不限制
+    int realtime_priority{0};       ///< SCHED_FIFO优先级(1-99)，0表示普通调度
+    int nice{0};                    ///< 普通调度下的nice值(-20到19)，0表示不修改
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段使用默认值
+     */
+    static ThreadPolicy fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @struct SchedulingOptions
+ * @brief 调度配置
+ * @details 配置文件中的"scheduling"段，键为隔离组名：
+ *          capture(捕获)、inference(推理)、streaming(推流和连接反应器)、
+ *          http(HTTP工作线程)、recording(录像写盘)
+ */
+struct SchedulingOptions {
+    std::map<std::string, ThreadPolicy> groups;   ///< 隔离组名 → 策略
+
+    /**
+     * @brief 从JSON对象解析
+     */
+    static SchedulingOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
+
+/**
+ * @class ThreadTuning
+ * @brief 线程调度策略的应用入口
+ * @details 各流水线线程启动时对自身调用apply。Linux下新线程继承创建者的亲和性和调度策略，
+ *          因此推理线程派生的分块推理线程自动落在推理组的CPU上。
+ *          设置失败(如缺少CAP_SYS_NICE权限)只打印警告，线程以原有策略继续运行
+ */
+class ThreadTuning {
+public:
+    /**
+     * @brief 设置调度配置
+     * @details 应在创建流水线线程之前调用一次
+     */
+    static void configure(SchedulingOptions options);
+
+    /**
+     * @brief 对当前线程应用隔离组策略
+     * @param group 隔离组名，未配置的组只设置线程名
+     * @param name 线程名(超过15个字符时截断)
+     * @return 策略是否全部生效
+     */
+    static bool apply(const char* group, const char* name);
+
+    /**
+     * @brief 对当前线程应用隔离组策略，同一线程只生效一次
+     * @details 用于线程池中的工作线程，在其执行的任务入口调用
+     */
+    static void applyOnce(const char* group, const char* name);
+};
@@ -6,10 +6,30 @@
 
 #pragma once
 #include "capture_interface.h"
+#include "runtime_config.h"
+#include "frame_pool.h"
+#include "frame_mailbox.h"
+#include "coro_executor.h"
+#include <Poco/JSON/Object.h>
 #include <linux/videodev2.h>
-#include <thread>
-#include <mutex>
+#include <memory>
 #include <atomic>
+#include <string>
+
+/**
+ * @struct CaptureOptions
+ * @brief 捕获设备参数
+ */
+struct CaptureOptions {
+    std::string memory{"mmap"};     ///< 缓冲方式：mmap(驱动分配并映射)或userptr(驱动直接写入本程序分配的缓冲)
+    int buffers{6};                 ///< 驱动缓冲数(2-32)
+    bool export_dmabuf{false};      ///< 以VIDIOC_EXPBUF导出DMABUF描述符，仅mmap方式有效
+
+    /**
+     * @brief 从JSON对象解析，缺失的字段使用默认值
+     */
+    static CaptureOptions fromJson(const Poco::JSON::Object::Ptr& json);
+};
 
 /**
  * @class V4L2Capture
@@ -20,9 +40,12 @@ class V4L2Capture : public CaptureInterface {
 public:
     /**
      * @brief 构造函数
+     * @param config 运行时配置(目标帧率、JPEG质量)，为空时使用默认配置
+     * @param options 设备参数
      * @details 初始化成员变量
      */
-    V4L2Capture();
+    explicit V4L2Capture(std::shared_ptr<RuntimeConfigStore> config = nullptr,
+                         CaptureOptions options = CaptureOptions());
     
     /**
      * @brief 析构函数
@@ -48,12 +71,38 @@ public:
      */
     std::string getLatestFrame() override;
 
+    /**
+     * @brief 获取最新的已编码帧
+     * @return 最新帧的共享指针
+     */
+    EncodedFramePtr getLatestEncodedFrame() override;
+
+    /**
+     * @brief 订阅新帧
+     * @param stage 下游级名称
+     * @param defaults 配置文件未指定该级时使用的丢帧策略
+     * @return 该级专属的信箱
+     */
+    std::shared_ptr<FrameMailbox> subscribe(const std::string& stage,
+                                            const MailboxOptions& defaults) override;
+
+    /**
+     * @brief 设置各级信箱配置
+     * @details 应在下游级订阅之前调用
+     */
+    void setPipelineOptions(PipelineOptions options);
+
+    /**
+     * @brief 获取运行统计
+     */
+    CaptureStats stats() const override;
+
 private:
     /**
-     * @brief 视频捕获线程函数
-     * @details 在独立线程中持续捕获视频帧
+     * @brief 视频捕获任务
+     * @details 在捕获执行器上挂起等待设备描述符可读，每次就绪取出一帧处理
      */
-    void captureLoop();
+    CoroTask<void> captureTask();
     
     /**
      * @brief 初始化视频设备
@@ -61,14 +110,40 @@ private:
      * @return 是否成功初始化
      */
     bool initDevice(int device_id);
+
+    struct BufferQueue;
+
+    /**
+     * @brief 申请驱动缓冲
+     * @param queue 正在初始化的驱动缓冲队列
+     * @param memory V4L2_MEMORY_MMAP或V4L2_MEMORY_USERPTR
+     * @param size_image 每帧字节数
+     * @return 是否成功
+     */
+    bool requestBuffers(BufferQueue& queue, uint32_t memory, size_t size_image);
+
+    /**
+     * @brief 为刚出队的缓冲生成原始图像引用
+     * @details 引用释放时缓冲重新入队；空闲驱动缓冲不足时返回nullptr，调用方应立即归还缓冲
+     */
+    RawFramePtr holdBuffer(const v4l2_buffer& buf);
+
+    CaptureOptions options_;         ///< 设备参数
+    std::shared_ptr<BufferQueue> queue_; ///< 驱动缓冲队列，以原子操作读写；被原始图像引用时在停止后延迟释放
+    int width_{640};                 ///< 协商后的图像宽度
+    int height_{480};                ///< 协商后的图像高度
+    size_t bytes_per_line_{0};       ///< 协商后的YUYV行字节数
+    std::shared_ptr<FramePool> pool_; ///< 帧缓冲池，按协商格式分配，以原子操作读写
     
-    int fd_{-1};                     ///< 设备文件描述符
-    struct v4l2_buffer buf_{};       ///< V4L2缓冲区结构
-    void* buffer_{nullptr};          ///< 内存映射缓冲区指针
-    size_t buffer_size_{0};          ///< 缓冲区大小
-    
-    std::thread capture_thread_;     ///< 捕获线程
-    std::mutex frame_mutex_;         ///< 帧数据互斥锁
+    std::unique_ptr<CoroExecutor> executor_; ///< 捕获执行器，运行捕获任务
     std::atomic<bool> running_{false}; ///< 运行状态标志
-    std::string latest_frame_;       ///< 最新帧数据缓存
+    EncodedFramePtr latest_frame_;   ///< 最新帧，以原子操作读写，供快照等按需读取
+    std::atomic<uint64_t> sequence_{0}; ///< 已发布的帧序号
+    FrameFanout fanout_;             ///< 向各下游级信箱分发新帧
+    LatencyHistogram dequeue_latency_; ///< 出队延迟，反映捕获线程的调度延迟
+    std::atomic<uint64_t> late_dequeues_{0}; ///< 出队延迟超过一个帧间隔的次数
+    LatencyHistogram publish_latency_; ///< 采集到发布的时延
+    std::atomic<uint64_t> driver_drops_{0}; ///< 驱动丢帧数
+    std::atomic<uint64_t> raw_fallbacks_{0}; ///< 帧未携带原始图像的次数
+    std::shared_ptr<RuntimeConfigStore> config_; ///< 运行时配置
 }; 
\ No newline at end of file
@@ -7,15 +7,27 @@
 #pragma once
 #include "capture_interface.h"
 #include "image_processor.h"
+#include "stream_reactor.h"
+#include "snapshot_cache.h"
+#include "frame_protocol.h"
+#include "segment_recorder.h"
+#include "event_recorder.h"
+#include "detection_store.h"
+#include "h264_streamer.h"
+#include "pipeline_governor.h"
+#include "coro_executor.h"
+#include "frame_pool.h"
 #include <Poco/Net/HTTPServer.h>
 #include <Poco/Net/HTTPRequestHandler.h>
 #include <Poco/Net/HTTPRequestHandlerFactory.h>
 #include <Poco/Net/HTTPServerRequest.h>
 #include <Poco/Net/HTTPServerResponse.h>
 #include <Poco/Net/WebSocket.h>
+#include <Poco/URI.h>
 #include <memory>
-#include <thread>
+#include <mutex>
 #include <atomic>
+#include <unordered_map>
 
 /**
  * @class WebServer
@@ -24,17 +36,90 @@
  */
 class WebServer {
 public:
+    /**
+     * @brief WebSocket消息格式
+     * @details 连接时通过/ws?format=binary或/ws?codec=h264协商，默认为兼容的JSON格式
+     */
+    enum StreamFormat : uint32_t {
+        kFormatJson = 0,    ///< JPEG二进制帧 + 独立的JSON检测结果文本帧
+        kFormatBinary = 1,  ///< 检测框与JPEG合并为一条二进制消息，见frame_protocol.h
+        kFormatH264 = 2,    ///< fMP4分片二进制帧 + 独立的JSON检测结果文本帧
+        kFormatCount = 3    ///< 格式数
+    };
+
+    /**
+     * @brief 分辨率档位
+     * @details 连接时通过/ws?tier=half选择，之后可用setStream命令切换。
+     *          缩放档位由同一份BGR图像逐级缩小得到，只在有订阅者时编码
+     */
+    enum StreamTier : uint32_t {
+        kTierFull = 0,      ///< 原始分辨率
+        kTierHalf = 1,      ///< 二分之一
+        kTierQuarter = 2,   ///< 四分之一
+        kTierCount = 3      ///< 档位数
+    };
+
+    /**
+     * @brief 格式和档位对应的反应器订阅键
+     */
+    static uint32_t streamKey(StreamFormat format, StreamTier tier) {
+        return static_cast<uint32_t>(tier) * kFormatCount + static_cast<uint32_t>(format);
+    }
+
     /**
      * @brief 构造函数
      * @param video_capture 视频捕获对象
+     * @param config 运行时配置，为空时使用独立的默认配置
+     * @param model_options 检测模型文件
      */
-    explicit WebServer(std::shared_ptr<CaptureInterface> video_capture);
+    explicit WebServer(std::shared_ptr<CaptureInterface> video_capture,
+                       std::shared_ptr<RuntimeConfigStore> config = nullptr,
+                       const ModelOptions& model_options = ModelOptions());
     
     /**
      * @brief 析构函数
      */
     ~WebServer();
     
+    /**
+     * @brief 设置服务端录像器
+     * @param recorder 录像器，为空时/api/recording返回503
+     * @details 需在start()之前调用
+     */
+    void setRecorder(std::shared_ptr<SegmentRecorder> recorder) { recorder_ = std::move(recorder); }
+
+    /**
+     * @brief 设置事件短片录像器
+     * @param events 事件录像器，设置后即使没有WebSocket客户端也持续执行检测
+     * @details 需在start()之前调用
+     */
+    void setEventRecorder(std::shared_ptr<EventRecorder> events) { events_ = std::move(events); }
+
+    /**
+     * @brief 设置检测结果存储
+     * @param store 检测结果存储，设置后每次检测结果都会被持久化
+     * @param camera 写入记录的摄像头编号
+     * @details 需在start()之前调用
+     */
+    void setDetectionStore(std::shared_ptr<DetectionStore> store, uint16_t camera = 0) {
+        store_ = std::move(store);
+        camera_id_ = camera;
+    }
+
+    /**
+     * @brief 设置H.264推流参数
+     * @param options 推流参数，enabled为false或编码器不可用时/ws?codec=h264回退为二进制JPEG格式
+     * @details 需在start()之前调用
+     */
+    void setH264Options(H264Options options) { h264_options_ = std::move(options); }
+
+    /**
+     * @brief 设置负载调节参数
+     * @param options 调节参数，enabled为false时不启动调节器
+     * @details 需在start()之前调用
+     */
+    void setGovernorOptions(GovernorOptions options) { governor_options_ = std::move(options); }
+
     /**
      * @brief 启动服务器
      * @param port 监听端口
@@ -55,11 +140,9 @@ private:
     public:
         /**
          * @brief 构造函数
-         * @param capture 视频捕获对象
-         * @param processor 图像处理器
+         * @param owner 所属服务器，提供捕获、推理、反应器等共享组件
          */
-        WebSocketHandler(std::shared_ptr<CaptureInterface> capture,
-                        std::shared_ptr<ImageProcessor> processor);
+        explicit WebSocketHandler(WebServer& owner);
         
         /**
          * @brief 处理HTTP/WebSocket请求
@@ -69,11 +152,85 @@ private:
     private:
         /**
          * @brief 处理WebSocket连接
+         * @param ws 已完成握手的WebSocket
+         * @param format 客户端协商的消息格式
+         * @param tier 客户端选择的分辨率档位
+         * @details 握手完成后将套接字移交给反应器，立即释放Poco工作线程
+         */
+        void handleWebSocket(Poco::Net::WebSocket& ws, StreamFormat format, StreamTier tier);
+
+        /**
+         * @brief 处理/stream.mjpg请求
+         * @details 发送multipart响应头后将套接字移交给反应器，
+         *          后续帧与WebSocket共享同一份已编码数据
+         */
+        void handleMjpegStream(Poco::Net::HTTPServerRequest& request,
+                               Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/snapshot.jpg请求
+         * @details 直接返回最新已编码帧，支持ETag/Last-Modified条件请求和?w=缩放
+         */
+        void handleSnapshot(Poco::Net::HTTPServerRequest& request,
+                            Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/classes请求
+         * @details 返回类别名称列表，二进制格式的客户端据此将类别ID映射为标签
+         */
+        void handleClasses(Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/config请求
+         * @details GET返回当前配置，POST/PUT以JSON局部更新配置
          */
-        void handleWebSocket(Poco::Net::WebSocket& ws);
+        void handleConfig(Poco::Net::HTTPServerRequest& request,
+                          Poco::Net::HTTPServerResponse& response);
+
+
+        /**
+         * @brief 处理/api/recording请求
+         * @details GET返回录像状态，POST/PUT以{"enabled": bool}开始或停止录像
+         */
+        void handleRecording(Poco::Net::HTTPServerRequest& request,
+                             Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/events请求
+         * @details 返回事件短片录像状态
+         */
+        void handleEvents(Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/stats请求
+         * @details 返回捕获端(含帧缓冲池)和连接反应器的运行统计
+         */
+        void handleStats(Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/detections请求
+         * @details 按条件分页查询历史检测记录，边扫描边以分块传输输出
+         */
+        void handleDetections(Poco::Net::HTTPServerRequest& request,
+                              Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 处理/api/detections/histogram请求
+         * @details 流式扫描统计每个时间区间内的检测数，内存占用只与区间数有关
+         */
+        void handleDetectionHistogram(Poco::Net::HTTPServerRequest& request,
+                                      Poco::Net::HTTPServerResponse& response);
+
+        /**
+         * @brief 从请求参数解析检测记录查询条件
+         * @param uri 请求URI
+         * @param query 输出查询条件
+         * @param error 失败时的错误描述
+         * @return 是否成功
+         */
+        bool parseDetectionQuery(const Poco::URI& uri, DetectionQuery& query, std::string& error) const;
         
-        std::shared_ptr<CaptureInterface> video_capture_;  ///< 视频捕获对象
-        std::shared_ptr<ImageProcessor> processor_;        ///< 图像处理器
+        WebServer& owner_;   ///< 所属服务器
     };
 
     /**
@@ -84,9 +241,9 @@ private:
     public:
         /**
          * @brief 构造函数
+         * @param owner 所属服务器
          */
-        HandlerFactory(std::shared_ptr<CaptureInterface> capture,
-                      std::shared_ptr<ImageProcessor> processor);
+        explicit HandlerFactory(WebServer& owner);
         
         /**
          * @brief 创建请求处理器
@@ -94,12 +251,101 @@ private:
         Poco::Net::HTTPRequestHandler* createRequestHandler(
             const Poco::Net::HTTPServerRequest& request) override;
     private:
-        std::shared_ptr<CaptureInterface> video_capture_;  ///< 视频捕获对象
-        std::shared_ptr<ImageProcessor> processor_;        ///< 图像处理器
+        WebServer& owner_;   ///< 所属服务器
     };
 
+    /**
+     * @brief 处理客户端通过WebSocket发送的命令
+     * @param conn_id 连接ID
+     * @param message JSON命令文本
+     * @details 在反应器线程中调用，配置修改通过运行时配置发布，不阻塞推理和捕获
+     */
+    void handleCommand(uint64_t conn_id, const std::string& message);
+
+    /**
+     * @brief 把已有连接切换到指定格式和档位
+     * @param conn_id 连接ID
+     * @param format 消息格式，H.264不可用时回退为二进制格式
+     * @param tier 分辨率档位
+     */
+    void setStream(uint64_t conn_id, StreamFormat format, StreamTier tier);
+
+    /**
+     * @brief 向所有订阅键广播一条文本消息
+     * @param message 消息内容
+     * @param droppable 写队列积压时是否允许丢弃
+     * @param detections_only 只发给单独接收检测结果的格式(JSON和H.264)
+     */
+    void broadcastText(std::shared_ptr<const std::string> message, bool droppable, bool detections_only);
+
+    /**
+     * @brief 单独接收检测结果文本帧(JSON和H.264格式)的连接数
+     */
+    size_t detectionSubscribers() const;
+
+    /**
+     * @brief 构造当前配置的通知消息
+     */
+    std::shared_ptr<const std::string> makeConfigMessage() const;
+
+    /**
+     * @brief 帧广播任务
+     * @details 仅在有新帧时被唤醒，把同一份JPEG数据广播给全部客户端
+     */
+    CoroTask<void> broadcastTask();
+
+    /**
+     * @brief 把一帧JPEG广播给指定档位的JSON、二进制格式连接
+     * @param tier 分辨率档位，原始分辨率时同时推送给MJPEG连接
+     * @param frame 该档位的已编码帧
+     */
+    void broadcastFrame(StreamTier tier, const EncodedFramePtr& frame);
+
+    /**
+     * @brief 缩放档位编码任务
+     * @details 只在缩放JPEG档位或任一H.264档位有订阅者时工作：
+     *          以捕获端的BGR图像为第0级逐级缩小一半，各档位共享这一组图像，
+     *          只生成订阅档位所需的层级
+     */
+    CoroTask<void> simulcastTask();
+
+    /**
+     * @brief 目标检测任务
+     * @details 对最新帧执行一次检测并广播结果，检测耗时内到达的帧直接跳过；推理帧率受限时
+     *          在定时器上挂起到下一次推理时刻再取最新帧。结果同时提交给事件录像器做规则匹配，并写入检测结果存储
+     */
+    CoroTask<void> detectionTask();
+
+    /**
+     * @brief 记录客户端上报的显示时延
+     * @param conn_id 上报的连接
+     * @param latency_us 采集到显示的时延(微秒)
+     */
+    void recordDisplayLatency(uint64_t conn_id, int64_t latency_us);
+
     std::shared_ptr<CaptureInterface> video_capture_;      ///< 视频捕获对象
     std::shared_ptr<ImageProcessor> processor_;            ///< 图像处理器
+    std::unique_ptr<StreamReactor> reactor_;              ///< WebSocket连接反应器
+    std::shared_ptr<SegmentRecorder> recorder_;           ///< 服务端录像器
+    std::shared_ptr<EventRecorder> events_;               ///< 事件短片录像器
+    std::shared_ptr<DetectionStore> store_;               ///< 检测结果存储
+    uint16_t camera_id_{0};                               ///< 摄像头编号
+    H264Options h264_options_;                            ///< H.264推流参数
+    std::unique_ptr<H264Streamer> h264_[kTierCount];      ///< 各档位的H.264推流器，未启用时为空
+    std::shared_ptr<FramePool> tier_pools_[kTierCount];   ///< 各缩放档位的帧缓冲池，由缩放档位任务创建，以原子操作读写
+    cv::Size tier_sizes_[kTierCount];                     ///< 各缩放档位缓冲池的图像尺寸，源尺寸变化时重建
+    SnapshotCache snapshots_;                             ///< 快照缩放图缓存
     std::unique_ptr<Poco::Net::HTTPServer> server_;       ///< HTTP服务器
+    std::unique_ptr<CoroExecutor> streaming_;             ///< 推流执行器，运行帧广播和缩放档位编码任务
+    std::unique_ptr<CoroExecutor> inference_;             ///< 推理执行器，运行目标检测任务
+    std::mutex detections_mutex_;                         ///< 检测结果互斥锁
+    std::shared_ptr<const DetectionSet> latest_detections_; ///< 最近一次检测结果
+    LatencyHistogram inference_latency_;                  ///< 采集到检测完成的时延
+    LatencyHistogram send_latency_;                       ///< 采集到交给反应器发送的时延
+    LatencyHistogram display_latency_;                    ///< 客户端上报的采集到显示的时延
+    std::mutex client_latency_mutex_;                     ///< 保护各客户端的显示时延
+    std::unordered_map<uint64_t, std::unique_ptr<LatencyHistogram>> client_latency_; ///< 连接ID → 显示时延
+    GovernorOptions governor_options_;                    ///< 负载调节参数
+    std::unique_ptr<PipelineGovernor> governor_;          ///< 负载调节器，未启用时为空
     std::atomic<bool> running_{false};                    ///< 运行状态标志
 }; 
\ No newline at end of file
@@ -33,6 +33,10 @@ cp build/bin/test_* ${PACKAGE_DIR}/bin/ 2>/dev/null || true
 print_step "复制模型文件"
 cp -r models/* ${PACKAGE_DIR}/models/
 
+# 复制配置文件
+print_step "复制配置文件"
+cp -r config/* ${PACKAGE_DIR}/config/
+
 # 复制依赖库
 print_step "复制依赖库"
 cp -r prebuild/${PLATFORM}/lib/* ${PACKAGE_DIR}/lib/
@@ -243,14 +243,15 @@ build_opencv() {
         -DBUILD_PERF_TESTS=OFF \
         -DBUILD_EXAMPLES=OFF \
         -DBUILD_opencv_apps=OFF \
-        -DBUILD_LIST=core,imgproc,imgcodecs,videoio \
+        -DBUILD_LIST=core,imgproc,imgcodecs,videoio,dnn \
         -DWITH_FFMPEG=OFF \
         -DWITH_GTK=OFF \
         -DWITH_QT=OFF \
         -DWITH_CUDA=OFF \
         -DWITH_IPP=OFF \
         -DWITH_QUIRC=OFF \
-        -DWITH_PROTOBUF=OFF
+        -DWITH_PROTOBUF=ON \
+        -DBUILD_PROTOBUF=ON
         
     make -j$(nproc) && make install
     return $?
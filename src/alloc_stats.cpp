@@ -0,0 +1,149 @@
+/**
+ * @file alloc_stats.cpp
+ * @brief 堆分配计数实现
+ * @details 在可执行文件中定义malloc等符号以覆盖glibc的同名入口，计数后转给glibc的内部实现。
+ *          计数器全部为常量初始化的静态存储，动态链接器完成重定位之后的第一次分配即可安全计数
+ */
+
+#include "alloc_stats.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define ALLOC_STATS_DISABLED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define ALLOC_STATS_DISABLED 1
+#endif
+#endif
+
+namespace {
+
+constexpr size_t kMaxGroups = 16;       ///< 隔离组数上限，序号0固定为other
+constexpr size_t kMaxGroupName = 32;    ///< 隔离组名长度上限
+
+/**
+ * @struct Counter
+ * @brief 单个隔离组的计数器
+ */
+struct alignas(64) Counter {
+    std::atomic<uint64_t> allocations{0};   ///< 分配次数
+    std::atomic<uint64_t> bytes{0};         ///< 申请字节数
+};
+
+Counter g_counters[kMaxGroups];                         ///< 各隔离组的计数器
+char g_names[kMaxGroups][kMaxGroupName] = {"other"};    ///< 各隔离组名
+std::atomic<size_t> g_group_count{1};                   ///< 已登记的隔离组数
+std::mutex g_mutex;                                     ///< 保护隔离组登记
+thread_local unsigned t_group = 0;                      ///< 当前线程所属的隔离组序号
+
+#ifndef ALLOC_STATS_DISABLED
+inline void count(size_t size) {
+    Counter& counter = g_counters[t_group];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+#endif
+
+} // namespace
+
+#ifndef ALLOC_STATS_DISABLED
+
+// glibc导出的内部分配入口，free等未覆盖的入口直接使用glibc的实现
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+
+void* malloc(size_t size) noexcept {
+    count(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+    count(n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) noexcept {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    count(size);
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+void* valloc(size_t size) noexcept {
+    count(size);
+    return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept {
+    count(size);
+    return __libc_pvalloc(size);
+}
+}
+
+#endif
+
+void AllocStats::setThreadGroup(const char* group) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    size_t n = g_group_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i) {
+        if (strncmp(g_names[i], group, kMaxGroupName - 1) == 0) {
+            t_group = static_cast<unsigned>(i);
+            return;
+        }
+    }
+    if (n == kMaxGroups) {
+        t_group = 0;
+        return;
+    }
+    strncpy(g_names[n], group, kMaxGroupName - 1);
+    g_group_count.store(n + 1, std::memory_order_release);
+    t_group = static_cast<unsigned>(n);
+}
+
+bool AllocStats::enabled() {
+#ifdef ALLOC_STATS_DISABLED
+    return false;
+#else
+    return true;
+#endif
+}
+
+std::vector<AllocStats::Group> AllocStats::snapshot() {
+    std::vector<Group> groups;
+    size_t n = g_group_count.load(std::memory_order_acquire);
+    groups.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Group group;
+        group.name = g_names[i];
+        group.allocations = g_counters[i].allocations.load(std::memory_order_relaxed);
+        group.bytes = g_counters[i].bytes.load(std::memory_order_relaxed);
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
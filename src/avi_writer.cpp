@@ -0,0 +1,210 @@
+/**
+ * @file avi_writer.cpp
+ * @brief MJPEG格式AVI文件写入实现
+ */
+
+#include "avi_writer.h"
+#include <algorithm>
+
+namespace {
+
+// 文件头布局固定，以下偏移用于关闭时回填
+constexpr uint64_t kRiffSizeOffset = 4;
+constexpr uint64_t kMaxBytesPerSecOffset = 36;
+constexpr uint64_t kTotalFramesOffset = 48;
+constexpr uint64_t kMainBufferSizeOffset = 60;
+constexpr uint64_t kStreamLengthOffset = 140;
+constexpr uint64_t kStreamBufferSizeOffset = 144;
+constexpr uint64_t kMoviSizeOffset = 216;
+constexpr uint64_t kMoviTypeOffset = 220;
+constexpr uint64_t kHeaderSize = 224;
+
+constexpr uint32_t kAvifHasIndex = 0x10;
+constexpr uint32_t kAviifKeyframe = 0x10;
+
+void putFourcc(std::string& out, const char* fourcc) {
+    out.append(fourcc, 4);
+}
+
+void putU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void encodeU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+} // namespace
+
+AviWriter::~AviWriter() {
+    close();
+}
+
+bool AviWriter::open(const std::string& path, int width, int height, int fps) {
+    close();
+    if (!file_.open(path)) return false;
+
+    index_.clear();
+    max_frame_size_ = 0;
+    fps_ = std::max(fps, 1);
+
+    std::string header;
+    header.reserve(kHeaderSize);
+    putFourcc(header, "RIFF");
+    putU32(header, 0);                          // 文件长度，关闭时回填
+    putFourcc(header, "AVI ");
+
+    putFourcc(header, "LIST");
+    putU32(header, 192);                        // hdrl列表长度
+    putFourcc(header, "hdrl");
+
+    // MainAVIHeader
+    putFourcc(header, "avih");
+    putU32(header, 56);
+    putU32(header, static_cast<uint32_t>(1000000 / fps_));
+    putU32(header, 0);                          // dwMaxBytesPerSec
+    putU32(header, 0);                          // dwPaddingGranularity
+    putU32(header, kAvifHasIndex);
+    putU32(header, 0);                          // dwTotalFrames
+    putU32(header, 0);                          // dwInitialFrames
+    putU32(header, 1);                          // dwStreams
+    putU32(header, 0);                          // dwSuggestedBufferSize
+    putU32(header, static_cast<uint32_t>(width));
+    putU32(header, static_cast<uint32_t>(height));
+    for (int i = 0; i < 4; ++i) putU32(header, 0);
+
+    putFourcc(header, "LIST");
+    putU32(header, 116);                        // strl列表长度
+    putFourcc(header, "strl");
+
+    // AVIStreamHeader
+    putFourcc(header, "strh");
+    putU32(header, 56);
+    putFourcc(header, "vids");
+    putFourcc(header, "MJPG");
+    putU32(header, 0);                          // dwFlags
+    putU16(header, 0);                          // wPriority
+    putU16(header, 0);                          // wLanguage
+    putU32(header, 0);                          // dwInitialFrames
+    putU32(header, 1);                          // dwScale
+    putU32(header, static_cast<uint32_t>(fps_)); // dwRate
+    putU32(header, 0);                          // dwStart
+    putU32(header, 0);                          // dwLength
+    putU32(header, 0);                          // dwSuggestedBufferSize
+    putU32(header, 0xFFFFFFFF);                 // dwQuality
+    putU32(header, 0);                          // dwSampleSize
+    putU16(header, 0);
+    putU16(header, 0);
+    putU16(header, static_cast<uint16_t>(width));
+    putU16(header, static_cast<uint16_t>(height));
+
+    // BITMAPINFOHEADER
+    putFourcc(header, "strf");
+    putU32(header, 40);
+    putU32(header, 40);
+    putU32(header, static_cast<uint32_t>(width));
+    putU32(header, static_cast<uint32_t>(height));
+    putU16(header, 1);                          // biPlanes
+    putU16(header, 24);                         // biBitCount
+    putFourcc(header, "MJPG");
+    putU32(header, static_cast<uint32_t>(width * height * 3));
+    for (int i = 0; i < 4; ++i) putU32(header, 0);
+
+    putFourcc(header, "LIST");
+    putU32(header, 0);                          // movi列表长度，关闭时回填
+    putFourcc(header, "movi");
+
+    if (!file_.write(header.data(), header.size())) {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+bool AviWriter::writeFrame(const void* jpeg, size_t size) {
+    if (!file_.isOpen()) return false;
+
+    uint32_t length = static_cast<uint32_t>(size);
+    uint8_t chunk[8] = {'0', '0', 'd', 'c'};
+    encodeU32(chunk + 4, length);
+
+    uint64_t offset = file_.position() - kMoviTypeOffset;
+    if (!file_.write(chunk, sizeof(chunk))) return false;
+    if (size > 0 && !file_.write(jpeg, size)) return false;
+    // 数据块按2字节对齐
+    if (size & 1) {
+        uint8_t pad = 0;
+        if (!file_.write(&pad, 1)) return false;
+    }
+
+    index_.push_back({static_cast<uint32_t>(offset), length});
+    max_frame_size_ = std::max(max_frame_size_, length);
+    return true;
+}
+
+bool AviWriter::writeFrameAt(const void* jpeg, size_t size,
+                             std::chrono::microseconds offset, bool& written) {
+    written = false;
+    int64_t slot = std::max<int64_t>(offset.count(), 0) * fps_ / 1000000;
+    for (int filled = 0; frameCount() < slot && filled < fps_; ++filled) {
+        if (!writeEmptyFrame()) return false;
+    }
+    // 允许一帧的抖动
+    if (frameCount() > slot + 1) return true;
+
+    written = writeFrame(jpeg, size);
+    return written;
+}
+
+bool AviWriter::close() {
+    if (!file_.isOpen()) return true;
+
+    uint64_t movi_end = file_.position();
+    bool ok = true;
+
+    // idx1索引
+    std::string idx;
+    idx.reserve(8 + index_.size() * 16);
+    putFourcc(idx, "idx1");
+    putU32(idx, static_cast<uint32_t>(index_.size() * 16));
+    for (const auto& entry : index_) {
+        putFourcc(idx, "00dc");
+        putU32(idx, entry.size > 0 ? kAviifKeyframe : 0);
+        putU32(idx, entry.offset);
+        putU32(idx, entry.size);
+    }
+    ok = file_.write(idx.data(), idx.size()) && ok;
+
+    // 回填文件头
+    auto patch = [this, &ok](uint64_t offset, uint32_t value) {
+        uint8_t buf[4];
+        encodeU32(buf, value);
+        ok = file_.patch(offset, buf, sizeof(buf)) && ok;
+    };
+    uint64_t total_bytes = 0;
+    for (const auto& entry : index_) total_bytes += entry.size;
+    uint32_t frames = frameCount();
+    uint32_t bytes_per_sec = frames > 0
+        ? static_cast<uint32_t>(total_bytes * static_cast<uint64_t>(fps_) / frames) : 0;
+
+    patch(kRiffSizeOffset, static_cast<uint32_t>(file_.position() - 8));
+    patch(kMaxBytesPerSecOffset, bytes_per_sec);
+    patch(kTotalFramesOffset, frames);
+    patch(kMainBufferSizeOffset, max_frame_size_ + 8);
+    patch(kStreamLengthOffset, frames);
+    patch(kStreamBufferSizeOffset, max_frame_size_ + 8);
+    patch(kMoviSizeOffset, static_cast<uint32_t>(movi_end - kMoviTypeOffset));
+
+    ok = file_.close() && ok;
+    index_.clear();
+    return ok;
+}
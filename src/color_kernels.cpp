@@ -0,0 +1,216 @@
+/**
+ * @file color_kernels.cpp
+ * @brief 颜色转换内核实现
+ * @details SIMD实现每次处理4/8/16个像素，先以32位整数完成定点运算，再打包为BGR三字节；
+ *          行尾不足一组的像素由标量实现处理
+ */
+
+#include "color_kernels.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(KERNEL_DISPATCH_X86)
+#include <immintrin.h>
+#elif defined(KERNEL_DISPATCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// OpenCV的ITUR_BT_601_*系数，Q20定点
+constexpr int kShift = 20;
+constexpr int kCy = 1220542;
+constexpr int kCub = 2116026;
+constexpr int kCug = -409993;
+constexpr int kCvg = -852492;
+constexpr int kCvr = 1673527;
+constexpr int kHalf = 1 << (kShift - 1);
+
+using RowFn = void (*)(const uint8_t* src, uint8_t* dst, int begin, int width);
+
+inline uint8_t saturate(int x) {
+    return static_cast<uint8_t>(std::min(std::max(x, 0), 255));
+}
+
+/**
+ * @brief 转换一行中[begin, width)的像素
+ */
+void rowScalar(const uint8_t* src, uint8_t* dst, int begin, int width) {
+    for (int x = begin; x < width; ++x) {
+        const uint8_t* pair = src + (x & ~1) * 2;
+        int y = std::max(0, static_cast<int>(src[x * 2]) - 16) * kCy;
+        int u = static_cast<int>(pair[1]) - 128;
+        int v = static_cast<int>(pair[3]) - 128;
+        uint8_t* out = dst + x * 3;
+        out[0] = saturate((y + kHalf + kCub * u) >> kShift);
+        out[1] = saturate((y + kHalf + kCvg * v + kCug * u) >> kShift);
+        out[2] = saturate((y + kHalf + kCvr * v) >> kShift);
+    }
+}
+
+#if defined(KERNEL_DISPATCH_X86)
+
+__attribute__((target("sse4.2")))
+void rowSse4(const uint8_t* src, uint8_t* dst, int begin, int width) {
+    const __m128i ymask = _mm_setr_epi8(0, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i umask = _mm_setr_epi8(1, 1, 5, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i vmask = _mm_setr_epi8(3, 3, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    // 4个0x00RRGGBB像素压成12字节
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i c16 = _mm_set1_epi32(16), c128 = _mm_set1_epi32(128), zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(255), half = _mm_set1_epi32(kHalf);
+    const __m128i cy = _mm_set1_epi32(kCy), cub = _mm_set1_epi32(kCub), cug = _mm_set1_epi32(kCug);
+    const __m128i cvg = _mm_set1_epi32(kCvg), cvr = _mm_set1_epi32(kCvr);
+
+    int x = begin;
+    for (; x + 4 <= width; x += 4) {
+        __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x * 2));
+        __m128i y = _mm_cvtepu8_epi32(_mm_shuffle_epi8(raw, ymask));
+        __m128i u = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_shuffle_epi8(raw, umask)), c128);
+        __m128i v = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_shuffle_epi8(raw, vmask)), c128);
+        y = _mm_add_epi32(_mm_mullo_epi32(_mm_max_epi32(_mm_sub_epi32(y, c16), zero), cy), half);
+
+        __m128i b = _mm_srai_epi32(_mm_add_epi32(y, _mm_mullo_epi32(u, cub)), kShift);
+        __m128i g = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(y, _mm_mullo_epi32(v, cvg)),
+                                                 _mm_mullo_epi32(u, cug)), kShift);
+        __m128i r = _mm_srai_epi32(_mm_add_epi32(y, _mm_mullo_epi32(v, cvr)), kShift);
+        b = _mm_min_epi32(_mm_max_epi32(b, zero), max);
+        g = _mm_min_epi32(_mm_max_epi32(g, zero), max);
+        r = _mm_min_epi32(_mm_max_epi32(r, zero), max);
+
+        __m128i px = _mm_or_si128(b, _mm_or_si128(_mm_slli_epi32(g, 8), _mm_slli_epi32(r, 16)));
+        alignas(16) uint8_t packed[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(packed), _mm_shuffle_epi8(px, pack));
+        std::memcpy(dst + x * 3, packed, 12);
+    }
+    rowScalar(src, dst, x, width);
+}
+
+__attribute__((target("avx2")))
+void rowAvx2(const uint8_t* src, uint8_t* dst, int begin, int width) {
+    const __m128i ymask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i umask = _mm_setr_epi8(1, 1, 5, 5, 9, 9, 13, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i vmask = _mm_setr_epi8(3, 3, 7, 7, 11, 11, 15, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    // 每个128位半区的4个0x00RRGGBB像素压成12字节
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i c16 = _mm256_set1_epi32(16), c128 = _mm256_set1_epi32(128), zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255), half = _mm256_set1_epi32(kHalf);
+    const __m256i cy = _mm256_set1_epi32(kCy), cub = _mm256_set1_epi32(kCub), cug = _mm256_set1_epi32(kCug);
+    const __m256i cvg = _mm256_set1_epi32(kCvg), cvr = _mm256_set1_epi32(kCvr);
+
+    int x = begin;
+    for (; x + 8 <= width; x += 8) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        __m256i y = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(raw, ymask));
+        __m256i u = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(raw, umask)), c128);
+        __m256i v = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_shuffle_epi8(raw, vmask)), c128);
+        y = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_max_epi32(_mm256_sub_epi32(y, c16), zero), cy), half);
+
+        __m256i b = _mm256_srai_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(u, cub)), kShift);
+        __m256i g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(v, cvg)),
+                                                       _mm256_mullo_epi32(u, cug)), kShift);
+        __m256i r = _mm256_srai_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(v, cvr)), kShift);
+        b = _mm256_min_epi32(_mm256_max_epi32(b, zero), max);
+        g = _mm256_min_epi32(_mm256_max_epi32(g, zero), max);
+        r = _mm256_min_epi32(_mm256_max_epi32(r, zero), max);
+
+        __m256i px = _mm256_or_si256(b, _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(r, 16)));
+        alignas(32) uint8_t packed[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(packed), _mm256_shuffle_epi8(px, pack));
+        std::memcpy(dst + x * 3, packed, 12);
+        std::memcpy(dst + x * 3 + 12, packed + 16, 12);
+    }
+    rowScalar(src, dst, x, width);
+}
+
+#elif defined(KERNEL_DISPATCH_NEON)
+
+/**
+ * @struct NeonChroma
+ * @brief 8组色度的定点项(含舍入)，低4组和高4组各一个向量
+ */
+struct NeonChroma {
+    int32x4_t b[2];
+    int32x4_t g[2];
+    int32x4_t r[2];
+};
+
+inline NeonChroma neonChroma(uint8x8_t u8, uint8x8_t v8) {
+    const int16x8_t c128 = vdupq_n_s16(128);
+    const int32x4_t half = vdupq_n_s32(kHalf);
+    int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), c128);
+    int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), c128);
+    int32x4_t us[2] = {vmovl_s16(vget_low_s16(u)), vmovl_s16(vget_high_s16(u))};
+    int32x4_t vs[2] = {vmovl_s16(vget_low_s16(v)), vmovl_s16(vget_high_s16(v))};
+
+    NeonChroma c;
+    for (int h = 0; h < 2; ++h) {
+        c.b[h] = vmlaq_n_s32(half, us[h], kCub);
+        c.g[h] = vmlaq_n_s32(vmlaq_n_s32(half, vs[h], kCvg), us[h], kCug);
+        c.r[h] = vmlaq_n_s32(half, vs[h], kCvr);
+    }
+    return c;
+}
+
+inline uint8x8_t neonNarrow(int32x4_t lo, int32x4_t hi) {
+    uint16x8_t wide = vcombine_u16(vqmovun_s32(vshrq_n_s32(lo, kShift)), vqmovun_s32(vshrq_n_s32(hi, kShift)));
+    return vqmovn_u16(wide);
+}
+
+inline uint8x8x3_t neonPixels(uint8x8_t y8, const NeonChroma& c) {
+    int16x8_t y = vmaxq_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)), vdupq_n_s16(16)), vdupq_n_s16(0));
+    int32x4_t lo = vmulq_n_s32(vmovl_s16(vget_low_s16(y)), kCy);
+    int32x4_t hi = vmulq_n_s32(vmovl_s16(vget_high_s16(y)), kCy);
+    uint8x8x3_t px;
+    px.val[0] = neonNarrow(vaddq_s32(lo, c.b[0]), vaddq_s32(hi, c.b[1]));
+    px.val[1] = neonNarrow(vaddq_s32(lo, c.g[0]), vaddq_s32(hi, c.g[1]));
+    px.val[2] = neonNarrow(vaddq_s32(lo, c.r[0]), vaddq_s32(hi, c.r[1]));
+    return px;
+}
+
+void rowNeon(const uint8_t* src, uint8_t* dst, int begin, int width) {
+    int x = begin;
+    for (; x + 16 <= width; x += 16) {
+        // 解交织为偶数像素亮度、U、奇数像素亮度、V各8个
+        uint8x8x4_t q = vld4_u8(src + x * 2);
+        NeonChroma c = neonChroma(q.val[1], q.val[3]);
+        uint8x8x3_t even = neonPixels(q.val[0], c);
+        uint8x8x3_t odd = neonPixels(q.val[2], c);
+
+        uint8x8x3_t first, second;
+        for (int ch = 0; ch < 3; ++ch) {
+            uint8x8x2_t zipped = vzip_u8(even.val[ch], odd.val[ch]);
+            first.val[ch] = zipped.val[0];
+            second.val[ch] = zipped.val[1];
+        }
+        vst3_u8(dst + x * 3, first);
+        vst3_u8(dst + x * 3 + 24, second);
+    }
+    rowScalar(src, dst, x, width);
+}
+
+#endif
+
+RowFn rowFn(KernelIsa isa) {
+    switch (isa) {
+#if defined(KERNEL_DISPATCH_X86)
+    case KernelIsa::kSse4: return rowSse4;
+    case KernelIsa::kAvx2:
+    case KernelIsa::kAvx512: return rowAvx2;
+#elif defined(KERNEL_DISPATCH_NEON)
+    case KernelIsa::kNeon: return rowNeon;
+#endif
+    default: return rowScalar;
+    }
+}
+
+} // namespace
+
+void ColorKernels::yuyvToBgr(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                             int width, int height, KernelIsa isa) {
+    RowFn row = rowFn(KernelDispatch::supported(isa) ? isa : KernelIsa::kScalar);
+    for (int y = 0; y < height; ++y) {
+        row(src + y * src_stride, dst + y * dst_stride, 0, width);
+    }
+}
@@ -0,0 +1,271 @@
+/**
+ * @file coro_executor.cpp
+ * @brief 协程执行器实现
+ */
+
+#include "coro_executor.h"
+#include "thread_tuning.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kMaxEvents = 32;  ///< 每轮epoll_wait取回的事件数上限
+
+} // namespace
+
+CoroExecutor::CoroExecutor(ExecutorOptions options)
+    : options_(std::move(options)) {
+    options_.threads = std::max(1, options_.threads);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        throw std::runtime_error("创建执行器" + options_.name + "失败: " + strerror(errno));
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+}
+
+CoroExecutor::~CoroExecutor() {
+    stop();
+    // 工作线程已全部退出，仍未开始的任务不会再被恢复，销毁协程帧(连同其中的任务和捕获的帧引用)
+    for (void* address : unstarted_) {
+        std::coroutine_handle<>::from_address(address).destroy();
+    }
+    unstarted_.clear();
+    ready_.clear();
+    ::close(wake_fd_);
+    ::close(epoll_fd_);
+}
+
+void CoroExecutor::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) return;
+    started_ = true;
+    for (int i = 0; i < options_.threads; ++i) {
+        threads_.emplace_back(&CoroExecutor::workerLoop, this);
+    }
+}
+
+void CoroExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+
+        // 取消所有等待，协程恢复后看到取消结果自行退出
+        for (auto& timer : timers_) {
+            *timer.second.fired = false;
+            ready_.push_back(timer.second.handle);
+        }
+        timers_.clear();
+        for (auto& waiter : waiters_) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, waiter.first, nullptr);
+            *waiter.second.revents = 0;
+            ready_.push_back(waiter.second.handle);
+        }
+        waiters_.clear();
+        cv_.notify_all();
+    }
+    interruptPoll();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) thread.join();
+    }
+    threads_.clear();
+}
+
+bool CoroExecutor::stopping() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopping_;
+}
+
+void CoroExecutor::spawn(CoroTask<void> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++active_;
+    }
+    run(std::move(task));
+}
+
+CoroExecutor::Detached CoroExecutor::run(CoroTask<void> task) {
+    co_await Launch{this, nullptr};
+    try {
+        co_await task;
+    } catch (const std::exception& e) {
+        std::cerr << "执行器" << options_.name << "中的任务异常退出: " << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_ == 0) {
+        cv_.notify_all();
+        interruptPoll();
+    }
+}
+
+void CoroExecutor::launch(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unstarted_.insert(handle.address());
+    }
+    post(handle);
+}
+
+void CoroExecutor::launched(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unstarted_.erase(handle.address());
+}
+
+void CoroExecutor::post(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back(handle);
+    if (idle_ > 0) {
+        cv_.notify_one();
+    } else if (polling_) {
+        interruptPoll();
+    }
+}
+
+bool CoroExecutor::addTimer(std::chrono::steady_clock::time_point deadline, std::coroutine_handle<> handle,
+                            bool* fired) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        *fired = false;
+        return false;
+    }
+    // 新定时器早于epoll等待的超时时才需要打断，让等待按新的最近到期时刻重新计算
+    bool earliest = timers_.empty() || deadline < timers_.begin()->first;
+    timers_.emplace(deadline, TimerWaiter{handle, fired});
+    if (earliest && polling_) {
+        interruptPoll();
+    }
+    return true;
+}
+
+bool CoroExecutor::watch(int fd, uint32_t events, std::coroutine_handle<> handle, uint32_t* revents) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+        *revents = 0;
+        return false;
+    }
+    // 一次性注册，就绪一次后自动解除；文件描述符已注册过时只需重新启用
+    epoll_event ev = {};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0
+        && (errno != ENOENT || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0)) {
+        std::cerr << "执行器" << options_.name << "无法等待文件描述符" << fd << ": " << strerror(errno) << std::endl;
+        *revents = EPOLLERR;
+        return false;
+    }
+    waiters_[fd] = FdWaiter{handle, revents};
+    return true;
+}
+
+void CoroExecutor::workerLoop() {
+    ThreadTuning::apply(options_.group.c_str(), options_.name.c_str());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (!ready_.empty()) {
+            auto handle = ready_.front();
+            ready_.pop_front();
+            // 本线程可能长时间执行协程，由休眠的线程接替等待epoll
+            if (!polling_ && idle_ > 0) {
+                cv_.notify_one();
+            }
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+        if (stopping_ && active_ == 0) break;
+        if (!polling_) {
+            pollOnce(lock);
+            continue;
+        }
+        ++idle_;
+        cv_.wait(lock);
+        --idle_;
+    }
+    cv_.notify_all();
+    interruptPoll();
+}
+
+void CoroExecutor::pollOnce(std::unique_lock<std::mutex>& lock) {
+    int timeout_ms = -1;
+    if (!timers_.empty()) {
+        auto remaining = timers_.begin()->first - std::chrono::steady_clock::now();
+        // 向上取整，避免在到期前醒来后空转
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+        timeout_ms = static_cast<int>(std::clamp<int64_t>(ms, 0, INT32_MAX));
+    }
+
+    polling_ = true;
+    lock.unlock();
+    epoll_event events[kMaxEvents];
+    int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+    lock.lock();
+    polling_ = false;
+
+    for (int i = 0; i < count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == wake_fd_) {
+            uint64_t value;
+            ssize_t consumed = ::read(wake_fd_, &value, sizeof(value));
+            (void)consumed;
+            continue;
+        }
+        auto it = waiters_.find(fd);
+        if (it == waiters_.end()) continue;
+        *it->second.revents = events[i].events;
+        ready_.push_back(it->second.handle);
+        waiters_.erase(it);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    while (!timers_.empty() && timers_.begin()->first <= now) {
+        *timers_.begin()->second.fired = true;
+        ready_.push_back(timers_.begin()->second.handle);
+        timers_.erase(timers_.begin());
+    }
+
+    if (ready_.size() > 1 && idle_ > 0) {
+        cv_.notify_all();
+    }
+}
+
+void CoroExecutor::interruptPoll() {
+    uint64_t one = 1;
+    ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+CoroTask<EncodedFramePtr> CoroExecutor::receive(FrameMailbox& mailbox) {
+    while (true) {
+        // 先看执行器是否在停止，否则生产者持续投递时任务永远拿得到帧而无法退出
+        if (stopping()) co_return nullptr;
+        if (auto frame = mailbox.tryPop()) co_return frame;
+        if (mailbox.closed()) co_return nullptr;
+
+        int fd = mailbox.beginWait();
+        if (fd < 0) continue;
+        uint32_t events = co_await ready(fd, EPOLLIN);
+        mailbox.endWait();
+        if (events == 0) co_return nullptr;
+        if (events & EPOLLERR) {
+            // 登记等待失败时不挂起就返回，稍后重试，避免工作线程空转
+            bool fired = co_await sleepFor(std::chrono::milliseconds(1));
+            if (!fired) co_return nullptr;
+        }
+    }
+}
@@ -0,0 +1,233 @@
+/**
+ * @file decode_kernels.cpp
+ * @brief 解码内核实现
+ */
+
+#include "decode_kernels.h"
+#include <limits>
+
+#if defined(KERNEL_DISPATCH_X86)
+#include <immintrin.h>
+#elif defined(KERNEL_DISPATCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/**
+ * @brief 标量实现，处理[begin, boxes)的框
+ */
+void bestScalar(const float* scores, int begin, int boxes, int classes, size_t box_stride, size_t class_stride,
+                float* best_score, int* best_class) {
+    for (int b = begin; b < boxes; ++b) {
+        const float* p = scores + b * box_stride;
+        float best = p[0];
+        int cls = 0;
+        for (int c = 1; c < classes; ++c) {
+            float v = p[c * class_stride];
+            if (v > best) {
+                best = v;
+                cls = c;
+            }
+        }
+        best_score[b] = best;
+        best_class[b] = cls;
+    }
+}
+
+/**
+ * @brief 在连续存放的得分中找出等于最高分的第一个类别
+ */
+inline int firstIndexOf(const float* p, int classes, float best) {
+    for (int c = 0; c < classes; ++c) {
+        if (p[c] == best) return c;
+    }
+    return 0;
+}
+
+#if defined(KERNEL_DISPATCH_X86)
+
+__attribute__((target("sse4.2")))
+void byBoxSse4(const float* scores, int boxes, int classes, size_t box_stride, float* best_score, int* best_class) {
+    for (int b = 0; b < boxes; ++b) {
+        const float* p = scores + b * box_stride;
+        __m128 m = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+        int c = 0;
+        for (; c + 4 <= classes; c += 4) {
+            m = _mm_max_ps(m, _mm_loadu_ps(p + c));
+        }
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+        float best = _mm_cvtss_f32(m);
+        for (; c < classes; ++c) {
+            if (p[c] > best) best = p[c];
+        }
+        best_score[b] = best;
+        best_class[b] = firstIndexOf(p, classes, best);
+    }
+}
+
+__attribute__((target("sse4.2")))
+void byClassSse4(const float* scores, int boxes, int classes, size_t class_stride, float* best_score, int* best_class) {
+    int b = 0;
+    for (; b + 4 <= boxes; b += 4) {
+        __m128 best = _mm_loadu_ps(scores + b);
+        __m128 cls = _mm_castsi128_ps(_mm_setzero_si128());
+        for (int c = 1; c < classes; ++c) {
+            __m128 v = _mm_loadu_ps(scores + c * class_stride + b);
+            __m128 gt = _mm_cmpgt_ps(v, best);
+            best = _mm_blendv_ps(best, v, gt);
+            cls = _mm_blendv_ps(cls, _mm_castsi128_ps(_mm_set1_epi32(c)), gt);
+        }
+        _mm_storeu_ps(best_score + b, best);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(best_class + b), _mm_castps_si128(cls));
+    }
+    bestScalar(scores, b, boxes, classes, 1, class_stride, best_score, best_class);
+}
+
+__attribute__((target("avx2,fma")))
+void byBoxAvx2(const float* scores, int boxes, int classes, size_t box_stride, float* best_score, int* best_class) {
+    for (int b = 0; b < boxes; ++b) {
+        const float* p = scores + b * box_stride;
+        __m256 m = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+        int c = 0;
+        for (; c + 8 <= classes; c += 8) {
+            m = _mm256_max_ps(m, _mm256_loadu_ps(p + c));
+        }
+        __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+        h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+        h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+        float best = _mm_cvtss_f32(h);
+        for (; c < classes; ++c) {
+            if (p[c] > best) best = p[c];
+        }
+        best_score[b] = best;
+        best_class[b] = firstIndexOf(p, classes, best);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void byClassAvx2(const float* scores, int boxes, int classes, size_t class_stride, float* best_score, int* best_class) {
+    int b = 0;
+    for (; b + 8 <= boxes; b += 8) {
+        __m256 best = _mm256_loadu_ps(scores + b);
+        __m256 cls = _mm256_castsi256_ps(_mm256_setzero_si256());
+        for (int c = 1; c < classes; ++c) {
+            __m256 v = _mm256_loadu_ps(scores + c * class_stride + b);
+            __m256 gt = _mm256_cmp_ps(v, best, _CMP_GT_OQ);
+            best = _mm256_blendv_ps(best, v, gt);
+            cls = _mm256_blendv_ps(cls, _mm256_castsi256_ps(_mm256_set1_epi32(c)), gt);
+        }
+        _mm256_storeu_ps(best_score + b, best);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(best_class + b), _mm256_castps_si256(cls));
+    }
+    bestScalar(scores, b, boxes, classes, 1, class_stride, best_score, best_class);
+}
+
+__attribute__((target("avx512f,avx512bw,avx2,fma")))
+void byBoxAvx512(const float* scores, int boxes, int classes, size_t box_stride, float* best_score, int* best_class) {
+    for (int b = 0; b < boxes; ++b) {
+        const float* p = scores + b * box_stride;
+        __m512 m = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+        int c = 0;
+        for (; c + 16 <= classes; c += 16) {
+            m = _mm512_max_ps(m, _mm512_loadu_ps(p + c));
+        }
+        // 不足16个的尾部用掩码加载，不越界读取
+        if (c < classes) {
+            __mmask16 tail = static_cast<__mmask16>((1u << (classes - c)) - 1);
+            m = _mm512_mask_max_ps(m, tail, m, _mm512_maskz_loadu_ps(tail, p + c));
+        }
+        float best = _mm512_reduce_max_ps(m);
+        best_score[b] = best;
+        best_class[b] = firstIndexOf(p, classes, best);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx2,fma")))
+void byClassAvx512(const float* scores, int boxes, int classes, size_t class_stride,
+                   float* best_score, int* best_class) {
+    int b = 0;
+    for (; b + 16 <= boxes; b += 16) {
+        __m512 best = _mm512_loadu_ps(scores + b);
+        __m512i cls = _mm512_setzero_si512();
+        for (int c = 1; c < classes; ++c) {
+            __m512 v = _mm512_loadu_ps(scores + c * class_stride + b);
+            __mmask16 gt = _mm512_cmp_ps_mask(v, best, _CMP_GT_OQ);
+            best = _mm512_mask_mov_ps(best, gt, v);
+            cls = _mm512_mask_mov_epi32(cls, gt, _mm512_set1_epi32(c));
+        }
+        _mm512_storeu_ps(best_score + b, best);
+        _mm512_storeu_si512(best_class + b, cls);
+    }
+    bestScalar(scores, b, boxes, classes, 1, class_stride, best_score, best_class);
+}
+
+#elif defined(KERNEL_DISPATCH_NEON)
+
+void byBoxNeon(const float* scores, int boxes, int classes, size_t box_stride, float* best_score, int* best_class) {
+    for (int b = 0; b < boxes; ++b) {
+        const float* p = scores + b * box_stride;
+        float32x4_t m = vdupq_n_f32(-std::numeric_limits<float>::infinity());
+        int c = 0;
+        for (; c + 4 <= classes; c += 4) {
+            m = vmaxq_f32(m, vld1q_f32(p + c));
+        }
+        float best = vmaxvq_f32(m);
+        for (; c < classes; ++c) {
+            if (p[c] > best) best = p[c];
+        }
+        best_score[b] = best;
+        best_class[b] = firstIndexOf(p, classes, best);
+    }
+}
+
+void byClassNeon(const float* scores, int boxes, int classes, size_t class_stride, float* best_score, int* best_class) {
+    int b = 0;
+    for (; b + 4 <= boxes; b += 4) {
+        float32x4_t best = vld1q_f32(scores + b);
+        int32x4_t cls = vdupq_n_s32(0);
+        for (int c = 1; c < classes; ++c) {
+            float32x4_t v = vld1q_f32(scores + c * class_stride + b);
+            uint32x4_t gt = vcgtq_f32(v, best);
+            best = vbslq_f32(gt, v, best);
+            cls = vbslq_s32(gt, vdupq_n_s32(c), cls);
+        }
+        vst1q_f32(best_score + b, best);
+        vst1q_s32(best_class + b, cls);
+    }
+    bestScalar(scores, b, boxes, classes, 1, class_stride, best_score, best_class);
+}
+
+#endif
+
+} // namespace
+
+void DecodeKernels::bestClass(const float* scores, int boxes, int classes, size_t box_stride, size_t class_stride,
+                              float* best_score, int* best_class, KernelIsa isa) {
+    if (boxes <= 0 || classes <= 0) return;
+    if (!KernelDispatch::supported(isa)) isa = KernelIsa::kScalar;
+
+    using ByBox = void (*)(const float*, int, int, size_t, float*, int*);
+    using ByClass = void (*)(const float*, int, int, size_t, float*, int*);
+    ByBox by_box = nullptr;
+    ByClass by_class = nullptr;
+    switch (isa) {
+#if defined(KERNEL_DISPATCH_X86)
+    case KernelIsa::kSse4: by_box = byBoxSse4; by_class = byClassSse4; break;
+    case KernelIsa::kAvx2: by_box = byBoxAvx2; by_class = byClassAvx2; break;
+    case KernelIsa::kAvx512: by_box = byBoxAvx512; by_class = byClassAvx512; break;
+#elif defined(KERNEL_DISPATCH_NEON)
+    case KernelIsa::kNeon: by_box = byBoxNeon; by_class = byClassNeon; break;
+#endif
+    default: break;
+    }
+
+    if (by_box && class_stride == 1) {
+        by_box(scores, boxes, classes, box_stride, best_score, best_class);
+    } else if (by_class && box_stride == 1) {
+        by_class(scores, boxes, classes, class_stride, best_score, best_class);
+    } else {
+        bestScalar(scores, 0, boxes, classes, box_stride, class_stride, best_score, best_class);
+    }
+}
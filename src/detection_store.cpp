@@ -0,0 +1,428 @@
+/**
+ * @file detection_store.cpp
+ * @brief 检测结果持久化存储实现
+ */
+
+#include "detection_store.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'A', 'M', 'D', 'E', 'T', 0, 0};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kBlockRows = 4096;     ///< 每个索引块的行数
+constexpr size_t kHeaderBytes = 4096;     ///< 文件头占一页
+constexpr size_t kColumnAlign = 64;       ///< 列数组按缓存行对齐
+
+/**
+ * @struct SegmentHeader
+ * @brief 分段文件头
+ */
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;      ///< 分段行数
+    uint32_t block_rows;    ///< 每个索引块的行数
+    uint32_t reserved;
+    int64_t id;             ///< 分段ID
+    uint64_t rows;          ///< 已发布的行数，原子访问
+};
+
+/**
+ * @struct BlockEntry
+ * @brief 稀疏时间索引项
+ */
+struct BlockEntry {
+    int64_t min_ts;
+    int64_t max_ts;
+};
+
+size_t alignUp(size_t value) {
+    return (value + kColumnAlign - 1) / kColumnAlign * kColumnAlign;
+}
+
+/**
+ * @struct Layout
+ * @brief 分段文件中各区域的偏移
+ */
+struct Layout {
+    size_t blocks, ts, camera, class_id, confidence, x, y, width, height, track, total;
+
+    explicit Layout(uint32_t capacity) {
+        size_t rows = capacity;
+        size_t nblocks = (rows + kBlockRows - 1) / kBlockRows;
+        blocks = kHeaderBytes;
+        ts = alignUp(blocks + nblocks * sizeof(BlockEntry));
+        camera = alignUp(ts + rows * sizeof(int64_t));
+        class_id = alignUp(camera + rows * sizeof(uint16_t));
+        confidence = alignUp(class_id + rows * sizeof(uint16_t));
+        x = alignUp(confidence + rows * sizeof(float));
+        y = alignUp(x + rows * sizeof(int16_t));
+        width = alignUp(y + rows * sizeof(int16_t));
+        height = alignUp(width + rows * sizeof(int16_t));
+        track = alignUp(height + rows * sizeof(int16_t));
+        total = alignUp(track + rows * sizeof(uint32_t));
+    }
+};
+
+int16_t clampI16(int value) {
+    return static_cast<int16_t>(std::clamp(value, -32768, 32767));
+}
+
+std::string segmentPath(const std::string& directory, int64_t id) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020" PRId64 ".det", id);
+    return directory + "/" + name;
+}
+
+bool makeDirectories(const std::string& path) {
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        std::string part = path.substr(0, pos);
+        if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (pos == std::string::npos) return true;
+    }
+}
+
+} // namespace
+
+/**
+ * @class DetectionStore::Segment
+ * @brief 映射到内存的单个分段
+ */
+class DetectionStore::Segment {
+public:
+    ~Segment() {
+        if (base_ != MAP_FAILED) munmap(base_, size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    /**
+     * @brief 创建或打开分段文件
+     * @param capacity 新建时的行数，打开已有文件时为0
+     */
+    static std::shared_ptr<Segment> map(const std::string& path, int64_t id, uint32_t capacity) {
+        auto segment = std::shared_ptr<Segment>(new Segment(path));
+        bool create = capacity > 0;
+        segment->fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+        if (segment->fd_ < 0) {
+            std::cerr << "无法打开检测记录分段 " << path << ": " << strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        if (create) {
+            // 预先设定文件长度，未写入的区域不占磁盘空间
+            segment->size_ = Layout(capacity).total;
+            if (ftruncate(segment->fd_, static_cast<off_t>(segment->size_)) != 0) {
+                std::cerr << "无法分配检测记录分段 " << path << ": " << strerror(errno) << std::endl;
+                unlink(path.c_str());
+                return nullptr;
+            }
+        } else {
+            struct stat st;
+            if (fstat(segment->fd_, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderBytes) {
+                return nullptr;
+            }
+            segment->size_ = static_cast<size_t>(st.st_size);
+        }
+
+        segment->base_ = mmap(nullptr, segment->size_, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd_, 0);
+        if (segment->base_ == MAP_FAILED) {
+            std::cerr << "无法映射检测记录分段 " << path << ": " << strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        auto* header = segment->header();
+        if (create) {
+            memcpy(header->magic, kMagic, sizeof(kMagic));
+            header->version = kVersion;
+            header->capacity = capacity;
+            header->block_rows = kBlockRows;
+            header->id = id;
+            header->rows = 0;
+        } else if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion
+                   || header->block_rows != kBlockRows
+                   || Layout(header->capacity).total != segment->size_) {
+            std::cerr << "检测记录分段格式无效: " << path << std::endl;
+            return nullptr;
+        }
+        segment->bind();
+        return segment;
+    }
+
+    int64_t id() const { return header()->id; }
+    uint32_t capacity() const { return header()->capacity; }
+    const std::string& path() const { return path_; }
+
+    uint64_t rows() const {
+        return __atomic_load_n(&header()->rows, __ATOMIC_ACQUIRE);
+    }
+
+    bool full() const { return rows() >= capacity(); }
+
+    /**
+     * @brief 追加一行，调用方保证只有一个写者且分段未满
+     */
+    void append(const DetectionRecord& record) {
+        uint64_t row = rows();
+        ts_[row] = record.timestamp_us;
+        camera_[row] = record.camera;
+        class_id_[row] = record.class_id;
+        confidence_[row] = record.confidence;
+        x_[row] = record.x;
+        y_[row] = record.y;
+        width_[row] = record.width;
+        height_[row] = record.height;
+        track_[row] = record.track_id;
+
+        BlockEntry& block = blocks_[row / kBlockRows];
+        bool first = row % kBlockRows == 0;
+        int64_t min_ts = first ? record.timestamp_us
+            : std::min(__atomic_load_n(&block.min_ts, __ATOMIC_RELAXED), record.timestamp_us);
+        int64_t max_ts = first ? record.timestamp_us
+            : std::max(__atomic_load_n(&block.max_ts, __ATOMIC_RELAXED), record.timestamp_us);
+        __atomic_store_n(&block.min_ts, min_ts, __ATOMIC_RELAXED);
+        __atomic_store_n(&block.max_ts, max_ts, __ATOMIC_RELAXED);
+
+        // 列数据和索引写完后才发布行数
+        __atomic_store_n(&header()->rows, row + 1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * @brief 已发布行中的最大时间戳
+     */
+    int64_t maxTimestamp() const {
+        uint64_t n = rows();
+        int64_t result = INT64_MIN;
+        for (uint64_t b = 0; b * kBlockRows < n; ++b) {
+            result = std::max(result, __atomic_load_n(&blocks_[b].max_ts, __ATOMIC_RELAXED));
+        }
+        return result;
+    }
+
+    /**
+     * @brief 从指定行开始扫描
+     * @return visitor要求停止时返回false
+     */
+    bool scan(const DetectionQuery& query, const Visitor& visitor, uint64_t start) const {
+        uint64_t n = rows();
+        for (uint64_t b = start / kBlockRows; b * kBlockRows < n; ++b) {
+            // 稀疏索引：整块跳过时间不相交的区间
+            int64_t min_ts = __atomic_load_n(&blocks_[b].min_ts, __ATOMIC_RELAXED);
+            int64_t max_ts = __atomic_load_n(&blocks_[b].max_ts, __ATOMIC_RELAXED);
+            if (max_ts < query.from_us || min_ts >= query.to_us) continue;
+
+            uint64_t begin = std::max<uint64_t>(b * kBlockRows, start);
+            uint64_t end = std::min<uint64_t>((b + 1) * kBlockRows, n);
+            for (uint64_t row = begin; row < end; ++row) {
+                // 先只读过滤所需的列
+                int64_t ts = ts_[row];
+                if (ts < query.from_us || ts >= query.to_us) continue;
+                if (query.camera >= 0 && camera_[row] != query.camera) continue;
+                if (query.class_id >= 0 && class_id_[row] != query.class_id) continue;
+                if (confidence_[row] < query.min_confidence) continue;
+
+                DetectionRecord record;
+                record.timestamp_us = ts;
+                record.camera = camera_[row];
+                record.class_id = class_id_[row];
+                record.confidence = confidence_[row];
+                record.x = x_[row];
+                record.y = y_[row];
+                record.width = width_[row];
+                record.height = height_[row];
+                record.track_id = track_[row];
+                if (!visitor(record, DetectionCursor{id(), row + 1})) return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    explicit Segment(std::string path) : path_(std::move(path)) {}
+
+    SegmentHeader* header() const { return static_cast<SegmentHeader*>(base_); }
+
+    template <typename T>
+    T* column(size_t offset) const {
+        return reinterpret_cast<T*>(static_cast<uint8_t*>(base_) + offset);
+    }
+
+    void bind() {
+        Layout layout(header()->capacity);
+        blocks_ = column<BlockEntry>(layout.blocks);
+        ts_ = column<int64_t>(layout.ts);
+        camera_ = column<uint16_t>(layout.camera);
+        class_id_ = column<uint16_t>(layout.class_id);
+        confidence_ = column<float>(layout.confidence);
+        x_ = column<int16_t>(layout.x);
+        y_ = column<int16_t>(layout.y);
+        width_ = column<int16_t>(layout.width);
+        height_ = column<int16_t>(layout.height);
+        track_ = column<uint32_t>(layout.track);
+    }
+
+    std::string path_;             ///< 文件路径
+    int fd_{-1};                   ///< 文件描述符
+    void* base_{MAP_FAILED};       ///< 映射基址
+    size_t size_{0};               ///< 映射长度
+    BlockEntry* blocks_{nullptr};  ///< 块索引
+    int64_t* ts_{nullptr};         ///< 时间戳列
+    uint16_t* camera_{nullptr};    ///< 摄像头列
+    uint16_t* class_id_{nullptr};  ///< 类别列
+    float* confidence_{nullptr};   ///< 置信度列
+    int16_t* x_{nullptr};          ///< 目标框x列
+    int16_t* y_{nullptr};          ///< 目标框y列
+    int16_t* width_{nullptr};      ///< 目标框宽度列
+    int16_t* height_{nullptr};     ///< 目标框高度列
+    uint32_t* track_{nullptr};     ///< 跟踪ID列
+};
+
+DetectionStoreOptions DetectionStoreOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    DetectionStoreOptions options;
+    if (json.isNull()) return options;
+
+    options.directory = json->optValue<std::string>("directory", options.directory);
+    options.retention_days = std::max(json->optValue<int>("retention_days", options.retention_days), 1);
+    options.enabled = json->optValue<bool>("enabled", options.enabled);
+    if (json->has("segment_rows")) {
+        // 分段行数取索引块的整数倍
+        int rows = std::max(json->getValue<int>("segment_rows"), static_cast<int>(kBlockRows));
+        options.segment_rows = static_cast<uint32_t>(rows) / kBlockRows * kBlockRows;
+    }
+    return options;
+}
+
+DetectionStore::DetectionStore(DetectionStoreOptions options)
+    : options_(std::move(options)) {}
+
+DetectionStore::~DetectionStore() = default;
+
+bool DetectionStore::open() {
+    if (!makeDirectories(options_.directory)) {
+        std::cerr << "无法创建检测记录目录 " << options_.directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    DIR* dir = opendir(options_.directory.c_str());
+    if (!dir) return false;
+    std::vector<int64_t> ids;
+    while (dirent* entry = readdir(dir)) {
+        int64_t id;
+        char suffix[8];
+        if (sscanf(entry->d_name, "%" SCNd64 ".%7s", &id, suffix) == 2 && strcmp(suffix, "det") == 0) {
+            ids.push_back(id);
+        }
+    }
+    closedir(dir);
+    std::sort(ids.begin(), ids.end());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.clear();
+    for (int64_t id : ids) {
+        auto segment = Segment::map(segmentPath(options_.directory, id), id, 0);
+        if (segment) segments_.push_back(std::move(segment));
+    }
+    return true;
+}
+
+bool DetectionStore::createSegment(int64_t id) {
+    // 分段ID严格递增，扫描位置依赖这一点
+    if (!segments_.empty() && id <= segments_.back()->id()) {
+        id = segments_.back()->id() + 1;
+    }
+    auto segment = Segment::map(segmentPath(options_.directory, id), id, options_.segment_rows);
+    if (!segment) return false;
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+bool DetectionStore::append(uint16_t camera, const DetectionSet& detections) {
+    int64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(
+        detections.frame_time.time_since_epoch()).count();
+
+    bool rolled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& det : detections.detections) {
+            if (segments_.empty() || segments_.back()->full()) {
+                if (!createSegment(ts)) return false;
+                rolled = true;
+            }
+
+            DetectionRecord record;
+            record.timestamp_us = ts;
+            record.camera = camera;
+            record.class_id = static_cast<uint16_t>(std::max(det.class_id, 0));
+            record.confidence = det.confidence;
+            record.x = clampI16(det.bbox.x);
+            record.y = clampI16(det.bbox.y);
+            record.width = clampI16(det.bbox.width);
+            record.height = clampI16(det.bbox.height);
+            record.track_id = static_cast<uint32_t>(std::max(det.track_id, 0));
+            segments_.back()->append(record);
+        }
+    }
+
+    // 新分段创建时顺带清理过期分段，平时不产生额外开销
+    if (rolled) {
+        applyRetention();
+    }
+    return true;
+}
+
+void DetectionStore::scan(const DetectionQuery& query, const Visitor& visitor,
+                          const DetectionCursor& start) const {
+    std::vector<std::shared_ptr<Segment>> segments;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments = segments_;
+    }
+
+    for (const auto& segment : segments) {
+        if (segment->id() < start.segment) continue;
+        // 分段ID即首条记录时间，之后的分段不会早于它
+        if (segment->id() >= query.to_us) break;
+        uint64_t row = segment->id() == start.segment ? start.row : 0;
+        if (!segment->scan(query, visitor, row)) return;
+    }
+}
+
+void DetectionStore::applyRetention() {
+    int64_t cutoff = std::chrono::duration_cast<std::chrono::microseconds>(
+        (std::chrono::system_clock::now() - std::chrono::hours(24) * options_.retention_days)
+            .time_since_epoch()).count();
+
+    std::vector<std::shared_ptr<Segment>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 正在写入的最后一个分段始终保留
+        while (segments_.size() > 1 && segments_.front()->maxTimestamp() < cutoff) {
+            expired.push_back(segments_.front());
+            segments_.erase(segments_.begin());
+        }
+    }
+    // 正在扫描的读者仍持有映射，删除文件不影响其读取
+    for (const auto& segment : expired) {
+        unlink(segment->path().c_str());
+        std::cout << "已删除过期检测记录 " << segment->path() << std::endl;
+    }
+}
+
+uint64_t DetectionStore::recordCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& segment : segments_) {
+        total += segment->rows();
+    }
+    return total;
+}
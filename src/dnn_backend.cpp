@@ -0,0 +1,259 @@
+/**
+ * @file dnn_backend.cpp
+ * @brief OpenCV DNN推理后端的实现
+ */
+
+#include "dnn_backend.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/**
+ * @class ProtoReader
+ * @brief protobuf线格式的最小读取器
+ * @details cv::dnn::Net不提供模型声明的输入形状，只用它从ONNX文件中取出输入维度
+ */
+class ProtoReader {
+public:
+    ProtoReader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+    /**
+     * @brief 读取下一个字段的编号和线类型，数据读完返回false
+     */
+    bool next(uint32_t& field, uint32_t& wire) {
+        uint64_t key;
+        if (p_ >= end_ || !varint(key)) return false;
+        field = static_cast<uint32_t>(key >> 3);
+        wire = static_cast<uint32_t>(key & 7);
+        return true;
+    }
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && p_ < end_; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(*p_++);
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool bytes(ProtoReader& sub) {
+        uint64_t size;
+        if (!varint(size) || size > static_cast<uint64_t>(end_ - p_)) return false;
+        sub = ProtoReader(p_, static_cast<size_t>(size));
+        p_ += size;
+        return true;
+    }
+
+    bool string(std::string& value) {
+        ProtoReader sub(nullptr, 0);
+        if (!bytes(sub)) return false;
+        value.assign(sub.p_, sub.end_);
+        return true;
+    }
+
+    bool skip(uint32_t wire) {
+        uint64_t value;
+        ProtoReader sub(nullptr, 0);
+        switch (wire) {
+        case 0: return varint(value);
+        case 1: return advance(8);
+        case 2: return bytes(sub);
+        case 5: return advance(4);
+        default: return false;
+        }
+    }
+
+private:
+    bool advance(size_t n) {
+        if (static_cast<size_t>(end_ - p_) < n) return false;
+        p_ += n;
+        return true;
+    }
+
+    const char* p_;     ///< 读取位置
+    const char* end_;   ///< 数据结尾
+};
+
+/**
+ * @brief 解析ValueInfoProto，取出名称和张量形状
+ * @details 形状路径为type(2).tensor_type(1).shape(2).dim(1)，
+ *          维度只有dim_value(1)时为固定值，符号维度或缺省记为-1
+ */
+bool parseValueInfo(ProtoReader reader, std::string& name, std::vector<int64_t>& shape) {
+    uint32_t field, wire;
+    while (reader.next(field, wire)) {
+        ProtoReader type(nullptr, 0);
+        if (field == 1 && wire == 2) {
+            if (!reader.string(name)) return false;
+        } else if (field == 2 && wire == 2) {
+            if (!reader.bytes(type)) return false;
+            ProtoReader tensor(nullptr, 0);
+            while (type.next(field, wire)) {
+                if (field == 1 && wire == 2) {
+                    if (!type.bytes(tensor)) return false;
+                } else if (!type.skip(wire)) {
+                    return false;
+                }
+            }
+            ProtoReader dims(nullptr, 0);
+            while (tensor.next(field, wire)) {
+                if (field == 2 && wire == 2) {
+                    if (!tensor.bytes(dims)) return false;
+                } else if (!tensor.skip(wire)) {
+                    return false;
+                }
+            }
+            ProtoReader dim(nullptr, 0);
+            while (dims.next(field, wire)) {
+                if (field != 1 || wire != 2) {
+                    if (!dims.skip(wire)) return false;
+                    continue;
+                }
+                if (!dims.bytes(dim)) return false;
+                int64_t value = -1;
+                while (dim.next(field, wire)) {
+                    uint64_t v;
+                    if (field == 1 && wire == 0) {
+                        if (!dim.varint(v)) return false;
+                        value = static_cast<int64_t>(v);
+                    } else if (!dim.skip(wire)) {
+                        return false;
+                    }
+                }
+                shape.push_back(value);
+            }
+        } else if (!reader.skip(wire)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 从ONNX文件读取模型输入的形状
+ * @details 取graph(7).input(11)中第一个不是initializer(5)的输入，与ONNX Runtime的第0个输入一致
+ * @return 文件无法解析时返回false
+ */
+bool readInputShape(const std::string& path, std::vector<int64_t>& shape) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ProtoReader model(data.data(), data.size());
+    ProtoReader graph(nullptr, 0);
+    uint32_t field, wire;
+    while (model.next(field, wire)) {
+        if (field == 7 && wire == 2) {
+            if (!model.bytes(graph)) return false;
+        } else if (!model.skip(wire)) {
+            return false;
+        }
+    }
+
+    // 旧版导出的模型把权重也列为输入，先收集initializer名称再挑选
+    std::unordered_set<std::string> initializers;
+    std::vector<ProtoReader> inputs;
+    while (graph.next(field, wire)) {
+        ProtoReader item(nullptr, 0);
+        if (field == 5 && wire == 2) {
+            if (!graph.bytes(item)) return false;
+            std::string name;
+            while (item.next(field, wire)) {
+                if (field == 8 && wire == 2) {
+                    if (!item.string(name)) return false;
+                } else if (!item.skip(wire)) {
+                    return false;
+                }
+            }
+            initializers.insert(name);
+        } else if (field == 11 && wire == 2) {
+            if (!graph.bytes(item)) return false;
+            inputs.push_back(item);
+        } else if (!graph.skip(wire)) {
+            return false;
+        }
+    }
+
+    for (const auto& input : inputs) {
+        std::string name;
+        std::vector<int64_t> dims;
+        if (!parseValueInfo(input, name, dims)) return false;
+        if (initializers.count(name) == 0) {
+            shape = std::move(dims);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @class DnnBinding
+ * @brief 输入blob和推理输出
+ */
+class DnnBinding : public InferenceBinding {
+public:
+    explicit DnnBinding(const cv::Size& input_size) {
+        const int shape[] = {1, 3, input_size.height, input_size.width};
+        input_.create(4, shape, CV_32F);
+    }
+
+    float* input() override { return input_.ptr<float>(); }
+
+    const float* output() const override { return output_.empty() ? nullptr : output_.ptr<float>(); }
+
+    std::vector<int64_t> outputShape() const override {
+        std::vector<int64_t> shape;
+        for (int i = 0; i < output_.dims; ++i) {
+            shape.push_back(output_.size[i]);
+        }
+        return shape;
+    }
+
+    cv::Mat input_;     ///< NCHW输入blob
+    cv::Mat output_;    ///< 推理输出
+};
+
+} // namespace
+
+void DnnBackend::load(const std::string& path) {
+    try {
+        net_ = cv::dnn::readNetFromONNX(path);
+    } catch (const cv::Exception& e) {
+        throw std::runtime_error("OpenCV DNN错误: " + std::string(e.what()));
+    }
+    if (net_.empty()) {
+        throw std::runtime_error("OpenCV DNN无法加载模型: " + path);
+    }
+    net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+    // 输入形状为NCHW，高宽为非正数表示动态尺寸；固定尺寸的模型不能按其他边长运行
+    std::vector<int64_t> input_shape;
+    if (!readInputShape(path, input_shape)) {
+        throw std::runtime_error("无法读取模型输入形状: " + path);
+    }
+    if (input_shape.size() != 4) {
+        throw std::runtime_error("模型输入不是NCHW格式: " + path);
+    }
+    dynamic_ = input_shape[2] <= 0 || input_shape[3] <= 0;
+    input_size_ = dynamic_ ? cv::Size()
+                           : cv::Size(static_cast<int>(input_shape[3]), static_cast<int>(input_shape[2]));
+}
+
+std::unique_ptr<InferenceBinding> DnnBackend::bind(const cv::Size& input_size) {
+    return std::make_unique<DnnBinding>(input_size);
+}
+
+void DnnBackend::run(InferenceBinding& binding) {
+    auto& dnn = static_cast<DnnBinding&>(binding);
+    std::lock_guard<std::mutex> lock(mutex_);
+    net_.setInput(dnn.input_);
+    // forward返回的矩阵与网络内部缓冲共享数据，下一次forward前复制出来；绑定复用时形状不变，复制不再分配内存
+    net_.forward().copyTo(dnn.output_);
+}
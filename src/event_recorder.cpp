@@ -0,0 +1,280 @@
+/**
+ * @file event_recorder.cpp
+ * @brief 检测事件触发的短片录像实现
+ */
+
+#include "event_recorder.h"
+#include "segment_recorder.h"
+#include "thread_tuning.h"
+#include "frame_mailbox.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+using namespace std::chrono_literals;
+
+bool EventRule::matches(const DetectionResult& det) const {
+    if (det.confidence < min_confidence) return false;
+    if (class_id >= 0 && det.class_id != class_id) return false;
+    if (!label.empty() && det.label != label) return false;
+    if (!zone.empty()) {
+        cv::Point center(det.bbox.x + det.bbox.width / 2, det.bbox.y + det.bbox.height / 2);
+        if (!zone.contains(center)) return false;
+    }
+    return true;
+}
+
+EventOptions EventOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    EventOptions options;
+    if (json.isNull()) return options;
+
+    options.directory = json->optValue<std::string>("directory", options.directory);
+    options.pre_seconds = std::max(json->optValue<int>("pre_seconds", options.pre_seconds), 0);
+    options.post_seconds = std::max(json->optValue<int>("post_seconds", options.post_seconds), 1);
+    if (json->has("buffer_mb")) {
+        options.buffer_bytes = static_cast<size_t>(std::max(json->getValue<int>("buffer_mb"), 1)) << 20;
+    }
+    if (json->has("quota_mb")) {
+        options.quota_bytes = static_cast<uint64_t>(std::max(json->getValue<int>("quota_mb"), 1)) << 20;
+    }
+
+    auto rules = json->getArray("rules");
+    if (!rules.isNull()) {
+        for (size_t i = 0; i < rules->size(); ++i) {
+            auto item = rules->getObject(static_cast<unsigned>(i));
+            if (item.isNull()) continue;
+            EventRule rule;
+            rule.class_id = item->optValue<int>("class_id", rule.class_id);
+            rule.label = item->optValue<std::string>("class", rule.label);
+            rule.min_confidence = static_cast<float>(
+                item->optValue<double>("min_confidence", rule.min_confidence));
+            auto zone = item->getObject("zone");
+            if (!zone.isNull()) {
+                rule.zone = cv::Rect(zone->getValue<int>("x"), zone->getValue<int>("y"),
+                                     zone->getValue<int>("width"), zone->getValue<int>("height"));
+            }
+            options.rules.push_back(rule);
+        }
+    }
+    return options;
+}
+
+EventRecorder::EventRecorder(std::shared_ptr<CaptureInterface> capture,
+                             std::shared_ptr<RuntimeConfigStore> config,
+                             EventOptions options)
+    : capture_(std::move(capture))
+    , config_(config ? std::move(config) : std::make_shared<RuntimeConfigStore>())
+    , options_(std::move(options))
+    , ring_(options_.buffer_bytes) {}
+
+EventRecorder::~EventRecorder() {
+    stop();
+}
+
+bool EventRecorder::start() {
+    if (running_) return true;
+
+    if (mkdir(options_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "无法创建事件录像目录 " << options_.directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    SegmentRecorder::pruneDirectory(options_.directory, options_.quota_bytes);
+
+    running_ = true;
+    ingest_thread_ = std::thread(&EventRecorder::ingestLoop, this);
+    writer_thread_ = std::thread(&EventRecorder::writerLoop, this);
+    return true;
+}
+
+void EventRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (ingest_thread_.joinable()) {
+        ingest_thread_.join();
+    }
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+}
+
+void EventRecorder::onDetections(const DetectionSet& detections) {
+    const EventRule* hit = nullptr;
+    const DetectionResult* det = nullptr;
+    for (const auto& d : detections.detections) {
+        for (const auto& rule : options_.rules) {
+            if (rule.matches(d)) {
+                hit = &rule;
+                det = &d;
+                break;
+            }
+        }
+        if (hit) break;
+    }
+    if (!hit) return;
+
+    auto end = detections.frame_time + std::chrono::seconds(options_.post_seconds);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!triggered_) {
+            triggered_ = true;
+            event_start_ = detections.frame_time;
+            event_end_ = end;
+            event_label_ = det->label;
+            ++status_.events;
+        } else {
+            event_end_ = std::max(event_end_, end);
+        }
+    }
+    cv_.notify_one();
+}
+
+EventRecorder::Status EventRecorder::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+Poco::JSON::Object EventRecorder::toJson(const Status& status) {
+    Poco::JSON::Object json;
+    json.set("active", status.active);
+    json.set("current_file", status.current_file);
+    json.set("events", status.events);
+    json.set("clips", status.clips);
+    json.set("frames_written", status.frames_written);
+    json.set("frames_lost", status.frames_lost);
+    return json;
+}
+
+void EventRecorder::ingestLoop() {
+    ThreadTuning::apply("recording", "event-ring");
+
+    auto mailbox = capture_->subscribe("event-ring", MailboxOptions{MailboxPolicy::kQueue, 4});
+    while (running_) {
+        auto frame = mailbox->pop(200ms);
+        if (!frame) continue;
+
+        ring_.push(*frame);
+        bool notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_sequence_ = frame->sequence;
+            notify = triggered_;
+        }
+        if (notify) cv_.notify_one();
+    }
+    mailbox->close();
+}
+
+void EventRecorder::writerLoop() {
+    SegmentRecorder::lowerThreadPriority();
+    ThreadTuning::apply("recording", "event-writer");
+
+    std::string jpeg;
+    uint64_t last_written = 0;
+    while (running_) {
+        std::chrono::system_clock::time_point since;
+        std::chrono::system_clock::time_point end;
+        std::string label;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, 200ms, [&] {
+                return !running_ || (triggered_ && latest_sequence_ > last_written);
+            });
+            if (!triggered_) continue;
+            since = event_start_ - std::chrono::seconds(options_.pre_seconds);
+            end = event_end_;
+            label = event_label_;
+        }
+
+        // 逐帧拷出后在锁外写盘，采集线程可以继续覆盖环中更早的帧
+        bool past_end = false;
+        uint64_t lost = 0;
+        uint64_t written = 0;
+        FrameRing::FrameInfo info;
+        while (ring_.readNext(last_written, since, info, jpeg)) {
+            if (info.wall_time > end) {
+                past_end = true;
+                break;
+            }
+            if (!writer_.isOpen()) {
+                if (!openClip(info, label)) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    triggered_ = false;
+                    break;
+                }
+            } else if (info.sequence > last_written + 1) {
+                lost += info.sequence - last_written - 1;
+            }
+
+            bool frame_written = false;
+            bool ok = writer_.writeFrameAt(jpeg.data(), jpeg.size(),
+                std::chrono::duration_cast<std::chrono::microseconds>(info.wall_time - clip_start_),
+                frame_written);
+            last_written = info.sequence;
+            if (frame_written) ++written;
+            if (!ok) {
+                std::cerr << "事件短片写入失败" << std::endl;
+                past_end = true;
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            status_.frames_written += written;
+            status_.frames_lost += lost;
+        }
+
+        // 超过结束时间的帧已到达，或摄像头停止出帧，事件结束
+        if (!past_end && std::chrono::system_clock::now() < end + 1s) continue;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (event_end_ > end && writer_.isOpen()) continue;  // 期间再次触发，继续录制
+            triggered_ = false;
+        }
+        closeClip();
+        last_written = 0;
+    }
+    closeClip();
+}
+
+bool EventRecorder::openClip(const FrameRing::FrameInfo& first, const std::string& label) {
+    std::string name = SegmentRecorder::timestampName(first.wall_time);
+    if (!label.empty()) {
+        name += "-";
+        for (char c : label) {
+            name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        }
+    }
+    name += ".avi";
+
+    int fps = config_->current()->target_fps;
+    if (!writer_.open(options_.directory + "/" + name, first.width, first.height, fps)) {
+        return false;
+    }
+    clip_start_ = first.wall_time;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.active = true;
+    status_.current_file = name;
+    return true;
+}
+
+void EventRecorder::closeClip() {
+    if (!writer_.isOpen()) return;
+
+    if (!writer_.close()) {
+        std::cerr << "事件短片收尾失败" << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_.active = false;
+        status_.current_file.clear();
+        ++status_.clips;
+    }
+    SegmentRecorder::pruneDirectory(options_.directory, options_.quota_bytes);
+}
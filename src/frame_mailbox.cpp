@@ -0,0 +1,263 @@
+/**
+ * @file frame_mailbox.cpp
+ * @brief 流水线帧信箱实现
+ */
+
+#include "frame_mailbox.h"
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <ctime>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kDefaultQueueDepth = 4;    ///< 队列策略未指定深度时的默认值
+constexpr size_t kMaxQueueDepth = 256;      ///< 队列深度上限
+
+/**
+ * @brief 在word上等待，直到其值不等于expected、被唤醒或超时
+ */
+void futexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+}
+
+/**
+ * @brief 唤醒在word上等待的所有线程
+ */
+void futexWake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "futex要求原子变量与uint32_t布局一致");
+
+MailboxOptions MailboxOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    MailboxOptions options;
+    if (json.isNull()) return options;
+
+    if (json->optValue<std::string>("policy", "latest") == "queue") {
+        options.policy = MailboxPolicy::kQueue;
+        options.depth = static_cast<size_t>(std::clamp<int>(
+            json->optValue<int>("depth", static_cast<int>(kDefaultQueueDepth)), 1, static_cast<int>(kMaxQueueDepth)));
+    }
+    return options;
+}
+
+PipelineOptions PipelineOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    PipelineOptions options;
+    if (json.isNull()) return options;
+
+    for (const auto& name : json->getNames()) {
+        auto stage = json->getObject(name);
+        if (!stage.isNull()) {
+            options.stages[name] = MailboxOptions::fromJson(stage);
+        }
+    }
+    return options;
+}
+
+MailboxOptions PipelineOptions::forStage(const std::string& stage, MailboxOptions defaults) const {
+    auto it = stages.find(stage);
+    return it != stages.end() ? it->second : defaults;
+}
+
+FrameMailbox::FrameMailbox(std::string stage, MailboxOptions options)
+    : stage_(std::move(stage))
+    , options_(options) {
+    if (options_.policy == MailboxPolicy::kQueue) {
+        options_.depth = std::max<size_t>(options_.depth, 1);
+        ring_.reset(new EncodedFramePtr[options_.depth]);
+    } else {
+        options_.depth = 1;
+    }
+}
+
+FrameMailbox::~FrameMailbox() {
+    int fd = event_fd_.load(std::memory_order_relaxed);
+    if (fd >= 0) ::close(fd);
+}
+
+bool FrameMailbox::push(EncodedFramePtr frame) {
+    if (closed()) return false;
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+
+    bool accepted = true;
+    if (options_.policy == MailboxPolicy::kLatest) {
+        slots_[back_] = std::move(frame);
+        uint32_t previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = previous & kIndexMask;
+        if (previous & kFresh) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // 换回的槽位中是被替换的旧帧或已被取走后留下的空指针，立即释放，帧尽早回到缓冲池
+        slots_[back_].reset();
+    } else {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= options_.depth) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            accepted = false;
+        } else {
+            ring_[tail % options_.depth] = std::move(frame);
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    if (accepted) {
+        signal_.fetch_add(1, std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst)) {
+            wake();
+        }
+    }
+    return accepted;
+}
+
+void FrameMailbox::wake() {
+    int fd = event_fd_.load(std::memory_order_acquire);
+    if (fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(fd, &one, sizeof(one));
+        (void)written;
+    } else {
+        futexWake(&signal_);
+    }
+}
+
+bool FrameMailbox::hasFrame() const {
+    if (options_.policy == MailboxPolicy::kLatest) {
+        return middle_.load(std::memory_order_acquire) & kFresh;
+    }
+    return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire);
+}
+
+EncodedFramePtr FrameMailbox::tryPop() {
+    EncodedFramePtr frame;
+    if (options_.policy == MailboxPolicy::kLatest) {
+        if (!(middle_.load(std::memory_order_acquire) & kFresh)) return nullptr;
+        // 只有消费者清除kFresh，交换得到的必然是新帧
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        frame = std::move(slots_[front_]);
+    } else {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+        frame = std::move(ring_[head % options_.depth]);
+        head_.store(head + 1, std::memory_order_release);
+    }
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+EncodedFramePtr FrameMailbox::pop(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        uint32_t seen = signal_.load(std::memory_order_acquire);
+        if (auto frame = tryPop()) return frame;
+        if (closed()) return nullptr;
+
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) return nullptr;
+
+        // 先声明等待再复查：生产者递增signal_后读取waiting_，两者不会同时错过对方
+        waiting_.store(true, std::memory_order_seq_cst);
+        if (signal_.load(std::memory_order_seq_cst) == seen) {
+            futexWait(&signal_, seen, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+}
+
+int FrameMailbox::beginWait() {
+    if (event_fd_.load(std::memory_order_relaxed) < 0) {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("创建eventfd失败: " + stage_);
+        }
+        event_fd_.store(fd, std::memory_order_release);
+    }
+
+    // 与pop()相同，先声明等待再复查，生产者和消费者不会同时错过对方
+    waiting_.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (hasFrame() || closed()) {
+        waiting_.store(false, std::memory_order_relaxed);
+        return -1;
+    }
+    return event_fd_.load(std::memory_order_relaxed);
+}
+
+void FrameMailbox::endWait() {
+    waiting_.store(false, std::memory_order_relaxed);
+    uint64_t count = 0;
+    ssize_t consumed = ::read(event_fd_.load(std::memory_order_relaxed), &count, sizeof(count));
+    (void)consumed;
+}
+
+void FrameMailbox::close() {
+    closed_.store(true, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_seq_cst);
+    wake();
+}
+
+MailboxStats FrameMailbox::stats() const {
+    MailboxStats s;
+    s.stage = stage_;
+    s.policy = options_.policy;
+    s.depth = options_.depth;
+    s.pushed = pushed_.load(std::memory_order_relaxed);
+    s.delivered = delivered_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+FrameFanout::FrameFanout()
+    : mailboxes_(std::make_shared<const MailboxList>()) {}
+
+void FrameFanout::configure(PipelineOptions options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = std::move(options);
+}
+
+std::shared_ptr<FrameMailbox> FrameFanout::subscribe(const std::string& stage, MailboxOptions defaults) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto mailbox = std::make_shared<FrameMailbox>(stage, options_.forStage(stage, defaults));
+
+    auto current = std::atomic_load(&mailboxes_);
+    auto next = std::make_shared<MailboxList>();
+    for (const auto& existing : *current) {
+        if (!existing->closed()) next->push_back(existing);
+    }
+    next->push_back(mailbox);
+    std::atomic_store(&mailboxes_, std::shared_ptr<const MailboxList>(std::move(next)));
+    return mailbox;
+}
+
+void FrameFanout::publish(const EncodedFramePtr& frame) {
+    auto mailboxes = std::atomic_load(&mailboxes_);
+    for (const auto& mailbox : *mailboxes) {
+        mailbox->push(frame);
+    }
+}
+
+void FrameFanout::closeAll() {
+    auto mailboxes = std::atomic_load(&mailboxes_);
+    for (const auto& mailbox : *mailboxes) {
+        mailbox->close();
+    }
+}
+
+std::vector<MailboxStats> FrameFanout::stats() const {
+    auto mailboxes = std::atomic_load(&mailboxes_);
+    std::vector<MailboxStats> result;
+    for (const auto& mailbox : *mailboxes) {
+        if (!mailbox->closed()) result.push_back(mailbox->stats());
+    }
+    return result;
+}
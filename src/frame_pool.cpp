@@ -0,0 +1,143 @@
+/**
+ * @file frame_pool.cpp
+ * @brief 帧缓冲池实现
+ */
+
+#include "frame_pool.h"
+#include <new>
+
+namespace {
+
+constexpr size_t kControlBlockSize = 128;   ///< 为shared_ptr控制块预留的空间
+constexpr size_t kMessageReserve = 1024;    ///< 帧信息文本和消息前缀的预留容量(约80个检测框)
+
+} // namespace
+
+/**
+ * @struct FramePool::Slot
+ * @brief 池中的一个槽位
+ */
+struct FramePool::Slot {
+    EncodedFrame frame;                                             ///< 复用的帧
+    alignas(std::max_align_t) unsigned char control[kControlBlockSize]; ///< 控制块存储
+    std::atomic<uint32_t> next{kNil};                               ///< 空闲栈中的下一个槽位
+};
+
+/**
+ * @class FramePool::SlotAllocator
+ * @brief 把shared_ptr控制块放进槽位自带存储的分配器
+ * @details 控制块析构之后才调用deallocate，此时槽位不再被任何引用访问，可以安全归还
+ */
+template <typename T>
+class FramePool::SlotAllocator {
+public:
+    using value_type = T;
+
+    SlotAllocator(std::shared_ptr<FramePool> pool, uint32_t index)
+        : pool_(std::move(pool)), index_(index) {}
+
+    template <typename U>
+    SlotAllocator(const SlotAllocator<U>& other) : pool_(other.pool_), index_(other.index_) {}
+
+    T* allocate(size_t n) {
+        static_assert(sizeof(T) <= kControlBlockSize, "控制块超出槽位预留空间");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "控制块对齐要求过高");
+        if (n != 1) throw std::bad_alloc();
+        return reinterpret_cast<T*>(pool_->slots_[index_].control);
+    }
+
+    void deallocate(T*, size_t) {
+        pool_->release(index_);
+    }
+
+    template <typename U>
+    bool operator==(const SlotAllocator<U>& other) const {
+        return pool_ == other.pool_ && index_ == other.index_;
+    }
+
+    template <typename U>
+    bool operator!=(const SlotAllocator<U>& other) const { return !(*this == other); }
+
+private:
+    template <typename U> friend class SlotAllocator;
+
+    std::shared_ptr<FramePool> pool_;   ///< 所属缓冲池
+    uint32_t index_;                    ///< 槽位序号
+};
+
+std::shared_ptr<FramePool> FramePool::create(size_t slots, int width, int height, size_t jpeg_capacity) {
+    return std::shared_ptr<FramePool>(new FramePool(slots, width, height, jpeg_capacity));
+}
+
+FramePool::FramePool(size_t slots, int width, int height, size_t jpeg_capacity)
+    : slots_(new Slot[slots])
+    , capacity_(slots)
+    , width_(width)
+    , height_(height)
+    , jpeg_capacity_(jpeg_capacity)
+    , free_head_(kNil) {
+    for (size_t i = 0; i < slots; ++i) {
+        Slot& slot = slots_[i];
+        slot.frame.image.create(height, width, CV_8UC3);
+        slot.frame.jpeg.reserve(jpeg_capacity);
+        slot.frame.info.reserve(kMessageReserve);
+        slot.frame.prefix.reserve(kMessageReserve);
+        slot.next.store(i + 1 < slots ? static_cast<uint32_t>(i + 1) : kNil, std::memory_order_relaxed);
+    }
+    free_head_.store(slots > 0 ? 0 : kNil, std::memory_order_release);
+}
+
+FramePool::~FramePool() = default;
+
+std::shared_ptr<EncodedFrame> FramePool::acquire() {
+    ++acquired_;
+
+    // 出栈：版本号随每次修改递增，避免ABA
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(head) != kNil) {
+        uint32_t index = static_cast<uint32_t>(head);
+        uint32_t next = slots_[index].next.load(std::memory_order_relaxed);
+        uint64_t desired = ((head >> 32) + 1) << 32 | next;
+        if (free_head_.compare_exchange_weak(head, desired,
+                                             std::memory_order_acquire, std::memory_order_acquire)) {
+            ++in_use_;
+            EncodedFrame* frame = &slots_[index].frame;
+            frame->jpeg.clear();
+            frame->info.clear();
+            frame->prefix.clear();
+            // 删除器为空操作：帧对象常驻槽位，控制块释放时由分配器归还槽位
+            return std::shared_ptr<EncodedFrame>(frame, [](EncodedFrame*) {},
+                                                 SlotAllocator<EncodedFrame>(shared_from_this(), index));
+        }
+    }
+
+    ++exhausted_;
+    auto frame = std::make_shared<EncodedFrame>();
+    frame->image.create(height_, width_, CV_8UC3);
+    frame->jpeg.reserve(jpeg_capacity_);
+    frame->info.reserve(kMessageReserve);
+    frame->prefix.reserve(kMessageReserve);
+    return frame;
+}
+
+void FramePool::release(uint32_t index) {
+    // 原始图像引用着驱动缓冲，槽位空闲期间不应继续占用
+    slots_[index].frame.raw.reset();
+    --in_use_;
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    uint64_t desired;
+    do {
+        slots_[index].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        desired = ((head >> 32) + 1) << 32 | index;
+    } while (!free_head_.compare_exchange_weak(head, desired,
+                                               std::memory_order_release, std::memory_order_relaxed));
+}
+
+FramePool::Stats FramePool::stats() const {
+    Stats s;
+    s.capacity = capacity_;
+    s.in_use = in_use_.load(std::memory_order_relaxed);
+    s.acquired = acquired_.load(std::memory_order_relaxed);
+    s.exhausted = exhausted_.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file frame_protocol.cpp
+ * @brief 紧凑二进制帧消息格式实现
+ */
+
+#include "frame_protocol.h"
+#include <algorithm>
+
+namespace {
+
+void putU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint16_t clampI16(int value) {
+    return static_cast<uint16_t>(static_cast<int16_t>(std::clamp(value, -32768, 32767)));
+}
+
+} // namespace
+
+void FrameProtocol::encodePrefix(const EncodedFrame& frame, const DetectionSet* detections,
+                                 std::chrono::microseconds age, std::string& out) {
+    size_t count = detections ? std::min<size_t>(detections->detections.size(), 0xFFFF) : 0;
+
+    out.clear();
+    out.reserve(kHeaderSize + count * kBoxSize);
+    out.append("CAMF", 4);
+    out.push_back(static_cast<char>(kVersion));
+    out.push_back(static_cast<char>(kHeaderSize));
+    putU16(out, static_cast<uint16_t>(count));
+    putU16(out, static_cast<uint16_t>(frame.width));
+    putU16(out, static_cast<uint16_t>(frame.height));
+    putU16(out, static_cast<uint16_t>(kBoxSize));
+    putU16(out, 0);
+    putU64(out, frame.sequence);
+    putU64(out, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        frame.wall_time.time_since_epoch()).count()));
+    putU64(out, detections ? detections->frame_sequence : 0);
+    putU32(out, static_cast<uint32_t>(std::clamp<int64_t>(age.count(), 0, UINT32_MAX)));
+    putU32(out, frame.device_sequence);
+
+    for (size_t i = 0; i < count; ++i) {
+        const DetectionResult& det = detections->detections[i];
+        putU16(out, static_cast<uint16_t>(std::max(det.class_id, 0)));
+        putU16(out, static_cast<uint16_t>(std::clamp(det.confidence, 0.0f, 1.0f) * 65535.0f + 0.5f));
+        putU16(out, clampI16(det.bbox.x));
+        putU16(out, clampI16(det.bbox.y));
+        putU16(out, clampI16(det.bbox.width));
+        putU16(out, clampI16(det.bbox.height));
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file frame_ring.cpp
+ * @brief 按字节容量限定的已编码帧环形缓冲实现
+ */
+
+#include "frame_ring.h"
+#include <algorithm>
+#include <cstring>
+
+FrameRing::FrameRing(size_t capacity_bytes, size_t max_frames)
+    : arena_(new uint8_t[capacity_bytes])
+    , capacity_(capacity_bytes)
+    , slots_(std::max<size_t>(max_frames, 1)) {}
+
+void FrameRing::popOldest() {
+    head_ = (head_ + 1) % slots_.size();
+    --count_;
+}
+
+bool FrameRing::push(const EncodedFrame& frame) {
+    size_t size = frame.jpeg.size();
+    if (size == 0 || size > capacity_) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // 帧数据保持连续：末尾放不下时回到开头，末尾剩余空间本轮不再使用
+    size_t offset = write_offset_;
+    size_t tail_begin = capacity_;
+    if (offset + size > capacity_) {
+        tail_begin = offset;
+        offset = 0;
+    }
+
+    // 字节区按写入顺序循环使用，与新数据区间(以及被放弃的末尾区间)重叠的必然是最早的帧
+    while (count_ > 0) {
+        const Slot& oldest = slots_[head_];
+        bool overlaps = oldest.offset < offset + size && offset < oldest.offset + oldest.size;
+        bool in_tail = oldest.offset + oldest.size > tail_begin;
+        if (!overlaps && !in_tail && count_ < slots_.size()) break;
+        popOldest();
+    }
+
+    memcpy(arena_.get() + offset, frame.jpeg.data(), size);
+    Slot& slot = slots_[(head_ + count_) % slots_.size()];
+    slot.offset = offset;
+    slot.size = size;
+    slot.info.sequence = frame.sequence;
+    slot.info.wall_time = frame.wall_time;
+    slot.info.width = frame.width;
+    slot.info.height = frame.height;
+    ++count_;
+    write_offset_ = offset + size;
+    return true;
+}
+
+bool FrameRing::readNext(uint64_t after_sequence, std::chrono::system_clock::time_point since,
+                         FrameInfo& info, std::string& jpeg) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count_; ++i) {
+        const Slot& slot = slots_[(head_ + i) % slots_.size()];
+        if (slot.info.sequence <= after_sequence || slot.info.wall_time < since) continue;
+
+        info = slot.info;
+        jpeg.assign(reinterpret_cast<const char*>(arena_.get() + slot.offset), slot.size);
+        return true;
+    }
+    return false;
+}
+
+uint64_t FrameRing::oldestSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_ > 0 ? slots_[head_].info.sequence : 0;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file h264_streamer.cpp
+ * @brief H.264实时编码推流实现
+ */
+
+#include "h264_streamer.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
+}
+
+namespace {
+
+constexpr int kTimeBase = 90000;             ///< 编码时间基(MP4视频常用的90kHz)
+constexpr int kAvioBufferSize = 64 * 1024;   ///< 封装器输出缓冲大小
+
+/**
+ * @brief 封装器的输出回调，把写出的数据追加到opaque指向的字符串
+ * @details FFmpeg 7起回调的数据参数改为const指针
+ */
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+int appendOutput(void* opaque, const uint8_t* data, int size) {
+#else
+int appendOutput(void* opaque, uint8_t* data, int size) {
+#endif
+    static_cast<std::string*>(opaque)->append(reinterpret_cast<const char*>(data), size);
+    return size;
+}
+
+} // namespace
+
+H264Options H264Options::fromJson(const Poco::JSON::Object::Ptr& json) {
+    H264Options options;
+    if (json.isNull()) return options;
+
+    options.enabled = json->optValue<bool>("enabled", options.enabled);
+    options.bitrate_kbps = std::clamp(json->optValue<int>("bitrate_kbps", options.bitrate_kbps), 100, 20000);
+    options.gop_seconds = std::max(json->optValue<int>("gop_seconds", options.gop_seconds), 1);
+    options.encoder = json->optValue<std::string>("encoder", options.encoder);
+    return options;
+}
+
+H264Streamer::H264Streamer(StreamReactor* reactor, uint32_t stream_key,
+                           std::shared_ptr<RuntimeConfigStore> config, H264Options options,
+                           std::chrono::system_clock::time_point origin)
+    : reactor_(reactor)
+    , stream_key_(stream_key)
+    , config_(config ? std::move(config) : std::make_shared<RuntimeConfigStore>())
+    , options_(std::move(options))
+    , origin_(origin) {}
+
+H264Streamer::~H264Streamer() {
+    stop();
+}
+
+bool H264Streamer::start() {
+    if (!options_.encoder.empty()) {
+        codec_ = avcodec_find_encoder_by_name(options_.encoder.c_str());
+    } else {
+        for (const char* name : {"libx264", "libopenh264"}) {
+            codec_ = avcodec_find_encoder_by_name(name);
+            if (codec_) break;
+        }
+        if (!codec_) codec_ = avcodec_find_encoder(AV_CODEC_ID_H264);
+    }
+    if (!codec_) {
+        std::cerr << "未找到可用的H.264编码器" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void H264Streamer::stop() {
+    closeEncoder();
+
+    std::lock_guard<std::mutex> lock(viewers_mutex_);
+    init_segment_.reset();
+    pending_viewers_.clear();
+}
+
+uint64_t H264Streamer::addViewer(int fd) {
+    // 与分片广播互斥：连接要么在初始化段之后才被加入，要么排队等待初始化段，
+    // 反应器按投递顺序处理同一连接的任务，因此初始化段总是先于媒体分片到达
+    std::lock_guard<std::mutex> lock(viewers_mutex_);
+    uint64_t conn_id = reactor_->addWebSocket(fd, stream_key_);
+    if (conn_id != 0) {
+        greetViewer(conn_id);
+    }
+    return conn_id;
+}
+
+void H264Streamer::attachViewer(uint64_t conn_id) {
+    std::lock_guard<std::mutex> lock(viewers_mutex_);
+    reactor_->setStreamKey(conn_id, stream_key_);
+    greetViewer(conn_id);
+}
+
+void H264Streamer::greetViewer(uint64_t conn_id) {
+    if (init_segment_) {
+        reactor_->send(conn_id, init_segment_, true);
+    } else {
+        pending_viewers_.push_back(conn_id);
+    }
+    keyframe_requested_ = true;
+}
+
+bool H264Streamer::openEncoder(int width, int height) {
+    encoder_ = avcodec_alloc_context3(codec_);
+    if (!encoder_) return false;
+
+    int fps = config_->current()->target_fps;
+    encoder_->width = width;
+    encoder_->height = height;
+    encoder_->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder_->time_base = AVRational{1, kTimeBase};
+    encoder_->framerate = AVRational{fps, 1};
+    encoder_->gop_size = fps * options_.gop_seconds;
+    encoder_->max_b_frames = 0;
+    encoder_->bit_rate = static_cast<int64_t>(options_.bitrate_kbps) * 1000;
+    // SPS/PPS放入extradata，由封装器写进初始化段的avcC
+    encoder_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary* codec_options = nullptr;
+    if (std::string(codec_->name) == "libx264") {
+        av_dict_set(&codec_options, "preset", "veryfast", 0);
+        av_dict_set(&codec_options, "tune", "zerolatency", 0);
+        av_dict_set(&codec_options, "profile", "baseline", 0);
+        av_dict_set(&codec_options, "forced-idr", "1", 0);   // 请求的关键帧为IDR，MSE可从此处开始解码
+    }
+    int ret = avcodec_open2(encoder_, codec_, &codec_options);
+    av_dict_free(&codec_options);
+    if (ret < 0) {
+        std::cerr << "打开H.264编码器失败: " << ret << std::endl;
+        closeEncoder();
+        return false;
+    }
+
+    // 输出到内存：每次刷新后output_中即为一个完整的初始化段或分片
+    if (avformat_alloc_output_context2(&muxer_, nullptr, "mp4", nullptr) < 0) {
+        closeEncoder();
+        return false;
+    }
+    auto* buffer = static_cast<uint8_t*>(av_malloc(kAvioBufferSize));
+    muxer_->pb = avio_alloc_context(buffer, kAvioBufferSize, 1, &output_, nullptr, appendOutput, nullptr);
+    muxer_->flags |= AVFMT_FLAG_CUSTOM_IO;
+    AVStream* stream = avformat_new_stream(muxer_, nullptr);
+    if (!muxer_->pb || !stream
+        || avcodec_parameters_from_context(stream->codecpar, encoder_) < 0) {
+        closeEncoder();
+        return false;
+    }
+    stream->time_base = encoder_->time_base;
+
+    // empty_moov：moov中不含样本，可立即生成初始化段；
+    // frag_custom：由av_write_frame(nullptr)逐帧切分片；default_base_moof：MSE要求的偏移方式
+    AVDictionary* muxer_options = nullptr;
+    av_dict_set(&muxer_options, "movflags", "empty_moov+default_base_moof+frag_custom", 0);
+    ret = avformat_write_header(muxer_, &muxer_options);
+    av_dict_free(&muxer_options);
+    if (ret < 0) {
+        std::cerr << "写入fMP4初始化段失败: " << ret << std::endl;
+        closeEncoder();
+        return false;
+    }
+    avio_flush(muxer_->pb);
+    auto init = std::make_shared<const std::string>(std::move(output_));
+    output_.clear();
+
+    picture_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!picture_ || !packet_) {
+        closeEncoder();
+        return false;
+    }
+    picture_->format = AV_PIX_FMT_YUV420P;
+    picture_->width = width;
+    picture_->height = height;
+    width_ = width;
+    height_ = height;
+    last_pts_ = -1;
+
+    std::lock_guard<std::mutex> lock(viewers_mutex_);
+    if (init_segment_) {
+        // 尺寸变化后重新打开：已在观看的连接需要新的初始化段
+        reactor_->broadcast(init, true, false, stream_key_);
+    }
+    init_segment_ = init;
+    for (uint64_t conn_id : pending_viewers_) {
+        reactor_->send(conn_id, init, true);
+    }
+    pending_viewers_.clear();
+    keyframe_requested_ = true;
+    return true;
+}
+
+void H264Streamer::closeEncoder() {
+    if (muxer_) {
+        if (muxer_->pb) {
+            av_freep(&muxer_->pb->buffer);
+            avio_context_free(&muxer_->pb);
+        }
+        avformat_free_context(muxer_);
+        muxer_ = nullptr;
+    }
+    avcodec_free_context(&encoder_);
+    av_frame_free(&picture_);
+    av_packet_free(&packet_);
+    output_.clear();
+    width_ = 0;
+    height_ = 0;
+}
+
+bool H264Streamer::encode(const cv::Mat& image, const EncodedFrame& frame) {
+    if (failed_) return false;
+
+    // 4:2:0采样要求偶数尺寸
+    int width = image.cols & ~1;
+    int height = image.rows & ~1;
+    if (width != width_ || height != height_) {
+        closeEncoder();
+        if (!openEncoder(width, height)) {
+            failed_ = true;
+            return false;
+        }
+    }
+
+    cv::Mat yuv;
+    cv::cvtColor(image(cv::Rect(0, 0, width, height)), yuv, cv::COLOR_BGR2YUV_I420);
+    picture_->data[0] = yuv.data;
+    picture_->data[1] = yuv.data + width * height;
+    picture_->data[2] = picture_->data[1] + width * height / 4;
+    picture_->linesize[0] = width;
+    picture_->linesize[1] = width / 2;
+    picture_->linesize[2] = width / 2;
+
+    // 时间戳取自采集时间，跳帧时播放端按真实间隔显示
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(frame.wall_time - origin_).count();
+    int64_t pts = std::max(av_rescale(us, kTimeBase, 1000000), last_pts_ + 1);
+    last_pts_ = pts;
+    picture_->pts = pts;
+    // 有观看者因积压跳过了解码链时，反应器请求关键帧，让其尽快恢复而不必等到下一个GOP
+    if (reactor_->takeResync(stream_key_)) {
+        keyframe_requested_ = true;
+    }
+    picture_->pict_type = keyframe_requested_.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+    if (avcodec_send_frame(encoder_, picture_) < 0) {
+        failed_ = true;
+        return false;
+    }
+    while (avcodec_receive_packet(encoder_, packet_) == 0) {
+        bool keyframe = (packet_->flags & AV_PKT_FLAG_KEY) != 0;
+        packet_->stream_index = 0;
+        av_packet_rescale_ts(packet_, encoder_->time_base, muxer_->streams[0]->time_base);
+        int ret = av_write_frame(muxer_, packet_);
+        av_packet_unref(packet_);
+        if (ret < 0 || av_write_frame(muxer_, nullptr) < 0) {
+            failed_ = true;
+            return false;
+        }
+        avio_flush(muxer_->pb);
+
+        auto fragment = std::make_shared<const std::string>(std::move(output_));
+        output_.clear();
+
+        // 帧信息在分片之前发出，播放端据此估算显示时延；编码器不缓存帧，分片即对应当前帧
+        auto age = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frame.capture_time);
+        auto info = std::make_shared<const std::string>(
+            "{\"type\":\"frameInfo\",\"sequence\":" + std::to_string(frame.sequence)
+            + ",\"age_us\":" + std::to_string(age.count()) + "}");
+
+        // 分片组成解码链：积压的观看者整段跳到下一个关键帧分片，不会在GOP中间缺少参考帧
+        std::lock_guard<std::mutex> lock(viewers_mutex_);
+        reactor_->broadcast(std::move(info), false, true, stream_key_);
+        reactor_->broadcastChain(std::move(fragment), keyframe, stream_key_);
+    }
+    return true;
+}
@@ -4,176 +4,422 @@
  */
 
 #include "image_processor.h"
+#include "decode_kernels.h"
 #include <fstream>
 #include <iostream>
 #include <numeric>
+#include <algorithm>
+#include <cstdlib>
 
-ImageProcessor::ImageProcessor() {
+ModelOptions ModelOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    ModelOptions options;
+    if (json.isNull()) return options;
+
+    options.path = json->optValue<std::string>("path", options.path);
+    options.names = json->optValue<std::string>("names", options.names);
+    options.backend = json->optValue<std::string>("backend", options.backend);
+    options.threads = std::max(1, json->optValue<int>("threads", options.threads));
+    auto variants = json->getObject("variants");
+    if (!variants.isNull()) {
+        for (const auto& name : variants->getNames()) {
+            int size = std::atoi(name.c_str());
+            if (size <= 0) {
+                std::cerr << "模型尺寸无效: " << name << std::endl;
+                continue;
+            }
+            options.variants[size] = variants->getValue<std::string>(name);
+        }
+    }
+    return options;
+}
+
+ImageProcessor::ImageProcessor(std::shared_ptr<RuntimeConfigStore> config, const ModelOptions& options)
+    : config_(config ? std::move(config) : std::make_shared<RuntimeConfigStore>())
+    , config_reader_(config_) {
     try {
-        loadModel();
+        loadModel(options);
+        model_loaded_ = true;
     } catch (const std::exception& e) {
         std::cerr << "模型加载失败: " << e.what() << std::endl;
-        detection_enabled_ = false;
     }
 }
 
-void ImageProcessor::loadModel() {
-    // 检查模型文件
-    const std::string model_path = "models/yolov11n.onnx";
-    const std::string names_path = "models/coco.names";
-    
-    // 打印模型路径
-    char abs_model_path[PATH_MAX];
-    if (realpath(model_path.c_str(), abs_model_path) != nullptr) {
-        std::cout << "模型文件应位于: " << abs_model_path << std::endl;
-    } else {
-        std::cout << "模型文件应位于当前目录下的: " << abs_model_path << std::endl;
+std::unique_ptr<ImageProcessor::ModelSession> ImageProcessor::loadSession(const std::string& path,
+                                                                         const ModelOptions& options) const {
+    auto model = std::make_unique<ModelSession>();
+    model->path = path;
+    model->backend = InferenceBackend::create(options.backend, options.threads);
+    if (!model->backend) {
+        throw std::runtime_error("无法创建推理后端: " + options.backend);
     }
+    model->backend->load(path);
+    model->dynamic = model->backend->dynamicInput();
+    model->input_size = model->backend->inputSize();
+    return model;
+}
 
-    
+void ImageProcessor::loadModel(const ModelOptions& options) {
     // 打印模型路径
-    char abs_names_path[PATH_MAX];
-    if (realpath(names_path.c_str(), abs_names_path) != nullptr) {
-        std::cout << "模型文件应位于: " << abs_names_path << std::endl;
+    char abs_model_path[PATH_MAX];
+    if (realpath(options.path.c_str(), abs_model_path) != nullptr) {
+        std::cout << "模型文件应位于: " << abs_model_path << std::endl;
     } else {
-        std::cout << "模型文件应位于当前目录下的: " << abs_names_path << std::endl;
+        std::cout << "模型文件应位于当前目录下的: " << options.path << std::endl;
     }
 
-    std::ifstream model_file(abs_model_path, std::ios::binary);
-    std::ifstream names_file(abs_names_path);
+    std::ifstream model_file(options.path, std::ios::binary);
+    std::ifstream names_file(options.names);
     if (!model_file.good() || !names_file.good()) {
         throw std::runtime_error("找不到模型文件，请先运行download_models.sh下载所需文件");
     }
 
-    try {
-        // 初始化ONNX Runtime环境
-        env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "YOLOv11");
-        
-        // 配置会话选项
-        Ort::SessionOptions session_options;
-        session_options.SetIntraOpNumThreads(1);
-        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-
-        // 加载模型
-        session_ = std::make_unique<Ort::Session>(*env_, model_path.c_str(), session_options);
-
-        // 获取输入输出节点名称
-        Ort::AllocatorWithDefaultOptions allocator;
-        
-        // 获取输入节点名称 - 使用新的API
-        auto input_name = session_->GetInputNameAllocated(0, allocator);
-        input_names_.push_back(input_name.get());
-        
-        // 获取输出节点名称 - 使用新的API
-        auto output_name = session_->GetOutputNameAllocated(0, allocator);
-        output_names_.push_back(output_name.get());
-
-        // 加载类别名称
-        std::string line;
-        while (std::getline(names_file, line)) {
-            if (!line.empty() && line[0] != '#') {
-                size_t comment_pos = line.find('#');
-                if (comment_pos != std::string::npos) {
-                    line = line.substr(0, comment_pos);
-                }
-                line.erase(0, line.find_first_not_of(" \t"));
-                line.erase(line.find_last_not_of(" \t") + 1);
-                if (!line.empty()) {
-                    class_names_.push_back(line);
-                }
+    // 主模型必须加载成功，固定尺寸模型加载失败时只是少一个可选尺寸
+    backend_name_ = options.backend;
+    sessions_.push_back(loadSession(options.path, options));
+    for (const auto& variant : options.variants) {
+        try {
+            auto model = loadSession(variant.second, options);
+            if (model->dynamic) {
+                // 输入尺寸可变的模型按配置的边长使用
+                model->dynamic = false;
+                model->input_size = cv::Size(variant.first, variant.first);
+            } else if (model->edge() != variant.first) {
+                std::cerr << "模型" << variant.second << "的输入尺寸为" << model->input_size.width << "x"
+                          << model->input_size.height << "，与配置的" << variant.first << "不符，按实际尺寸使用"
+                          << std::endl;
             }
+            sessions_.push_back(std::move(model));
+        } catch (const std::exception& e) {
+            std::cerr << "加载模型" << variant.second << "失败: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "推理后端: " << backend_name_ << "，线程数: " << options.threads << std::endl;
+    std::cout << "模型输入尺寸:";
+    for (int size : inputSizes()) {
+        std::cout << " " << size;
+    }
+    std::cout << (sessions_.front()->dynamic ? "(主模型输入尺寸可变)" : "") << std::endl;
+
+    // 加载类别名称
+    std::string line;
+    while (std::getline(names_file, line)) {
+        if (!line.empty() && line[0] != '#') {
+            size_t comment_pos = line.find('#');
+            if (comment_pos != std::string::npos) {
+                line = line.substr(0, comment_pos);
+            }
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t") + 1);
+            if (!line.empty()) {
+                class_names_.push_back(line);
+            }
+        }
+    }
+
+    if (class_names_.empty()) {
+        throw std::runtime_error("未能加载任何类别名称");
+    }
+}
+
+std::vector<int> ImageProcessor::inputSizes() const {
+    std::vector<int> sizes;
+    for (const auto& model : sessions_) {
+        if (model->dynamic) {
+            sizes.insert(sizes.end(), std::begin(kStandardSizes), std::end(kStandardSizes));
+        } else {
+            sizes.push_back(model->edge());
         }
+    }
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+    return sizes;
+}
+
+const ImageProcessor::ModelSession& ImageProcessor::selectSession(int requested, cv::Size& input_size) const {
+    const ModelSession* dynamic = nullptr;
+    const ModelSession* below = nullptr;
+    const ModelSession* smallest = nullptr;
+    for (const auto& model : sessions_) {
+        if (model->dynamic) {
+            if (!dynamic) dynamic = model.get();
+            continue;
+        }
+        // 边长相同的固定尺寸模型优先于可变尺寸模型，前者通常经过针对该尺寸的图优化
+        if (model->edge() == requested) {
+            input_size = model->input_size;
+            return *model;
+        }
+        if (model->edge() < requested && (!below || model->edge() > below->edge())) below = model.get();
+        if (!smallest || model->edge() < smallest->edge()) smallest = model.get();
+    }
+    if (dynamic) {
+        input_size = cv::Size(requested, requested);
+        return *dynamic;
+    }
+    const ModelSession* model = below ? below : smallest;
+    input_size = model->input_size;
+    return *model;
+}
+
+bool ImageProcessor::insideRoiPolygons(const RuntimeConfig& config, const cv::Rect& box) {
+    if (config.roi_polygons.empty()) return true;
+
+    cv::Point2f center(box.x + box.width * 0.5f, box.y + box.height * 0.5f);
+    for (const auto& polygon : config.roi_polygons) {
+        if (cv::pointPolygonTest(polygon, center, false) >= 0) return true;
+    }
+    return false;
+}
 
-        if (class_names_.empty()) {
-            throw std::runtime_error("未能加载任何类别名称");
+std::vector<cv::Rect> ImageProcessor::planTiles(const cv::Size& image, const cv::Size& tile,
+                                                int overlap, int max_tiles) {
+    std::vector<cv::Rect> tiles;
+    if (image.width <= tile.width && image.height <= tile.height) return tiles;
+
+    // 分块数超出上限时逐步放大分块(推理前再缩放到模型输入)，延迟保持有界
+    double scale = 1.0;
+    int tw, th, step_x, step_y, nx, ny;
+    for (;;) {
+        tw = std::min(image.width, static_cast<int>(tile.width * scale + 0.5));
+        th = std::min(image.height, static_cast<int>(tile.height * scale + 0.5));
+        int ov = static_cast<int>(overlap * scale + 0.5);
+        step_x = std::max(tw - ov, 1);
+        step_y = std::max(th - ov, 1);
+        nx = image.width <= tw ? 1 : (image.width - tw + step_x - 1) / step_x + 1;
+        ny = image.height <= th ? 1 : (image.height - th + step_y - 1) / step_y + 1;
+        if (nx * ny <= max_tiles) break;
+        scale *= 1.25;
+    }
+    if (nx * ny == 1) return tiles;
+
+    // 最后一行/列贴齐图像边缘，所有分块大小相同
+    for (int iy = 0; iy < ny; ++iy) {
+        int y = std::min(iy * step_y, image.height - th);
+        for (int ix = 0; ix < nx; ++ix) {
+            int x = std::min(ix * step_x, image.width - tw);
+            tiles.emplace_back(x, y, tw, th);
         }
-    } catch (const Ort::Exception& e) {
-        throw std::runtime_error("ONNX Runtime错误: " + std::string(e.what()));
     }
+    return tiles;
 }
 
-std::vector<float> ImageProcessor::preprocess(const cv::Mat& frame) {
-    // 调整图像大小
-    cv::Mat resized;
-    cv::resize(frame, resized, cv::Size(input_width_, input_height_));
-    
-    // 转换为浮点型并归一化
-    cv::Mat float_img;
-    resized.convertTo(float_img, CV_32F, 1.0/255.0);
-    
-    // 准备输入张量数据
-    std::vector<float> input_tensor(input_width_ * input_height_ * 3);
-    float* input_ptr = input_tensor.data();
-    
-    // BGR转CHW格式
-    for (int c = 0; c < 3; c++) {
-        for (int h = 0; h < input_height_; h++) {
-            for (int w = 0; w < input_width_; w++) {
-                input_ptr[c * input_width_ * input_height_ + h * input_width_ + w] =
-                    float_img.at<cv::Vec3f>(h, w)[c];
+void ImageProcessor::nonMaxSuppression(std::vector<DetectionResult>& detections,
+                                       const std::vector<int>& sources, float iou_threshold) {
+    std::vector<size_t> order(detections.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return detections[a].confidence > detections[b].confidence;
+    });
+
+    std::vector<bool> removed(detections.size(), false);
+    std::vector<DetectionResult> kept;
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t a = order[i];
+        if (removed[a]) continue;
+        const DetectionResult& best = detections[a];
+        kept.push_back(best);
+
+        for (size_t j = i + 1; j < order.size(); ++j) {
+            size_t b = order[j];
+            const DetectionResult& other = detections[b];
+            if (removed[b] || other.class_id != best.class_id) continue;
+
+            float inter = static_cast<float>((best.bbox & other.bbox).area());
+            if (inter <= 0) continue;
+            float area_a = static_cast<float>(best.bbox.area());
+            float area_b = static_cast<float>(other.bbox.area());
+            float iou = inter / (area_a + area_b - inter);
+            // 跨分块时被分块边界截断的框与完整框IoU偏低，改用与较小框的重叠比例判断
+            bool cross = !sources.empty() && sources[a] != sources[b];
+            float ios = inter / std::max(std::min(area_a, area_b), 1.0f);
+            if (iou > iou_threshold || (cross && ios > 0.85f)) {
+                removed[b] = true;
             }
         }
     }
-    
-    return input_tensor;
+    detections.swap(kept);
+}
+
+std::vector<DetectionResult> ImageProcessor::detect(const ModelSession& model, const TensorSource& source,
+                                                    const cv::Rect& region, const cv::Size& input_size,
+                                                    float confidence_threshold, int slot) {
+    std::vector<DetectionResult> results;
+
+    // 1. 取出复用的输入输出，颜色转换、缩放、归一化和CHW重排一次写入输入张量
+    InferenceBinding& io = binding(model, input_size, slot);
+
+    // 2. 图像预处理
+    if (!TensorKernels::convert(source, region, input_size, io.input())) {
+        return results;
+    }
+
+    // 3. 执行推理，各后端的run可以被多个线程同时调用
+    model.backend->run(io);
+
+    // 4. 解析检测结果
+    decode(io, region, input_size, confidence_threshold, results);
+    return results;
+}
+
+InferenceBinding& ImageProcessor::binding(const ModelSession& model, const cv::Size& input_size, int slot) {
+    std::lock_guard<std::mutex> lock(model.bindings_mutex);
+    auto& entry = model.bindings[std::make_tuple(input_size.width, input_size.height, slot)];
+    if (!entry) {
+        entry = model.backend->bind(input_size);
+    }
+    return *entry;
+}
+
+CoroTask<void> ImageProcessor::detectTask(const ModelSession& model, const TensorSource& source, cv::Rect region,
+                                          cv::Size input_size, float confidence_threshold, int slot,
+                                          std::vector<DetectionResult>& results, TileBatch& batch) {
+    std::exception_ptr error;
+    try {
+        results = detect(model, source, region, input_size, confidence_threshold, slot);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if (error && !batch.error) batch.error = error;
+    if (--batch.remaining == 0) batch.done.notify_one();
+    co_return;
+}
+
+void ImageProcessor::decode(const InferenceBinding& binding, const cv::Rect& region, const cv::Size& input_size,
+                            float confidence_threshold, std::vector<DetectionResult>& results) const {
+    const float* output = binding.output();
+    const OutputLayout layout = binding.outputLayout();
+    const int num_names = static_cast<int>(class_names_.size());
+    const bool objectness = layout.attributes == num_names + 5;
+    const int num_classes = layout.attributes - (objectness ? 5 : 4);
+    if (!output || layout.boxes <= 0 || num_classes <= 0) {
+        throw std::runtime_error("无法识别的模型输出形状");
+    }
+
+    // 先对所有框求最高类别得分，再只对过阈值的框取坐标
+    std::vector<float> best_score(layout.boxes);
+    std::vector<int> best_class(layout.boxes);
+    const float* scores = output + (objectness ? 5 : 4) * layout.attribute_stride;
+    DecodeKernels::bestClass(scores, layout.boxes, num_classes, layout.box_stride, layout.attribute_stride,
+                             best_score.data(), best_class.data());
+
+    // 坐标为模型输入像素，按区域与输入的比例还原
+    const float scale_x = static_cast<float>(region.width) / input_size.width;
+    const float scale_y = static_cast<float>(region.height) / input_size.height;
+    for (int i = 0; i < layout.boxes; ++i) {
+        const float* box = output + i * layout.box_stride;
+        float confidence = best_score[i];
+        if (objectness) {
+            confidence *= box[4 * layout.attribute_stride];
+        }
+        if (confidence < confidence_threshold) continue;
+
+        const float cx = box[0];
+        const float cy = box[layout.attribute_stride];
+        const float w = box[2 * layout.attribute_stride];
+        const float h = box[3 * layout.attribute_stride];
+        const int class_id = best_class[i];
+
+        DetectionResult det;
+        det.class_id = class_id;
+        det.label = class_id < num_names ? class_names_[class_id] : std::to_string(class_id);
+        det.confidence = confidence;
+        det.bbox = cv::Rect(
+            region.x + static_cast<int>((cx - w / 2) * scale_x),
+            region.y + static_cast<int>((cy - h / 2) * scale_y),
+            static_cast<int>(w * scale_x),
+            static_cast<int>(h * scale_y)
+        );
+        results.push_back(det);
+    }
 }
 
-std::vector<DetectionResult> ImageProcessor::processFrame(const cv::Mat& frame) {
+std::vector<DetectionResult> ImageProcessor::processFrame(const cv::Mat& frame, const RawFramePtr& raw) {
     std::vector<DetectionResult> results;
-    if (!detection_enabled_ || frame.empty()) return results;
+    const RuntimeConfig& config = config_reader_.get();
+    if (!model_loaded_ || !config.detection_enabled || frame.empty()) return results;
+
+    // 只对检测区域做推理，结果再平移回整帧坐标；
+    // 配置了多边形时裁剪到多边形的外接矩形，模型分辨率集中在关心的区域
+    const cv::Rect frame_rect(0, 0, frame.cols, frame.rows);
+    cv::Rect roi = config.roi & frame_rect;
+    if (roi.empty()) roi = frame_rect;
+    if (!config.roi_polygons.empty()) {
+        cv::Rect bounds = cv::boundingRect(config.roi_polygons.front());
+        for (size_t i = 1; i < config.roi_polygons.size(); ++i) {
+            bounds |= cv::boundingRect(config.roi_polygons[i]);
+        }
+        cv::Rect cropped = roi & bounds;
+        if (!cropped.empty()) roi = cropped;
+    }
+    // 驱动缓冲与图像尺寸一致且格式受支持时直接从驱动缓冲取像素
+    TensorSource source;
+    if (raw && raw->width == frame.cols && raw->height == frame.rows) {
+        source = TensorSource::fromRaw(*raw);
+    }
+    if (source.empty()) {
+        source = TensorSource::fromBgr(frame);
+    }
+    const float confidence_threshold = config.confidence_threshold;
+    cv::Size input_size;
+    const ModelSession& model = selectSession(config.model_input_size, input_size);
+    active_input_size_.store(std::max(input_size.width, input_size.height), std::memory_order_relaxed);
 
     try {
-        // 1. 图像预处理
-        auto input_tensor_values = preprocess(frame);
-        std::vector<int64_t> input_shape = {1, 3, input_height_, input_width_};
-        
-        // 2. 准备输入tensor
-        auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            memory_info, input_tensor_values.data(), input_tensor_values.size(),
-            input_shape.data(), input_shape.size());
-
-        // 3. 执行推理
-        auto output_tensors = session_->Run(
-            Ort::RunOptions{nullptr},
-            input_names_.data(),
-            &input_tensor,
-            1,
-            output_names_.data(),
-            1);
-
-        // 4. 处理输出 - 更新为YOLOv11n的输出格式
-        float* output = output_tensors.front().GetTensorMutableData<float>();
-        const auto& output_shape = output_tensors.front().GetTensorTypeAndShapeInfo().GetShape();
-        const int num_boxes = output_shape[1];
-        const int num_classes = output_shape[2] - 4;  // 减去4个边界框坐标
-
-        // 5. 解析检测结果
-        for (int i = 0; i < num_boxes; ++i) {
-            float* box_data = output + i * (num_classes + 4);
-            float confidence = box_data[4];
-            
-            if (confidence >= confidence_threshold_) {
-                int class_id = std::max_element(box_data + 5, box_data + 5 + num_classes) - (box_data + 5);
-                float class_score = box_data[5 + class_id];
-                
-                if (class_score * confidence >= confidence_threshold_) {
-                    DetectionResult det;
-                    det.label = class_names_[class_id];
-                    det.confidence = class_score * confidence;
-                    det.bbox = cv::Rect(
-                        static_cast<int>((box_data[0] - box_data[2] / 2) * frame.cols),
-                        static_cast<int>((box_data[1] - box_data[3] / 2) * frame.rows),
-                        static_cast<int>(box_data[2] * frame.cols),
-                        static_cast<int>(box_data[3] * frame.rows)
-                    );
-                    results.push_back(det);
-                }
+        std::vector<cv::Rect> tiles;
+        if (config.tiling_enabled) {
+            tiles = planTiles(roi.size(), input_size, config.tile_overlap, config.max_tiles);
+        }
+
+        std::vector<int> sources;
+        if (tiles.empty()) {
+            results = detect(model, source, roi, input_size, confidence_threshold, 0);
+        } else {
+            // 各分块在常驻的分块执行器上并行推理，可选的整幅缩放推理负责分块放不下的大目标
+            std::vector<cv::Rect> regions;
+            for (const auto& tile : tiles) {
+                regions.emplace_back(roi.x + tile.x, roi.y + tile.y, tile.width, tile.height);
+            }
+            if (config.tile_full_frame) {
+                regions.push_back(roi);
+            }
+
+            // 工作线程数等于本帧任务数，所有分块同时推理；分块上限调大时才重建
+            const int jobs = static_cast<int>(regions.size());
+            if (!tile_executor_ || tile_executor_->threads() < jobs) {
+                tile_executor_.reset();
+                tile_executor_ = std::make_unique<CoroExecutor>(ExecutorOptions{"tile", "inference", jobs});
+                tile_executor_->start();
+            }
+
+            std::vector<std::vector<DetectionResult>> parts(regions.size());
+            TileBatch batch;
+            batch.remaining = regions.size();
+            for (size_t i = 0; i < regions.size(); ++i) {
+                tile_executor_->spawn(detectTask(model, source, regions[i], input_size, confidence_threshold,
+                                                 static_cast<int>(i), parts[i], batch));
+            }
+            {
+                std::unique_lock<std::mutex> lock(batch.mutex);
+                batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+            }
+            if (batch.error) std::rethrow_exception(batch.error);
+
+            for (size_t i = 0; i < parts.size(); ++i) {
+                sources.insert(sources.end(), parts[i].size(), static_cast<int>(i));
+                results.insert(results.end(), parts[i].begin(), parts[i].end());
             }
         }
+
+        nonMaxSuppression(results, sources, kNmsIouThreshold);
+        results.erase(std::remove_if(results.begin(), results.end(), [&](const DetectionResult& det) {
+            return !insideRoiPolygons(config, det.bbox);
+        }), results.end());
     } catch (const std::exception& e) {
         std::cerr << "处理帧时发生错误: " << e.what() << std::endl;
     }
 
     return results;
-} 
\ No newline at end of file
+}
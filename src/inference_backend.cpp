@@ -0,0 +1,61 @@
+/**
+ * @file inference_backend.cpp
+ * @brief 推理后端的创建和输出布局推断
+ */
+
+#include "inference_backend.h"
+#include "ort_backend.h"
+#ifdef USE_OPENCV_DNN
+#include "dnn_backend.h"
+#endif
+#include <iostream>
+
+OutputLayout OutputLayout::fromShape(const std::vector<int64_t>& shape) {
+    OutputLayout layout;
+    if (shape.size() != 3 || shape[0] != 1 || shape[1] <= 0 || shape[2] <= 0) return layout;
+
+    if (shape[1] < shape[2]) {
+        // [1, 属性, 框]：同一属性的各框连续存放
+        layout.attributes = static_cast<int>(shape[1]);
+        layout.boxes = static_cast<int>(shape[2]);
+        layout.box_stride = 1;
+        layout.attribute_stride = static_cast<size_t>(layout.boxes);
+    } else {
+        // [1, 框, 属性]：同一框的各属性连续存放
+        layout.boxes = static_cast<int>(shape[1]);
+        layout.attributes = static_cast<int>(shape[2]);
+        layout.box_stride = static_cast<size_t>(layout.attributes);
+        layout.attribute_stride = 1;
+    }
+    return layout;
+}
+
+std::unique_ptr<InferenceBackend> InferenceBackend::create(const std::string& type, int threads) {
+    if (type == "ort") {
+        return std::make_unique<OrtBackend>(false, threads);
+    }
+    if (type == "ort-xnnpack") {
+        return std::make_unique<OrtBackend>(true, threads);
+    }
+    if (type == "opencv") {
+#ifdef USE_OPENCV_DNN
+        return std::make_unique<DnnBackend>();
+#else
+        std::cerr << "未编译OpenCV DNN推理后端(USE_OPENCV_DNN)" << std::endl;
+        return nullptr;
+#endif
+    }
+    std::cerr << "未知的推理后端: " << type << std::endl;
+    return nullptr;
+}
+
+std::vector<std::string> InferenceBackend::available() {
+    std::vector<std::string> names = {"ort"};
+    if (OrtBackend::xnnpackAvailable()) {
+        names.push_back("ort-xnnpack");
+    }
+#ifdef USE_OPENCV_DNN
+    names.push_back("opencv");
+#endif
+    return names;
+}
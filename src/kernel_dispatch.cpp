@@ -0,0 +1,209 @@
+/**
+ * @file kernel_dispatch.cpp
+ * @brief 热点内核的运行时指令集分派实现
+ */
+
+#include "kernel_dispatch.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+#if defined(KERNEL_DISPATCH_NEON)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace {
+
+constexpr int kKernelCount = static_cast<int>(KernelId::kCount);
+
+/**
+ * @struct KernelEntry
+ * @brief 内核登记信息
+ */
+struct KernelEntry {
+    KernelId id;                        ///< 内核
+    const char* name;                   ///< 配置中使用的名称
+    std::vector<KernelIsa> variants;    ///< 已实现的指令集，按优先级从低到高
+};
+
+const std::vector<KernelEntry>& registry() {
+    static const std::vector<KernelEntry> entries = {
+#if defined(KERNEL_DISPATCH_X86)
+        {KernelId::kColor, "color", {KernelIsa::kScalar, KernelIsa::kSse4, KernelIsa::kAvx2}},
+        {KernelId::kPreprocess, "preprocess",
+         {KernelIsa::kScalar, KernelIsa::kSse4, KernelIsa::kAvx2, KernelIsa::kAvx512}},
+        {KernelId::kDecode, "decode", {KernelIsa::kScalar, KernelIsa::kSse4, KernelIsa::kAvx2, KernelIsa::kAvx512}},
+#elif defined(KERNEL_DISPATCH_NEON)
+        {KernelId::kColor, "color", {KernelIsa::kScalar, KernelIsa::kNeon}},
+        {KernelId::kPreprocess, "preprocess", {KernelIsa::kScalar, KernelIsa::kNeon}},
+        {KernelId::kDecode, "decode", {KernelIsa::kScalar, KernelIsa::kNeon}},
+#else
+        {KernelId::kColor, "color", {KernelIsa::kScalar}},
+        {KernelId::kPreprocess, "preprocess", {KernelIsa::kScalar}},
+        {KernelId::kDecode, "decode", {KernelIsa::kScalar}},
+#endif
+    };
+    return entries;
+}
+
+CpuFeatures detectFeatures() {
+    CpuFeatures f;
+#if defined(KERNEL_DISPATCH_X86)
+    __builtin_cpu_init();
+    f.sse42 = __builtin_cpu_supports("sse4.2");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.fma = __builtin_cpu_supports("fma");
+    f.avx512f = __builtin_cpu_supports("avx512f");
+    f.avx512bw = __builtin_cpu_supports("avx512bw");
+#elif defined(KERNEL_DISPATCH_NEON)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    f.neon = (hwcap & HWCAP_ASIMD) != 0;
+#ifdef HWCAP_ASIMDDP
+    f.dotprod = (hwcap & HWCAP_ASIMDDP) != 0;
+#endif
+#endif
+    return f;
+}
+
+bool parseIsa(const std::string& name, KernelIsa& isa) {
+    static const std::pair<const char*, KernelIsa> names[] = {
+        {"scalar", KernelIsa::kScalar}, {"neon", KernelIsa::kNeon}, {"sse4", KernelIsa::kSse4},
+        {"avx2", KernelIsa::kAvx2}, {"avx512", KernelIsa::kAvx512},
+    };
+    for (const auto& entry : names) {
+        if (name == entry.first) {
+            isa = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 为一个内核选出实现：强制指定的实现可用时使用它，否则取受支持的最高优先级实现
+ */
+KernelIsa resolve(const KernelEntry& entry, const std::string& forced) {
+    if (!forced.empty() && forced != "auto") {
+        KernelIsa isa;
+        if (!parseIsa(forced, isa)) {
+            std::cerr << "未知的内核实现: " << forced << "，内核" << entry.name << "自动选择" << std::endl;
+        } else if (!KernelDispatch::supported(isa)) {
+            std::cerr << "当前CPU不支持" << forced << "，内核" << entry.name << "自动选择" << std::endl;
+        } else {
+            for (KernelIsa variant : entry.variants) {
+                if (variant == isa) return isa;
+            }
+            std::cerr << "内核" << entry.name << "没有" << forced << "实现，自动选择" << std::endl;
+        }
+    }
+
+    KernelIsa best = KernelIsa::kScalar;
+    for (KernelIsa variant : entry.variants) {
+        if (KernelDispatch::supported(variant)) best = variant;
+    }
+    return best;
+}
+
+std::mutex g_mutex;                                 ///< 串行化configure
+std::atomic<int> g_selected[kKernelCount];          ///< 各内核当前的实现
+std::once_flag g_defaults;                          ///< 首次使用时按自动选择初始化
+
+void resolveAll(const KernelOptions& options) {
+    for (const auto& entry : registry()) {
+        auto it = options.kernels.find(entry.name);
+        const std::string& forced = it != options.kernels.end() ? it->second : options.isa;
+        g_selected[static_cast<int>(entry.id)].store(static_cast<int>(resolve(entry, forced)),
+                                                     std::memory_order_release);
+    }
+}
+
+void ensureDefaults() {
+    std::call_once(g_defaults, [] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        resolveAll(KernelOptions());
+    });
+}
+
+} // namespace
+
+std::vector<std::string> CpuFeatures::names() const {
+    std::vector<std::string> result;
+    if (sse42) result.push_back("sse4.2");
+    if (avx2) result.push_back("avx2");
+    if (fma) result.push_back("fma");
+    if (avx512f) result.push_back("avx512f");
+    if (avx512bw) result.push_back("avx512bw");
+    if (neon) result.push_back("neon");
+    if (dotprod) result.push_back("dotprod");
+    return result;
+}
+
+KernelOptions KernelOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    KernelOptions options;
+    if (!json.isNull()) {
+        options.isa = json->optValue<std::string>("isa", options.isa);
+        for (const auto& entry : registry()) {
+            if (json->has(entry.name)) {
+                options.kernels[entry.name] = json->getValue<std::string>(entry.name);
+            }
+        }
+    }
+    if (const char* env = std::getenv("CAMERA_KERNEL_ISA")) {
+        options.isa = env;
+    }
+    return options;
+}
+
+void KernelDispatch::configure(const KernelOptions& options) {
+    ensureDefaults();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    resolveAll(options);
+}
+
+const CpuFeatures& KernelDispatch::features() {
+    static const CpuFeatures features = detectFeatures();
+    return features;
+}
+
+bool KernelDispatch::supported(KernelIsa isa) {
+    const CpuFeatures& f = features();
+    switch (isa) {
+    case KernelIsa::kScalar: return true;
+    case KernelIsa::kNeon: return f.neon;
+    case KernelIsa::kSse4: return f.sse42;
+    case KernelIsa::kAvx2: return f.avx2 && f.fma;
+    case KernelIsa::kAvx512: return f.avx512f && f.avx512bw && f.avx2 && f.fma;
+    }
+    return false;
+}
+
+KernelIsa KernelDispatch::select(KernelId kernel) {
+    ensureDefaults();
+    return static_cast<KernelIsa>(g_selected[static_cast<int>(kernel)].load(std::memory_order_acquire));
+}
+
+std::vector<KernelIsa> KernelDispatch::variants(KernelId kernel) {
+    for (const auto& entry : registry()) {
+        if (entry.id == kernel) return entry.variants;
+    }
+    return {KernelIsa::kScalar};
+}
+
+const char* KernelDispatch::isaName(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::kNeon: return "neon";
+    case KernelIsa::kSse4: return "sse4";
+    case KernelIsa::kAvx2: return "avx2";
+    case KernelIsa::kAvx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+const char* KernelDispatch::kernelName(KernelId kernel) {
+    for (const auto& entry : registry()) {
+        if (entry.id == kernel) return entry.name;
+    }
+    return "unknown";
+}
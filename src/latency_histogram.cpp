@@ -0,0 +1,64 @@
+/**
+ * @file latency_histogram.cpp
+ * @brief 延迟直方图实现
+ */
+
+#include "latency_histogram.h"
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+    // 小于kSubBuckets的值各占一个桶，之后按最高位所在区间和其后两位分桶
+    if (us < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(us);
+    int log2 = 63 - __builtin_clzll(us);
+    int sub = static_cast<int>((us >> (log2 - 2)) & (kSubBuckets - 1));
+    int bucket = (log2 - 1) * kSubBuckets + sub;
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+uint64_t LatencyHistogram::upperBound(int bucket) {
+    if (bucket < kSubBuckets) return static_cast<uint64_t>(bucket);
+    int log2 = bucket / kSubBuckets + 1;
+    uint64_t sub = static_cast<uint64_t>(bucket % kSubBuckets);
+    return ((static_cast<uint64_t>(kSubBuckets) + sub + 1) << (log2 - 2)) - 1;
+}
+
+void LatencyHistogram::record(int64_t us) {
+    uint64_t value = us > 0 ? static_cast<uint64_t>(us) : 0;
+    buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (value > max && !max_us_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    uint64_t counts[kBuckets];
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        s.count += counts[i];
+    }
+    if (s.count == 0) return s;
+
+    s.mean_us = static_cast<double>(sum_us_.load(std::memory_order_relaxed)) / s.count;
+    s.max_us = max_us_.load(std::memory_order_relaxed);
+
+    // 分位数取所在桶的上界，不超过实际最大值
+    uint64_t p50_rank = (s.count + 1) / 2;
+    uint64_t p99_rank = s.count - s.count / 100;
+    uint64_t seen = 0;
+    bool p50_found = false;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (!p50_found && seen >= p50_rank) {
+            s.p50_us = upperBound(i) < s.max_us ? upperBound(i) : s.max_us;
+            p50_found = true;
+        }
+        if (seen >= p99_rank) {
+            s.p99_us = upperBound(i) < s.max_us ? upperBound(i) : s.max_us;
+            break;
+        }
+    }
+    return s;
+}
@@ -6,6 +6,12 @@
 
 #include "v4l2_capture.h"
 #include "web_server.h"
+#include "runtime_config.h"
+#include "segment_recorder.h"
+#include "event_recorder.h"
+#include "detection_store.h"
+#include "thread_tuning.h"
+#include "kernel_dispatch.h"
 #include <iostream>
 #include <memory>
 #include <csignal>
@@ -54,8 +60,57 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
+    // 加载运行时配置，配置文件不存在时使用默认值
+    auto config = std::make_shared<RuntimeConfigStore>();
+    RecorderOptions record_options;
+    EventOptions event_options;
+    DetectionStoreOptions store_options;
+    H264Options h264_options;
+    PipelineOptions pipeline_options;
+    CaptureOptions capture_options;
+    ModelOptions model_options;
+    GovernorOptions governor_options;
+    auto file = loadJsonFile("config/camera.json");
+    if (!file.isNull()) {
+        std::string error;
+        if (config->applyJson(*file, error)) {
+            std::cout << "已加载配置文件 config/camera.json" << std::endl;
+        } else {
+            std::cerr << "配置文件config/camera.json无效: " << error << std::endl;
+        }
+        record_options = RecorderOptions::fromJson(file->getObject("recording"));
+        event_options = EventOptions::fromJson(file->getObject("events"));
+        store_options = DetectionStoreOptions::fromJson(file->getObject("detections"));
+        h264_options = H264Options::fromJson(file->getObject("h264"));
+        pipeline_options = PipelineOptions::fromJson(file->getObject("pipeline"));
+        capture_options = CaptureOptions::fromJson(file->getObject("capture"));
+        model_options = ModelOptions::fromJson(file->getObject("model"));
+        governor_options = GovernorOptions::fromJson(file->getObject("governor"));
+        // 调度策略须在创建任何流水线线程之前设置
+        ThreadTuning::configure(SchedulingOptions::fromJson(file->getObject("scheduling")));
+    }
+
+    // 按CPU特性选择各内核的实现，配置或环境变量CAMERA_KERNEL_ISA可强制指定
+    Poco::JSON::Object::Ptr kernels_json;
+    if (!file.isNull()) {
+        kernels_json = file->getObject("kernels");
+    }
+    KernelDispatch::configure(KernelOptions::fromJson(kernels_json));
+    std::cout << "CPU特性:";
+    for (const auto& name : KernelDispatch::features().names()) {
+        std::cout << " " << name;
+    }
+    std::cout << "，内核实现:";
+    for (int i = 0; i < static_cast<int>(KernelId::kCount); ++i) {
+        auto kernel = static_cast<KernelId>(i);
+        std::cout << " " << KernelDispatch::kernelName(kernel) << "="
+                  << KernelDispatch::isaName(KernelDispatch::select(kernel));
+    }
+    std::cout << std::endl;
+
     // 创建视频捕获对象
-    auto video_capture = std::make_shared<V4L2Capture>();
+    auto video_capture = std::make_shared<V4L2Capture>(config, capture_options);
+    video_capture->setPipelineOptions(pipeline_options);
     
     // 启动视频捕获
     if (!video_capture->start(0)) {
@@ -63,8 +118,37 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // 服务端录像，录像目录不可用时仅禁用录像功能
+    auto recorder = std::make_shared<SegmentRecorder>(video_capture, config, record_options);
+    if (!recorder->start()) {
+        recorder.reset();
+    }
+
+    // 事件短片录像，仅在配置了触发规则时启用
+    std::shared_ptr<EventRecorder> events;
+    if (!event_options.rules.empty()) {
+        events = std::make_shared<EventRecorder>(video_capture, config, event_options);
+        if (!events->start()) {
+            events.reset();
+        }
+    }
+
+    // 检测结果持久化
+    std::shared_ptr<DetectionStore> store;
+    if (store_options.enabled) {
+        store = std::make_shared<DetectionStore>(store_options);
+        if (!store->open()) {
+            store.reset();
+        }
+    }
+
     // 创建并启动Web服务器
-    WebServer server(video_capture);
+    WebServer server(video_capture, config, model_options);
+    server.setRecorder(recorder);
+    server.setEventRecorder(events);
+    server.setDetectionStore(store, 0);
+    server.setH264Options(h264_options);
+    server.setGovernorOptions(governor_options);
     std::cout << "服务器运行在 http://localhost:8080" << std::endl;
     
     try {
@@ -77,6 +161,8 @@ int main(int argc, char* argv[]) {
         // 清理资源
         std::cout << "正在关闭服务..." << std::endl;
         server.stop();
+        if (recorder) recorder->stop();
+        if (events) events->stop();
         video_capture->stop();
         
     } catch (const std::exception& e) {
@@ -0,0 +1,120 @@
+/**
+ * @file ort_backend.cpp
+ * @brief ONNX Runtime推理后端的实现
+ */
+
+#include "ort_backend.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 进程内共享的ONNX运行环境，所有会话共用其日志和线程设置
+ */
+Ort::Env& ortEnv() {
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "YOLOv11");
+    return env;
+}
+
+/**
+ * @class OrtBinding
+ * @brief 输入张量和推理输出
+ */
+class OrtBinding : public InferenceBinding {
+public:
+    explicit OrtBinding(const cv::Size& input_size) {
+        std::vector<int64_t> shape = {1, 3, input_size.height, input_size.width};
+        Ort::AllocatorWithDefaultOptions allocator;
+        input_ = Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size());
+    }
+
+    float* input() override { return input_.GetTensorMutableData<float>(); }
+
+    const float* output() const override {
+        return outputs_.empty() ? nullptr : outputs_.front().GetTensorData<float>();
+    }
+
+    std::vector<int64_t> outputShape() const override {
+        if (outputs_.empty()) return {};
+        return outputs_.front().GetTensorTypeAndShapeInfo().GetShape();
+    }
+
+    Ort::Value input_{nullptr};         ///< 输入张量
+    std::vector<Ort::Value> outputs_;   ///< 推理输出
+};
+
+} // namespace
+
+OrtBackend::OrtBackend(bool xnnpack, int threads)
+    : xnnpack_(xnnpack)
+    , threads_(std::max(1, threads)) {
+}
+
+bool OrtBackend::xnnpackAvailable() {
+    auto providers = Ort::GetAvailableProviders();
+    return std::find(providers.begin(), providers.end(), "XNNPACKExecutionProvider") != providers.end();
+}
+
+void OrtBackend::load(const std::string& path) {
+    try {
+        // 配置会话选项
+        Ort::SessionOptions session_options;
+        session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        if (xnnpack_) {
+            if (!xnnpackAvailable()) {
+                throw std::runtime_error("ONNX Runtime未包含XNNPACK执行提供者");
+            }
+            // XNNPACK使用自己的线程池，ORT线程池只留调用线程并关闭自旋，两者不争抢CPU
+            session_options.SetIntraOpNumThreads(1);
+            session_options.AddConfigEntry("session.intra_op.allow_spinning", "0");
+            session_options.AppendExecutionProvider("XNNPACK",
+                {{"intra_op_num_threads", std::to_string(threads_)}});
+        } else {
+            session_options.SetIntraOpNumThreads(threads_);
+        }
+
+        session_ = std::make_unique<Ort::Session>(ortEnv(), path.c_str(), session_options);
+
+        // 节点名称复制保存，分配器返回的缓冲在作用域结束时释放
+        Ort::AllocatorWithDefaultOptions allocator;
+        input_name_ = session_->GetInputNameAllocated(0, allocator).get();
+        output_name_ = session_->GetOutputNameAllocated(0, allocator).get();
+
+        // 输入形状为NCHW，高宽为非正数表示动态尺寸
+        auto input_shape = session_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (input_shape.size() != 4) {
+            throw std::runtime_error("模型输入不是NCHW格式: " + path);
+        }
+        dynamic_ = input_shape[2] <= 0 || input_shape[3] <= 0;
+        if (!dynamic_) {
+            input_size_ = cv::Size(static_cast<int>(input_shape[3]), static_cast<int>(input_shape[2]));
+        }
+    } catch (const Ort::Exception& e) {
+        throw std::runtime_error("ONNX Runtime错误: " + std::string(e.what()));
+    }
+}
+
+std::unique_ptr<InferenceBinding> OrtBackend::bind(const cv::Size& input_size) {
+    return std::make_unique<OrtBinding>(input_size);
+}
+
+void OrtBackend::run(InferenceBinding& binding) {
+    auto& ort = static_cast<OrtBinding&>(binding);
+    const char* input_name = input_name_.c_str();
+    const char* output_name = output_name_.c_str();
+    if (!ort.outputs_.empty()) {
+        // 绑定复用时输出形状不变，直接写入上一次分配的输出张量
+        session_->Run(Ort::RunOptions{nullptr}, &input_name, &ort.input_, 1, &output_name,
+                      ort.outputs_.data(), ort.outputs_.size());
+        return;
+    }
+    ort.outputs_ = session_->Run(
+        Ort::RunOptions{nullptr},
+        &input_name,
+        &ort.input_,
+        1,
+        &output_name,
+        1);
+}
@@ -0,0 +1,340 @@
+/**
+ * @file pipeline_governor.cpp
+ * @brief 流水线负载调节器实现
+ */
+
+#include "pipeline_governor.h"
+#include "thread_tuning.h"
+#include <Poco/JSON/Array.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::vector<int> intList(const Poco::JSON::Object::Ptr& json, const std::string& key, std::vector<int> defaults) {
+    auto array = json->getArray(key);
+    if (array.isNull()) return defaults;
+
+    std::vector<int> values;
+    for (size_t i = 0; i < array->size(); ++i) {
+        int value = array->getElement<int>(static_cast<unsigned>(i));
+        if (value > 0) values.push_back(value);
+    }
+    // 阶梯逐级收紧，按从宽到严排列
+    std::sort(values.rbegin(), values.rend());
+    return values;
+}
+
+/**
+ * @brief 一个周期内新增样本的平均值(毫秒)，周期内没有样本时为0
+ */
+double windowMeanMs(const LatencyHistogram::Snapshot& before, const LatencyHistogram::Snapshot& after) {
+    if (after.count <= before.count) return 0.0;
+    double sum = after.mean_us * after.count - before.mean_us * before.count;
+    return std::max(sum, 0.0) / (after.count - before.count) / 1000.0;
+}
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+GovernorOptions GovernorOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    GovernorOptions options;
+    if (json.isNull()) return options;
+
+    options.enabled = json->optValue<bool>("enabled", options.enabled);
+    options.interval_ms = std::max(json->optValue<int>("interval_ms", options.interval_ms), 100);
+    options.cpu_high = std::clamp(json->optValue<double>("cpu_high", options.cpu_high), 0.1, 1.0);
+    options.cpu_low = std::clamp(json->optValue<double>("cpu_low", options.cpu_low), 0.0, options.cpu_high);
+    options.send_budget_ms = std::max(json->optValue<int>("send_budget_ms", options.send_budget_ms), 1);
+    options.inference_budget_ms = std::max(json->optValue<int>("inference_budget_ms", options.inference_budget_ms), 1);
+    options.stream_drop_ratio = std::clamp(
+        json->optValue<double>("stream_drop_ratio", options.stream_drop_ratio), 0.0, 1.0);
+    options.degrade_periods = std::max(json->optValue<int>("degrade_periods", options.degrade_periods), 1);
+    options.recover_periods = std::max(json->optValue<int>("recover_periods", options.recover_periods), 1);
+    options.inference_fps = intList(json, "inference_fps", options.inference_fps);
+    options.model_sizes = json->optValue<bool>("model_sizes", options.model_sizes);
+    options.jpeg_quality = intList(json, "jpeg_quality", options.jpeg_quality);
+    options.target_fps = intList(json, "target_fps", options.target_fps);
+    return options;
+}
+
+PipelineGovernor::PipelineGovernor(std::shared_ptr<CaptureInterface> capture,
+                                   std::shared_ptr<RuntimeConfigStore> config,
+                                   const LatencyHistogram* send_latency,
+                                   const LatencyHistogram* inference_latency,
+                                   std::vector<int> model_sizes,
+                                   GovernorOptions options)
+    : capture_(std::move(capture))
+    , config_(std::move(config))
+    , send_latency_(send_latency)
+    , inference_latency_(inference_latency)
+    , options_(std::move(options)) {
+    // 降级顺序：推理帧率 → 模型输入尺寸 → 编码质量 → 采集帧率
+    for (int fps : options_.inference_fps) {
+        ladder_.push_back({&RuntimeLimits::inference_fps, fps});
+    }
+    if (options_.model_sizes && model_sizes.size() > 1) {
+        std::sort(model_sizes.rbegin(), model_sizes.rend());
+        for (size_t i = 1; i < model_sizes.size(); ++i) {
+            ladder_.push_back({&RuntimeLimits::model_input_size, model_sizes[i]});
+        }
+    }
+    for (int quality : options_.jpeg_quality) {
+        ladder_.push_back({&RuntimeLimits::jpeg_quality, quality});
+    }
+    for (int fps : options_.target_fps) {
+        ladder_.push_back({&RuntimeLimits::target_fps, fps});
+    }
+    status_.levels = static_cast<int>(ladder_.size());
+    status_.state = "steady";
+}
+
+PipelineGovernor::~PipelineGovernor() {
+    stop();
+}
+
+void PipelineGovernor::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    previous_ = sample();
+    thread_ = std::thread(&PipelineGovernor::run, this);
+}
+
+void PipelineGovernor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    config_->setLimits(RuntimeLimits());
+}
+
+void PipelineGovernor::run() {
+    ThreadTuning::apply("http", "governor");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(options_.interval_ms));
+        if (!running_) break;
+        lock.unlock();
+        evaluate();
+        lock.lock();
+    }
+}
+
+PipelineGovernor::Sample PipelineGovernor::sample() const {
+    Sample s;
+
+    // /proc/stat首行：cpu user nice system idle iowait irq softirq steal ...
+    std::ifstream stat("/proc/stat");
+    std::string label;
+    stat >> label;
+    uint64_t value;
+    for (int field = 0; field < 8 && stat >> value; ++field) {
+        s.cpu_total += value;
+        if (field == 3 || field == 4) s.cpu_idle += value;
+    }
+
+    CaptureStats capture = capture_->stats();
+    s.capture = capture.publish_latency;
+    s.late_dequeues = capture.late_dequeues;
+    for (const auto& stage : capture.stages) {
+        if (stage.stage == "broadcast") {
+            s.stream_pushed = stage.pushed;
+            s.stream_dropped = stage.dropped;
+        }
+    }
+    if (send_latency_) s.send = send_latency_->snapshot();
+    if (inference_latency_) s.inference = inference_latency_->snapshot();
+    return s;
+}
+
+void PipelineGovernor::evaluate() {
+    Sample current = sample();
+    const Sample& before = previous_;
+
+    double cpu_busy = 0.0;
+    if (current.cpu_total > before.cpu_total) {
+        double total = static_cast<double>(current.cpu_total - before.cpu_total);
+        cpu_busy = 1.0 - static_cast<double>(current.cpu_idle - before.cpu_idle) / total;
+    }
+    double capture_ms = windowMeanMs(before.capture, current.capture);
+    double send_ms = windowMeanMs(before.send, current.send);
+    double inference_ms = windowMeanMs(before.inference, current.inference);
+    uint64_t late = current.late_dequeues - before.late_dequeues;
+    uint64_t pushed = current.stream_pushed - before.stream_pushed;
+    uint64_t dropped = current.stream_dropped - before.stream_dropped;
+    previous_ = current;
+
+    // 任一信号越界即为过载，原因按采集、推流、推理、CPU的顺序列出
+    std::ostringstream reason;
+    reason << std::fixed << std::setprecision(0);
+    double frame_ms = 1000.0 / config_->current()->target_fps;
+    if (late > 0) {
+        reason << "捕获线程出队超时" << late << "次；";
+    }
+    if (capture_ms > frame_ms) {
+        reason << "采集到发布平均" << capture_ms << "ms，超过帧间隔" << frame_ms << "ms；";
+    }
+    if (send_ms > options_.send_budget_ms) {
+        reason << "采集到发送平均" << send_ms << "ms；";
+    }
+    if (pushed > 0 && static_cast<double>(dropped) / pushed > options_.stream_drop_ratio) {
+        reason << "推流丢帧" << dropped * 100 / pushed << "%；";
+    }
+    if (inference_ms > options_.inference_budget_ms) {
+        reason << "采集到推理完成平均" << inference_ms << "ms；";
+    }
+    if (cpu_busy >= options_.cpu_high) {
+        reason << "CPU占用" << cpu_busy * 100 << "%；";
+    }
+    std::string overload = reason.str();
+    if (!overload.empty()) {
+        overload.erase(overload.size() - std::string("；").size());
+    }
+    bool overloaded = !overload.empty();
+    bool idle = !overloaded && cpu_busy < options_.cpu_low;
+
+    int level;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_.state = overloaded ? "overloaded" : idle ? "idle" : "steady";
+        status_.reason = overload;
+        status_.cpu_busy = cpu_busy;
+        status_.capture_ms = capture_ms;
+        status_.send_ms = send_ms;
+        status_.inference_ms = inference_ms;
+        level = status_.level;
+    }
+
+    overloaded_periods_ = overloaded ? overloaded_periods_ + 1 : 0;
+    idle_periods_ = idle ? idle_periods_ + 1 : 0;
+
+    const int levels = static_cast<int>(ladder_.size());
+    if (overloaded_periods_ >= options_.degrade_periods && level < levels) {
+        // 跳过对当前配置不起作用的动作，直到限制真正收紧一步
+        int next = level + 1;
+        while (next < levels && sameEffect(next, level)) ++next;
+        if (!sameEffect(next, level)) {
+            moveTo(next, overload);
+        }
+        overloaded_periods_ = 0;
+    } else if (idle_periods_ >= options_.recover_periods && level > 0) {
+        int next = level - 1;
+        while (next > 0 && sameEffect(next, level)) --next;
+        while (next > 0 && sameEffect(next - 1, next)) --next;
+        std::ostringstream recover;
+        recover << std::fixed << std::setprecision(0) << "连续" << idle_periods_ << "个周期空闲，CPU占用"
+                << cpu_busy * 100 << "%";
+        moveTo(next, recover.str());
+        idle_periods_ = 0;
+    }
+}
+
+RuntimeLimits PipelineGovernor::limitsFor(int level) const {
+    RuntimeLimits limits;
+    for (int i = 0; i < level && i < static_cast<int>(ladder_.size()); ++i) {
+        limits.*(ladder_[i].field) = ladder_[i].value;
+    }
+    return limits;
+}
+
+bool PipelineGovernor::sameEffect(int a, int b) const {
+    RuntimeConfigPtr requested = config_->requested();
+    RuntimeConfig x = RuntimeConfigStore::applyLimits(*requested, limitsFor(a));
+    RuntimeConfig y = RuntimeConfigStore::applyLimits(*requested, limitsFor(b));
+    return x.inference_fps == y.inference_fps && x.model_input_size == y.model_input_size
+        && x.jpeg_quality == y.jpeg_quality && x.target_fps == y.target_fps;
+}
+
+void PipelineGovernor::moveTo(int level, const std::string& reason) {
+    RuntimeLimits limits = limitsFor(level);
+    config_->setLimits(limits);
+
+    int from;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        from = status_.level;
+        status_.level = level;
+        status_.limits = limits;
+        status_.transitions++;
+        status_.history.push_back({nowMs(), from, level, reason});
+        if (status_.history.size() > kHistorySize) {
+            status_.history.erase(status_.history.begin());
+        }
+    }
+    std::cout << "负载调节: 第" << from << "级 → 第" << level << "级(" << describe(limits) << ")，原因: "
+              << reason << std::endl;
+}
+
+std::string PipelineGovernor::describe(const RuntimeLimits& limits) {
+    std::ostringstream ss;
+    const char* separator = "";
+    if (limits.inference_fps > 0) {
+        ss << separator << "推理帧率≤" << limits.inference_fps;
+        separator = "，";
+    }
+    if (limits.model_input_size > 0) {
+        ss << separator << "模型输入≤" << limits.model_input_size;
+        separator = "，";
+    }
+    if (limits.jpeg_quality > 0) {
+        ss << separator << "JPEG质量≤" << limits.jpeg_quality;
+        separator = "，";
+    }
+    if (limits.target_fps > 0) {
+        ss << separator << "采集帧率≤" << limits.target_fps;
+        separator = "，";
+    }
+    std::string text = ss.str();
+    return text.empty() ? "无限制" : text;
+}
+
+PipelineGovernor::Status PipelineGovernor::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+Poco::JSON::Object PipelineGovernor::toJson(const Status& status) {
+    Poco::JSON::Object json;
+    json.set("level", status.level);
+    json.set("levels", status.levels);
+    json.set("state", status.state);
+    json.set("reason", status.reason);
+    json.set("cpu_percent", status.cpu_busy * 100.0);
+    json.set("capture_ms", status.capture_ms);
+    json.set("send_ms", status.send_ms);
+    json.set("inference_ms", status.inference_ms);
+
+    Poco::JSON::Object limits;
+    limits.set("inference_fps", status.limits.inference_fps);
+    limits.set("model_input_size", status.limits.model_input_size);
+    limits.set("jpeg_quality", status.limits.jpeg_quality);
+    limits.set("target_fps", status.limits.target_fps);
+    json.set("limits", limits);
+
+    json.set("transitions", status.transitions);
+    Poco::JSON::Array history;
+    for (const auto& transition : status.history) {
+        Poco::JSON::Object item;
+        item.set("time_ms", transition.time_ms);
+        item.set("from", transition.from);
+        item.set("to", transition.to);
+        item.set("reason", transition.reason);
+        history.add(item);
+    }
+    json.set("history", history);
+    return json;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file runtime_config.cpp
+ * @brief 运行时配置实现
+ */
+
+#include "runtime_config.h"
+#include <Poco/JSON/Parser.h>
+#include <Poco/JSON/Array.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+RuntimeConfigStore::RuntimeConfigStore(const RuntimeConfig& initial) {
+    auto config = std::make_shared<RuntimeConfig>(initial);
+    sanitize(*config);
+    requested_ = config;
+    config_ = config;
+}
+
+RuntimeConfig RuntimeConfigStore::applyLimits(const RuntimeConfig& config, const RuntimeLimits& limits) {
+    RuntimeConfig limited = config;
+    if (limits.inference_fps > 0) {
+        limited.inference_fps = limited.inference_fps > 0
+            ? std::min(limited.inference_fps, limits.inference_fps) : limits.inference_fps;
+    }
+    if (limits.model_input_size > 0) {
+        limited.model_input_size = std::min(limited.model_input_size, limits.model_input_size);
+    }
+    if (limits.jpeg_quality > 0) {
+        limited.jpeg_quality = std::min(limited.jpeg_quality, limits.jpeg_quality);
+    }
+    if (limits.target_fps > 0) {
+        limited.target_fps = std::min(limited.target_fps, limits.target_fps);
+    }
+    return limited;
+}
+
+RuntimeConfigPtr RuntimeConfigStore::publish() {
+    RuntimeConfigPtr published = std::make_shared<const RuntimeConfig>(applyLimits(*requested(), limits_));
+    std::atomic_store(&config_, published);
+    version_.fetch_add(1, std::memory_order_release);
+    return published;
+}
+
+void RuntimeConfigStore::setLimits(const RuntimeLimits& limits) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (limits == limits_) return;
+    limits_ = limits;
+    publish();
+}
+
+void RuntimeConfigStore::sanitize(RuntimeConfig& config) {
+    config.confidence_threshold = std::clamp(config.confidence_threshold, 0.0f, 1.0f);
+    config.target_fps = std::clamp(config.target_fps, 1, 120);
+    config.inference_fps = std::clamp(config.inference_fps, 0, 120);
+    config.jpeg_quality = std::clamp(config.jpeg_quality, 1, 100);
+    // 模型输入边长取32的倍数
+    config.model_input_size = std::clamp(config.model_input_size / 32 * 32, 160, 1280);
+    config.tile_overlap = std::clamp(config.tile_overlap, 0, 256);
+    config.max_tiles = std::clamp(config.max_tiles, 1, 16);
+    if (config.roi.x < 0 || config.roi.y < 0 || config.roi.width <= 0 || config.roi.height <= 0) {
+        config.roi = cv::Rect();
+    }
+    // 少于3个顶点的多边形没有面积
+    auto& polygons = config.roi_polygons;
+    polygons.erase(std::remove_if(polygons.begin(), polygons.end(),
+                                  [](const std::vector<cv::Point>& p) { return p.size() < 3; }),
+                   polygons.end());
+}
+
+bool RuntimeConfigStore::applyJson(const Poco::JSON::Object& json, std::string& error) {
+    // 先在草稿上校验，全部字段合法后才在写锁内把出现的字段应用到最新的用户配置上；
+    // 不能发布锁外复制的整份快照，否则会覆盖期间其他写者的修改
+    RuntimeConfig draft;
+    if (!applyFields(json, draft, error)) return false;
+
+    update([&json](RuntimeConfig& config) {
+        std::string ignored;
+        applyFields(json, config, ignored);
+    });
+    return true;
+}
+
+bool RuntimeConfigStore::applyFields(const Poco::JSON::Object& json, RuntimeConfig& next, std::string& error) {
+    try {
+        if (json.has("detection_enabled")) {
+            next.detection_enabled = json.getValue<bool>("detection_enabled");
+        }
+        if (json.has("confidence_threshold")) {
+            next.confidence_threshold = static_cast<float>(json.getValue<double>("confidence_threshold"));
+        }
+        if (json.has("target_fps")) {
+            next.target_fps = json.getValue<int>("target_fps");
+        }
+        if (json.has("inference_fps")) {
+            next.inference_fps = json.getValue<int>("inference_fps");
+        }
+        if (json.has("jpeg_quality")) {
+            next.jpeg_quality = json.getValue<int>("jpeg_quality");
+        }
+        if (json.has("model_input_size")) {
+            next.model_input_size = json.getValue<int>("model_input_size");
+        }
+        if (json.has("tiling_enabled")) {
+            next.tiling_enabled = json.getValue<bool>("tiling_enabled");
+        }
+        if (json.has("tile_overlap")) {
+            next.tile_overlap = json.getValue<int>("tile_overlap");
+        }
+        if (json.has("max_tiles")) {
+            next.max_tiles = json.getValue<int>("max_tiles");
+        }
+        if (json.has("tile_full_frame")) {
+            next.tile_full_frame = json.getValue<bool>("tile_full_frame");
+        }
+        if (json.has("roi")) {
+            auto roi = json.getObject("roi");
+            if (roi.isNull()) {
+                next.roi = cv::Rect();
+            } else {
+                next.roi = cv::Rect(roi->getValue<int>("x"), roi->getValue<int>("y"),
+                                    roi->getValue<int>("width"), roi->getValue<int>("height"));
+            }
+        }
+        if (json.has("roi_polygons")) {
+            // 格式：[[[x, y], [x, y], ...], ...]
+            next.roi_polygons.clear();
+            auto polygons = json.getArray("roi_polygons");
+            for (size_t i = 0; !polygons.isNull() && i < polygons->size(); ++i) {
+                auto points = polygons->getArray(static_cast<unsigned>(i));
+                if (points.isNull()) continue;
+                std::vector<cv::Point> polygon;
+                for (size_t j = 0; j < points->size(); ++j) {
+                    auto point = points->getArray(static_cast<unsigned>(j));
+                    if (point.isNull() || point->size() < 2) {
+                        error = "roi_polygons中的顶点应为[x, y]";
+                        return false;
+                    }
+                    polygon.emplace_back(point->getElement<int>(0), point->getElement<int>(1));
+                }
+                next.roi_polygons.push_back(std::move(polygon));
+            }
+        }
+    } catch (const Poco::Exception& e) {
+        error = e.displayText();
+        return false;
+    }
+    return true;
+}
+
+bool RuntimeConfigStore::loadFile(const std::string& path) {
+    auto json = loadJsonFile(path);
+    if (json.isNull()) return false;
+
+    std::string error;
+    if (!applyJson(*json, error)) {
+        std::cerr << "配置文件" << path << "无效: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Poco::JSON::Object::Ptr loadJsonFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.good()) return Poco::JSON::Object::Ptr();
+
+    try {
+        Poco::JSON::Parser parser;
+        return parser.parse(file).extract<Poco::JSON::Object::Ptr>();
+    } catch (const Poco::Exception& e) {
+        std::cerr << "配置文件" << path << "解析失败: " << e.displayText() << std::endl;
+    }
+    return Poco::JSON::Object::Ptr();
+}
+
+Poco::JSON::Object RuntimeConfigStore::toJson(const RuntimeConfig& config) {
+    Poco::JSON::Object json;
+    json.set("detection_enabled", config.detection_enabled);
+    json.set("confidence_threshold", config.confidence_threshold);
+    json.set("target_fps", config.target_fps);
+    json.set("inference_fps", config.inference_fps);
+    json.set("jpeg_quality", config.jpeg_quality);
+    json.set("model_input_size", config.model_input_size);
+    json.set("tiling_enabled", config.tiling_enabled);
+    json.set("tile_overlap", config.tile_overlap);
+    json.set("max_tiles", config.max_tiles);
+    json.set("tile_full_frame", config.tile_full_frame);
+    if (!config.roi.empty()) {
+        Poco::JSON::Object roi;
+        roi.set("x", config.roi.x);
+        roi.set("y", config.roi.y);
+        roi.set("width", config.roi.width);
+        roi.set("height", config.roi.height);
+        json.set("roi", roi);
+    } else {
+        json.set("roi", Poco::Dynamic::Var());
+    }
+    Poco::JSON::Array polygons;
+    for (const auto& polygon : config.roi_polygons) {
+        Poco::JSON::Array points;
+        for (const auto& point : polygon) {
+            Poco::JSON::Array xy;
+            xy.add(point.x);
+            xy.add(point.y);
+            points.add(xy);
+        }
+        polygons.add(points);
+    }
+    json.set("roi_polygons", polygons);
+    return json;
+}
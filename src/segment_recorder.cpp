@@ -0,0 +1,254 @@
+/**
+ * @file segment_recorder.cpp
+ * @brief 服务端分段录像实现
+ */
+
+#include "segment_recorder.h"
+#include "thread_tuning.h"
+#include "frame_mailbox.h"
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// linux/ioprio.h在部分工具链中缺失，直接使用内核ABI常量
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassBestEffort = 2;
+constexpr int kIoprioClassShift = 13;
+constexpr int kIoprioLowestLevel = 7;
+
+bool isSegmentFile(const char* name) {
+    size_t len = strlen(name);
+    return len > 4 && strcmp(name + len - 4, ".avi") == 0;
+}
+
+} // namespace
+
+RecorderOptions RecorderOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    RecorderOptions options;
+    if (json.isNull()) return options;
+
+    options.directory = json->optValue<std::string>("directory", options.directory);
+    options.segment_seconds = std::max(json->optValue<int>("segment_seconds", options.segment_seconds), 1);
+    if (json->has("quota_mb")) {
+        options.quota_bytes = static_cast<uint64_t>(std::max(json->getValue<int>("quota_mb"), 1)) << 20;
+    }
+    options.enabled = json->optValue<bool>("enabled", options.enabled);
+    return options;
+}
+
+SegmentRecorder::SegmentRecorder(std::shared_ptr<CaptureInterface> capture,
+                                 std::shared_ptr<RuntimeConfigStore> config,
+                                 RecorderOptions options)
+    : capture_(std::move(capture))
+    , config_(config ? std::move(config) : std::make_shared<RuntimeConfigStore>())
+    , options_(std::move(options))
+    , recording_(options_.enabled) {}
+
+SegmentRecorder::~SegmentRecorder() {
+    stop();
+}
+
+bool SegmentRecorder::start() {
+    if (running_) return true;
+
+    if (mkdir(options_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "无法创建录像目录 " << options_.directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    enforceQuota();
+
+    running_ = true;
+    thread_ = std::thread(&SegmentRecorder::run, this);
+    return true;
+}
+
+void SegmentRecorder::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+SegmentRecorder::Status SegmentRecorder::status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    Status status = status_;
+    status.recording = recording_;
+    return status;
+}
+
+Poco::JSON::Object SegmentRecorder::toJson(const Status& status) {
+    Poco::JSON::Object json;
+    json.set("recording", status.recording);
+    json.set("current_file", status.current_file);
+    json.set("segments", status.segments);
+    json.set("frames_written", status.frames_written);
+    json.set("frames_skipped", status.frames_skipped);
+    json.set("bytes_written", status.bytes_written);
+    json.set("disk_usage", status.disk_usage);
+    return json;
+}
+
+void SegmentRecorder::run() {
+    lowerThreadPriority();
+    ThreadTuning::apply("recording", "recorder");
+
+    // 队列策略：短暂的写盘停顿不丢帧，持续积压时丢弃新帧并计入跳过帧数
+    auto mailbox = capture_->subscribe("recorder", MailboxOptions{MailboxPolicy::kQueue, 4});
+    uint64_t last_sequence = 0;
+    while (running_) {
+        auto frame = mailbox->pop(200ms);
+        if (!recording_) {
+            closeSegment();
+            if (frame) last_sequence = frame->sequence;
+            continue;
+        }
+        if (!frame) continue;
+
+        // 序号不连续说明写盘积压期间信箱丢弃了帧
+        uint64_t skipped = last_sequence > 0 && frame->sequence > last_sequence + 1
+            ? frame->sequence - last_sequence - 1 : 0;
+        last_sequence = frame->sequence;
+
+        bool rotate = writer_.isOpen()
+            && (frame->wall_time >= segment_start_ + std::chrono::seconds(options_.segment_seconds)
+                || frame->width != segment_width_ || frame->height != segment_height_);
+        if (rotate) {
+            closeSegment();
+        }
+        if (!writer_.isOpen() && !openSegment(*frame)) {
+            // 目录不可写或磁盘已满，稍后重试
+            std::this_thread::sleep_for(1s);
+            continue;
+        }
+
+        // 按墙钟时间定位，回放时长与实际一致
+        bool written = false;
+        bool ok = writer_.writeFrameAt(frame->jpeg.data(), frame->jpeg.size(),
+            std::chrono::duration_cast<std::chrono::microseconds>(frame->wall_time - segment_start_),
+            written);
+        if (ok && !written) ++skipped;
+
+        {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            status_.frames_skipped += skipped;
+            if (written) ++status_.frames_written;
+            if (ok) status_.bytes_written = writer_.bytesWritten();
+        }
+        if (!ok) {
+            std::cerr << "录像写入失败，关闭当前分段" << std::endl;
+            closeSegment();
+        }
+    }
+    mailbox->close();
+    closeSegment();
+}
+
+bool SegmentRecorder::openSegment(const EncodedFrame& frame) {
+    // 文件名按时间排序即为录制顺序，配额清理依赖这一点
+    std::string name = timestampName(frame.wall_time) + ".avi";
+    std::string path = options_.directory + "/" + name;
+    int fps = config_->current()->target_fps;
+    if (!writer_.open(path, frame.width, frame.height, fps)) {
+        return false;
+    }
+
+    segment_start_ = frame.wall_time;
+    segment_width_ = frame.width;
+    segment_height_ = frame.height;
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_.current_file = name;
+    status_.bytes_written = writer_.bytesWritten();
+    return true;
+}
+
+void SegmentRecorder::closeSegment() {
+    if (!writer_.isOpen()) return;
+
+    if (!writer_.close()) {
+        std::cerr << "录像分段收尾失败" << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        ++status_.segments;
+        status_.current_file.clear();
+    }
+    enforceQuota();
+}
+
+void SegmentRecorder::enforceQuota() {
+    std::string current;
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        current = status_.current_file;
+    }
+    uint64_t usage = pruneDirectory(options_.directory, options_.quota_bytes, current);
+
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_.disk_usage = usage;
+}
+
+uint64_t SegmentRecorder::pruneDirectory(const std::string& directory, uint64_t quota_bytes,
+                                         const std::string& keep) {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) return 0;
+
+    std::vector<std::pair<std::string, uint64_t>> files;
+    uint64_t total = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (!isSegmentFile(entry->d_name)) continue;
+        struct stat st;
+        std::string path = directory + "/" + entry->d_name;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            files.emplace_back(entry->d_name, static_cast<uint64_t>(st.st_size));
+            total += static_cast<uint64_t>(st.st_size);
+        }
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    for (const auto& file : files) {
+        if (total <= quota_bytes) break;
+        if (file.first == keep) continue;
+        std::string path = directory + "/" + file.first;
+        if (unlink(path.c_str()) == 0) {
+            total -= file.second;
+            std::cout << "录像目录超出配额，已删除 " << path << std::endl;
+        }
+    }
+    return total;
+}
+
+std::string SegmentRecorder::timestampName(std::chrono::system_clock::time_point time) {
+    auto seconds = std::chrono::system_clock::to_time_t(time);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+        time.time_since_epoch()).count() % 1000;
+    std::tm tm{};
+    localtime_r(&seconds, &tm);
+    char name[64];
+    size_t len = strftime(name, sizeof(name), "%Y%m%d-%H%M%S", &tm);
+    snprintf(name + len, sizeof(name) - len, "-%03d", static_cast<int>(millis));
+    return name;
+}
+
+void SegmentRecorder::lowerThreadPriority() {
+    // Linux下nice值和IO优先级均按线程生效
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 10) != 0) {
+        std::cerr << "无法降低录像线程优先级: " << strerror(errno) << std::endl;
+    }
+    int ioprio = (kIoprioClassBestEffort << kIoprioClassShift) | kIoprioLowestLevel;
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, ioprio);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file snapshot_cache.cpp
+ * @brief 快照缩放图缓存实现
+ */
+
+#include "snapshot_cache.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace {
+constexpr int kMinWidth = 16;            ///< 允许的最小输出宽度
+constexpr int kScaledJpegQuality = 85;   ///< 缩放图的JPEG质量
+}
+
+SnapshotCache::SnapshotCache(size_t capacity)
+    : capacity_(capacity ? capacity : 1) {}
+
+int SnapshotCache::normalizeWidth(const EncodedFramePtr& frame, int width) {
+    if (!frame || width <= 0 || frame->width <= 0 || width >= frame->width) {
+        return 0;
+    }
+    return std::max(kMinWidth, width & ~7);
+}
+
+SharedBytes SnapshotCache::get(const EncodedFramePtr& frame, int width) {
+    if (!frame) return nullptr;
+
+    width = normalizeWidth(frame, width);
+    if (width == 0) {
+        return SharedBytes(frame, frame->jpeg.data(), frame->jpeg.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_) {
+            if (entry.sequence == frame->sequence && entry.width == width) {
+                entry.last_used = ++clock_;
+                return entry.jpeg;
+            }
+        }
+    }
+
+    // 未命中时在锁外完成解码、缩放和编码
+    cv::Mat img = cv::imdecode(frame->jpeg, cv::IMREAD_COLOR);
+    if (img.empty()) return nullptr;
+
+    int height = std::max(1, img.rows * width / img.cols);
+    cv::Mat scaled;
+    cv::resize(img, scaled, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+
+    auto buffer = std::make_shared<std::vector<uchar>>();
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, kScaledJpegQuality};
+    if (!cv::imencode(".jpg", scaled, *buffer, params)) return nullptr;
+    SharedBytes jpeg(buffer, buffer->data(), buffer->size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry entry{frame->sequence, width, jpeg, ++clock_};
+    if (entries_.size() < capacity_) {
+        entries_.push_back(std::move(entry));
+    } else {
+        auto oldest = std::min_element(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+        *oldest = std::move(entry);
+    }
+    return jpeg;
+}
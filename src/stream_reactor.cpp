@@ -0,0 +1,729 @@
+/**
+ * @file stream_reactor.cpp
+ * @brief 基于epoll的事件驱动连接管理器实现
+ */
+
+#include "stream_reactor.h"
+#include "thread_tuning.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// WebSocket操作码(RFC 6455)
+constexpr uint8_t kOpContinuation = 0x0;
+constexpr uint8_t kOpText = 0x1;
+constexpr uint8_t kOpBinary = 0x2;
+constexpr uint8_t kOpClose = 0x8;
+constexpr uint8_t kOpPing = 0x9;
+constexpr uint8_t kOpPong = 0xA;
+
+constexpr size_t kMaxClientMessage = 64 * 1024;  ///< 客户端消息上限，只接收控制命令
+constexpr size_t kMaxIovecs = 32;                ///< 单次writev的最大分段数
+constexpr int kMaxEvents = 64;                   ///< 单次epoll_wait的最大事件数
+constexpr uint64_t kWakeupTag = 0;               ///< eventfd在epoll中的标识
+constexpr unsigned kLoopBits = 8;                ///< 连接ID中表示线程序号的位数
+constexpr size_t kTaskReserve = 64;              ///< 任务队列的初始容量
+constexpr size_t kMinQueueSlots = 8;             ///< 写队列的初始槽位数
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+} // namespace
+
+StreamReactor::StreamReactor(size_t num_threads, size_t max_queued_messages, size_t max_queued_bytes)
+    : max_queued_messages_(max_queued_messages ? max_queued_messages : 1)
+    , max_queued_bytes_(max_queued_bytes) {
+    if (num_threads == 0) num_threads = 1;
+    if (num_threads > (1u << kLoopBits)) num_threads = 1u << kLoopBits;
+    for (size_t i = 0; i < num_threads; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->tasks.reserve(kTaskReserve);
+        loop->running.reserve(kTaskReserve);
+        loops_.push_back(std::move(loop));
+    }
+}
+
+StreamReactor::~StreamReactor() {
+    stop();
+}
+
+bool StreamReactor::start() {
+    if (running_) return true;
+
+    for (auto& loop : loops_) {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd < 0 || loop->event_fd < 0) {
+            std::cerr << "创建epoll实例失败: " << strerror(errno) << std::endl;
+            stop();
+            return false;
+        }
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeupTag;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->event_fd, &ev);
+    }
+
+    running_ = true;
+    for (auto& loop : loops_) {
+        Loop* l = loop.get();
+        loop->thread = std::thread([this, l] { run(*l); });
+    }
+    return true;
+}
+
+void StreamReactor::stop() {
+    running_ = false;
+    for (auto& loop : loops_) {
+        if (loop->event_fd >= 0) {
+            uint64_t one = 1;
+            (void)!write(loop->event_fd, &one, sizeof(one));
+        }
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+        // 执行尚未处理的任务，使其中新接管的连接也能被正常关闭
+        if (loop->epoll_fd >= 0) {
+            runTasks(*loop);
+        }
+        for (auto& entry : loop->connections) {
+            closeConnection(*loop, *entry.second);
+        }
+        loop->connections.clear();
+        loop->dead.clear();
+        if (loop->epoll_fd >= 0) {
+            close(loop->epoll_fd);
+            loop->epoll_fd = -1;
+        }
+        if (loop->event_fd >= 0) {
+            close(loop->event_fd);
+            loop->event_fd = -1;
+        }
+    }
+}
+
+uint64_t StreamReactor::addWebSocket(int fd, uint32_t stream_key) {
+    return addConnection(fd, Protocol::WebSocket, stream_key);
+}
+
+uint64_t StreamReactor::addMjpegStream(int fd) {
+    return addConnection(fd, Protocol::Mjpeg, 0);
+}
+
+uint64_t StreamReactor::addConnection(int fd, Protocol protocol, uint32_t stream_key) {
+    if (!running_ || fd < 0 || stream_key >= kMaxStreamKeys || !setNonBlocking(fd)) {
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint64_t seq = next_id_++;
+    size_t index = seq % loops_.size();
+    uint64_t id = (seq << kLoopBits) | index;
+    Loop& loop = *loops_[index];
+
+    Task task;
+    task.kind = Task::Kind::Add;
+    task.conn_id = id;
+    task.fd = fd;
+    task.protocol = protocol;
+    task.stream_key = stream_key;
+    post(loop, std::move(task));
+    return id;
+}
+
+void StreamReactor::broadcast(SharedBytes payload, bool binary, bool droppable, uint32_t stream_key) {
+    if (!running_ || !payload || subscriberCount(stream_key) == 0) return;
+
+    // 帧头只构造一次，随消息复制给各连接
+    OutMessage message;
+    setFrameHeader(message, binary ? kOpBinary : kOpText, payload.size);
+    message.payload = std::move(payload);
+    message.stream_key = stream_key;
+    message.droppable = droppable;
+    broadcastMessage(Protocol::WebSocket, std::move(message));
+}
+
+void StreamReactor::broadcastChain(SharedBytes payload, bool sync, uint32_t stream_key) {
+    if (!running_ || !payload || subscriberCount(stream_key) == 0) return;
+
+    OutMessage message;
+    setFrameHeader(message, kOpBinary, payload.size);
+    message.payload = std::move(payload);
+    message.stream_key = stream_key;
+    message.droppable = false;
+    message.chain = true;
+    message.sync = sync;
+    broadcastMessage(Protocol::WebSocket, std::move(message));
+}
+
+void StreamReactor::broadcastPrefixed(SharedBytes prefix, SharedBytes payload, uint32_t stream_key) {
+    if (!running_ || !prefix || !payload || subscriberCount(stream_key) == 0) return;
+
+    OutMessage message;
+    setFrameHeader(message, kOpBinary, prefix.size + payload.size);
+    message.prefix = std::move(prefix);
+    message.payload = std::move(payload);
+    message.stream_key = stream_key;
+    message.droppable = true;
+    broadcastMessage(Protocol::WebSocket, std::move(message));
+}
+
+void StreamReactor::broadcastMjpeg(SharedBytes jpeg) {
+    if (!running_ || !jpeg) return;
+    broadcastMessage(Protocol::Mjpeg, makeMjpegPart(std::move(jpeg)));
+}
+
+void StreamReactor::sendMjpeg(uint64_t conn_id, SharedBytes jpeg) {
+    if (!running_ || !jpeg) return;
+    sendMessage(conn_id, makeMjpegPart(std::move(jpeg)));
+}
+
+StreamReactor::OutMessage StreamReactor::makeMjpegPart(SharedBytes jpeg) {
+    // 分段头以CRLF开头，兼作上一帧数据的结尾
+    OutMessage message;
+    int n = snprintf(message.header, sizeof(message.header),
+                     "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                     kMjpegBoundary, jpeg.size);
+    message.header_size = static_cast<uint8_t>(n);
+    message.payload = std::move(jpeg);
+    message.droppable = true;
+    return message;
+}
+
+void StreamReactor::broadcastMessage(Protocol protocol, OutMessage message) {
+    if (connectionCount(protocol) == 0) return;
+
+    for (auto& loop : loops_) {
+        Task task;
+        task.kind = Task::Kind::Broadcast;
+        task.protocol = protocol;
+        task.message = message;
+        post(*loop, std::move(task));
+    }
+}
+
+void StreamReactor::send(uint64_t conn_id, SharedBytes payload, bool binary) {
+    if (!running_ || !payload) return;
+
+    OutMessage message;
+    setFrameHeader(message, binary ? kOpBinary : kOpText, payload.size);
+    message.payload = std::move(payload);
+    message.droppable = false;
+    sendMessage(conn_id, std::move(message));
+}
+
+void StreamReactor::sendMessage(uint64_t conn_id, OutMessage message) {
+    Task task;
+    task.kind = Task::Kind::Send;
+    task.conn_id = conn_id;
+    task.message = std::move(message);
+    post(*loops_[conn_id & ((1u << kLoopBits) - 1)], std::move(task));
+}
+
+void StreamReactor::setStreamKey(uint64_t conn_id, uint32_t stream_key) {
+    if (!running_ || stream_key >= kMaxStreamKeys) return;
+
+    Task task;
+    task.kind = Task::Kind::SetKey;
+    task.conn_id = conn_id;
+    task.stream_key = stream_key;
+    post(*loops_[conn_id & ((1u << kLoopBits) - 1)], std::move(task));
+}
+
+StreamReactor::Stats StreamReactor::stats() const {
+    Stats s;
+    s.connections = connection_count_.load(std::memory_order_relaxed);
+    s.messages_sent = messages_sent_.load(std::memory_order_relaxed);
+    s.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    s.messages_dropped = messages_dropped_.load(std::memory_order_relaxed);
+    s.resyncs = resyncs_.load(std::memory_order_relaxed);
+    s.slow_closed = slow_closed_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void StreamReactor::post(Loop& loop, Task task) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(loop.task_mutex);
+        wake = loop.tasks.empty();
+        loop.tasks.push_back(std::move(task));
+    }
+    // 队列非空时线程已被唤醒过，无需重复写eventfd
+    if (wake) {
+        uint64_t one = 1;
+        (void)!write(loop.event_fd, &one, sizeof(one));
+    }
+}
+
+void StreamReactor::runTasks(Loop& loop) {
+    // 两个数组交换使用，clear()保留容量，稳态下投递任务不再分配内存
+    {
+        std::lock_guard<std::mutex> lock(loop.task_mutex);
+        loop.running.swap(loop.tasks);
+    }
+    for (auto& task : loop.running) {
+        runTask(loop, task);
+    }
+    loop.running.clear();
+}
+
+void StreamReactor::runTask(Loop& loop, Task& task) {
+    switch (task.kind) {
+    case Task::Kind::Add: {
+        auto conn = std::make_unique<Connection>();
+        conn->id = task.conn_id;
+        conn->fd = task.fd;
+        conn->protocol = task.protocol;
+        conn->stream_key = task.stream_key;
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = task.conn_id;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, task.fd, &ev) < 0) {
+            close(task.fd);
+            return;
+        }
+        loop.connections.emplace(task.conn_id, std::move(conn));
+        ++connection_count_;
+        ++protocol_count_[static_cast<int>(task.protocol)];
+        if (task.protocol == Protocol::WebSocket) ++key_count_[task.stream_key];
+        break;
+    }
+    case Task::Kind::Broadcast:
+        for (auto& entry : loop.connections) {
+            const Connection& conn = *entry.second;
+            if (conn.protocol == task.protocol
+                && (task.protocol != Protocol::WebSocket || conn.stream_key == task.message.stream_key)) {
+                enqueue(loop, *entry.second, task.message);
+            }
+        }
+        break;
+    case Task::Kind::Send: {
+        auto it = loop.connections.find(task.conn_id);
+        if (it != loop.connections.end()) {
+            enqueue(loop, *it->second, std::move(task.message));
+        }
+        break;
+    }
+    case Task::Kind::SetKey: {
+        auto it = loop.connections.find(task.conn_id);
+        if (it == loop.connections.end()) return;
+        Connection& conn = *it->second;
+        if (conn.dead || conn.protocol != Protocol::WebSocket) return;
+        --key_count_[conn.stream_key];
+        ++key_count_[task.stream_key];
+        conn.stream_key = task.stream_key;
+        // 新订阅键上的解码链与之前的无关，从其下一个同步点开始接收
+        conn.awaiting_sync = true;
+        break;
+    }
+    }
+}
+
+void StreamReactor::run(Loop& loop) {
+    ThreadTuning::apply("streaming", "reactor");
+    struct epoll_event events[kMaxEvents];
+
+    while (running_) {
+        int n = epoll_wait(loop.epoll_fd, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait失败: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == kWakeupTag) {
+                uint64_t value;
+                (void)!read(loop.event_fd, &value, sizeof(value));
+                runTasks(loop);
+                continue;
+            }
+
+            auto it = loop.connections.find(id);
+            if (it == loop.connections.end() || it->second->dead) continue;
+            Connection& conn = *it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(loop, conn);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                handleReadable(loop, conn);
+            }
+            if ((events[i].events & EPOLLOUT) && !conn.dead) {
+                flush(loop, conn);
+            }
+        }
+        reap(loop);
+    }
+}
+
+void StreamReactor::handleReadable(Loop& loop, Connection& conn) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.read_buffer.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        // 对端关闭或出错
+        closeConnection(loop, conn);
+        return;
+    }
+
+    // MJPEG客户端不会再发送有效数据
+    if (conn.protocol == Protocol::Mjpeg) {
+        conn.read_buffer.clear();
+        return;
+    }
+
+    if (!parseFrames(loop, conn)) {
+        closeConnection(loop, conn);
+    }
+}
+
+bool StreamReactor::parseFrames(Loop& loop, Connection& conn) {
+    std::string& in = conn.read_buffer;
+    size_t pos = 0;
+
+    while (in.size() - pos >= 2) {
+        const auto* p = reinterpret_cast<const uint8_t*>(in.data() + pos);
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+
+        if (length == 126) {
+            if (in.size() - pos < 4) break;
+            length = (uint64_t(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (in.size() - pos < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; ++i) length = (length << 8) | p[2 + i];
+            header = 10;
+        }
+
+        // 客户端帧必须带掩码
+        if (!masked || length > kMaxClientMessage) return false;
+        if (in.size() - pos < header + 4 + length) break;
+
+        const uint8_t* mask = p + header;
+        std::string payload(in.data() + pos + header + 4, length);
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+        }
+        pos += header + 4 + length;
+
+        switch (opcode) {
+        case kOpText:
+        case kOpBinary:
+            if (fin) {
+                if (on_message_) on_message_(conn.id, payload);
+            } else {
+                conn.fragments = std::move(payload);
+                conn.fragments_binary = opcode == kOpBinary;
+            }
+            break;
+        case kOpContinuation:
+            if (conn.fragments.size() + payload.size() > kMaxClientMessage) return false;
+            conn.fragments += payload;
+            if (fin) {
+                if (on_message_) on_message_(conn.id, conn.fragments);
+                conn.fragments.clear();
+            }
+            break;
+        case kOpPing: {
+            OutMessage pong;
+            setFrameHeader(pong, kOpPong, payload.size());
+            pong.payload = std::make_shared<const std::string>(std::move(payload));
+            pong.droppable = false;
+            enqueue(loop, conn, std::move(pong));
+            break;
+        }
+        case kOpPong:
+            break;
+        case kOpClose: {
+            // 回应关闭帧，发送完毕后断开
+            OutMessage close_msg;
+            setFrameHeader(close_msg, kOpClose, 0);
+            close_msg.droppable = false;
+            conn.closing = true;
+            enqueue(loop, conn, std::move(close_msg));
+            in.clear();
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    in.erase(0, pos);
+    return true;
+}
+
+void StreamReactor::enqueue(Loop& loop, Connection& conn, OutMessage message) {
+    if (conn.dead || (conn.closing && (message.droppable || message.chain))) return;
+
+    if (message.chain) {
+        if (message.sync) {
+            // 同步点之前积压的链上消息已过时，直接丢弃，从同步点开始解码不受影响
+            if (pendingCount(conn, true) >= max_queued_messages_) {
+                purge(conn, false, true);
+            }
+            conn.awaiting_sync = false;
+        } else if (conn.awaiting_sync) {
+            ++messages_dropped_;
+            return;
+        } else if (pendingCount(conn, true) >= max_queued_messages_) {
+            // 中途丢弃一条会让其后直到下一个同步点的内容都无法解码，改为整段跳过
+            skipToSync(conn);
+            ++messages_dropped_;
+            return;
+        }
+    } else if (message.droppable && pendingCount(conn, false) >= max_queued_messages_) {
+        // 超出上限时丢弃最旧的一条可丢弃消息
+        size_t first = conn.front_offset > 0 ? 1 : 0;
+        for (size_t i = first; i < conn.queue.size(); ++i) {
+            if (conn.queue[i].droppable) {
+                conn.queued_bytes -= conn.queue[i].size();
+                conn.queue.erase(i);
+                ++messages_dropped_;
+                break;
+            }
+        }
+    }
+
+    // 字节上限：先丢弃可丢弃消息，再丢弃解码链上的积压(新消息不是同步点时链从下一个同步点恢复)，
+    // 仍放不下时说明不可丢弃的消息已积压过多，断开慢速连接
+    if (max_queued_bytes_ > 0 && conn.queued_bytes + message.size() > max_queued_bytes_) {
+        purge(conn, true, false);
+        if (conn.queued_bytes + message.size() > max_queued_bytes_ && purge(conn, false, true)
+            && !(message.chain && message.sync)) {
+            skipToSync(conn);
+        }
+        if (message.chain && conn.awaiting_sync) {
+            ++messages_dropped_;
+            return;
+        }
+        if (conn.queued_bytes + message.size() > max_queued_bytes_) {
+            std::cerr << "连接" << conn.id << "的写队列超过" << max_queued_bytes_ << "字节，断开" << std::endl;
+            ++slow_closed_;
+            closeConnection(loop, conn);
+            return;
+        }
+    }
+
+    conn.queued_bytes += message.size();
+    conn.queue.push_back(std::move(message));
+    if (!conn.want_write) {
+        flush(loop, conn);
+    }
+}
+
+size_t StreamReactor::pendingCount(const Connection& conn, bool chain) const {
+    // 只统计尚未开始发送的消息，已部分写出的队首消息必须发完
+    size_t pending = 0;
+    for (size_t i = conn.front_offset > 0 ? 1 : 0; i < conn.queue.size(); ++i) {
+        const OutMessage& msg = conn.queue[i];
+        if (chain ? msg.chain : msg.droppable) ++pending;
+    }
+    return pending;
+}
+
+bool StreamReactor::purge(Connection& conn, bool droppable, bool chain) {
+    bool removed = false;
+    size_t first = conn.front_offset > 0 ? 1 : 0;
+    for (size_t i = conn.queue.size(); i-- > first;) {
+        const OutMessage& msg = conn.queue[i];
+        if ((droppable && msg.droppable) || (chain && msg.chain)) {
+            conn.queued_bytes -= msg.size();
+            conn.queue.erase(i);
+            ++messages_dropped_;
+            removed = true;
+        }
+    }
+    return removed;
+}
+
+void StreamReactor::skipToSync(Connection& conn) {
+    // 丢弃尚未发出的链上消息，等待下一个同步点，并请求生产者尽快输出
+    purge(conn, false, true);
+    if (!conn.awaiting_sync) {
+        conn.awaiting_sync = true;
+        ++resyncs_;
+    }
+    resync_[conn.stream_key].store(true, std::memory_order_relaxed);
+}
+
+void StreamReactor::flush(Loop& loop, Connection& conn) {
+    while (!conn.queue.empty()) {
+        struct iovec iov[kMaxIovecs];
+        size_t count = 0;
+        size_t offset = conn.front_offset;
+
+        for (size_t i = 0; i < conn.queue.size(); ++i) {
+            if (count + 3 > kMaxIovecs) break;
+            const OutMessage& msg = conn.queue[i];
+            const struct { const char* data; size_t size; } parts[3] = {
+                {msg.header, msg.header_size}, {msg.prefix.data, msg.prefix.size}, {msg.payload.data, msg.payload.size}};
+            for (const auto& part : parts) {
+                if (part.size == 0) continue;
+                if (offset >= part.size) {
+                    offset -= part.size;
+                    continue;
+                }
+                iov[count].iov_base = const_cast<char*>(part.data) + offset;
+                iov[count].iov_len = part.size - offset;
+                offset = 0;
+                ++count;
+            }
+        }
+
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                updateInterest(loop, conn, true);
+                return;
+            }
+            closeConnection(loop, conn);
+            return;
+        }
+        bytes_sent_ += n;
+
+        // 弹出已完整发送的消息
+        size_t written = conn.front_offset + static_cast<size_t>(n);
+        while (!conn.queue.empty() && written >= conn.queue.front().size()) {
+            written -= conn.queue.front().size();
+            conn.queued_bytes -= conn.queue.front().size();
+            conn.queue.pop_front();
+            ++messages_sent_;
+        }
+        conn.front_offset = written;
+    }
+
+    if (conn.closing) {
+        closeConnection(loop, conn);
+        return;
+    }
+    updateInterest(loop, conn, false);
+}
+
+void StreamReactor::updateInterest(Loop& loop, Connection& conn, bool want_write) {
+    if (conn.want_write == want_write) return;
+    conn.want_write = want_write;
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.u64 = conn.id;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void StreamReactor::closeConnection(Loop& loop, Connection& conn) {
+    if (conn.dead) return;
+
+    // 连接对象可能仍被调用方引用(例如广播遍历中)，延迟到本轮事件处理结束后回收
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    close(conn.fd);
+    conn.fd = -1;
+    conn.dead = true;
+    conn.queue.clear();
+    conn.queued_bytes = 0;
+    loop.dead.push_back(conn.id);
+    --connection_count_;
+    --protocol_count_[static_cast<int>(conn.protocol)];
+    if (conn.protocol == Protocol::WebSocket) {
+        --key_count_[conn.stream_key];
+        if (on_close_) on_close_(conn.id);
+    }
+}
+
+void StreamReactor::reap(Loop& loop) {
+    for (uint64_t id : loop.dead) {
+        loop.connections.erase(id);
+    }
+    loop.dead.clear();
+}
+
+void StreamReactor::setFrameHeader(OutMessage& message, uint8_t opcode, size_t payload_size) {
+    auto* header = reinterpret_cast<uint8_t*>(message.header);
+    size_t n = 0;
+    header[n++] = 0x80 | opcode;  // FIN + 操作码，服务端帧不加掩码
+    if (payload_size < 126) {
+        header[n++] = static_cast<uint8_t>(payload_size);
+    } else if (payload_size <= 0xFFFF) {
+        header[n++] = 126;
+        header[n++] = static_cast<uint8_t>((payload_size >> 8) & 0xFF);
+        header[n++] = static_cast<uint8_t>(payload_size & 0xFF);
+    } else {
+        header[n++] = 127;
+        for (int i = 7; i >= 0; --i) {
+            header[n++] = static_cast<uint8_t>((uint64_t(payload_size) >> (8 * i)) & 0xFF);
+        }
+    }
+    message.header_size = static_cast<uint8_t>(n);
+}
+
+void StreamReactor::MessageQueue::push_back(OutMessage message) {
+    if (size_ == slots_.size()) {
+        // 扩容时按队列顺序搬到新数组的开头
+        std::vector<OutMessage> grown(std::max(kMinQueueSlots, slots_.size() * 2));
+        for (size_t i = 0; i < size_; ++i) {
+            grown[i] = std::move((*this)[i]);
+        }
+        slots_.swap(grown);
+        head_ = 0;
+    }
+    (*this)[size_] = std::move(message);
+    ++size_;
+}
+
+void StreamReactor::MessageQueue::pop_front() {
+    slots_[head_] = OutMessage();
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    --size_;
+}
+
+void StreamReactor::MessageQueue::erase(size_t i) {
+    for (; i + 1 < size_; ++i) {
+        (*this)[i] = std::move((*this)[i + 1]);
+    }
+    (*this)[size_ - 1] = OutMessage();
+    --size_;
+}
+
+void StreamReactor::MessageQueue::clear() {
+    while (size_ > 0) {
+        pop_front();
+    }
+    head_ = 0;
+}
@@ -0,0 +1,447 @@
+/**
+ * @file tensor_kernels.cpp
+ * @brief 张量内核实现
+ * @details 每个输出行只需两条源行：源行先解码为三个浮点平面并在水平方向缩放到输出宽度(每条源行至多处理一次)，
+ *          再做垂直插值并归一化写入张量。颜色转换和垂直插值两段有SIMD实现，水平缩放为按列取样，保持标量；
+ *          实现由KernelDispatch在运行时选择
+ */
+
+#include "tensor_kernels.h"
+#include <linux/videodev2.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(KERNEL_DISPATCH_X86)
+#include <immintrin.h>
+#elif defined(KERNEL_DISPATCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// BT.601有限范围YUV→RGB系数，与OpenCV的COLOR_YUV2BGR_YUYV/COLOR_YUV2BGR_NV12一致
+constexpr float kCy = 1.164f;
+constexpr float kCub = 2.018f;
+constexpr float kCug = -0.391f;
+constexpr float kCvg = -0.813f;
+constexpr float kCvr = 1.596f;
+
+/**
+ * @struct RowOps
+ * @brief 一种指令集实现的行运算
+ */
+struct RowOps {
+    /// y/u/v为原始分量值(0-255)，输出裁剪到[0,255]的B、G、R
+    void (*yuv_to_bgr)(const float* y, const float* u, const float* v,
+                       float* b, float* g, float* r, int n);
+    /// dst[i] = a[i] * wa + b[i] * wb
+    void (*blend)(const float* a, const float* b, float wa, float wb, float* dst, int n);
+};
+
+inline float clamp255(float x) {
+    return std::min(std::max(x, 0.0f), 255.0f);
+}
+
+void yuvToBgrScalar(const float* y, const float* u, const float* v, float* b, float* g, float* r, int n) {
+    for (int i = 0; i < n; ++i) {
+        float yy = std::max(y[i] - 16.0f, 0.0f) * kCy;
+        float uu = u[i] - 128.0f;
+        float vv = v[i] - 128.0f;
+        b[i] = clamp255(yy + kCub * uu);
+        g[i] = clamp255(yy + kCug * uu + kCvg * vv);
+        r[i] = clamp255(yy + kCvr * vv);
+    }
+}
+
+void blendScalar(const float* a, const float* b, float wa, float wb, float* dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = a[i] * wa + b[i] * wb;
+    }
+}
+
+#if defined(KERNEL_DISPATCH_X86)
+
+__attribute__((target("sse4.1")))
+void yuvToBgrSse4(const float* y, const float* u, const float* v, float* b, float* g, float* r, int n) {
+    const __m128 c16 = _mm_set1_ps(16.0f), c128 = _mm_set1_ps(128.0f);
+    const __m128 zero = _mm_setzero_ps(), max = _mm_set1_ps(255.0f);
+    const __m128 cy = _mm_set1_ps(kCy), cub = _mm_set1_ps(kCub), cug = _mm_set1_ps(kCug);
+    const __m128 cvg = _mm_set1_ps(kCvg), cvr = _mm_set1_ps(kCvr);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 yy = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(y + i), c16), zero), cy);
+        __m128 uu = _mm_sub_ps(_mm_loadu_ps(u + i), c128);
+        __m128 vv = _mm_sub_ps(_mm_loadu_ps(v + i), c128);
+        __m128 bb = _mm_add_ps(yy, _mm_mul_ps(cub, uu));
+        __m128 gg = _mm_add_ps(_mm_add_ps(yy, _mm_mul_ps(cug, uu)), _mm_mul_ps(cvg, vv));
+        __m128 rr = _mm_add_ps(yy, _mm_mul_ps(cvr, vv));
+        _mm_storeu_ps(b + i, _mm_min_ps(_mm_max_ps(bb, zero), max));
+        _mm_storeu_ps(g + i, _mm_min_ps(_mm_max_ps(gg, zero), max));
+        _mm_storeu_ps(r + i, _mm_min_ps(_mm_max_ps(rr, zero), max));
+    }
+    yuvToBgrScalar(y + i, u + i, v + i, b + i, g + i, r + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void blendSse4(const float* a, const float* b, float wa, float wb, float* dst, int n) {
+    const __m128 va = _mm_set1_ps(wa), vb = _mm_set1_ps(wb);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(a + i), va);
+        _mm_storeu_ps(dst + i, _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + i), vb)));
+    }
+    blendScalar(a + i, b + i, wa, wb, dst + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+void yuvToBgrAvx2(const float* y, const float* u, const float* v, float* b, float* g, float* r, int n) {
+    const __m256 c16 = _mm256_set1_ps(16.0f), c128 = _mm256_set1_ps(128.0f);
+    const __m256 zero = _mm256_setzero_ps(), max = _mm256_set1_ps(255.0f);
+    const __m256 cy = _mm256_set1_ps(kCy), cub = _mm256_set1_ps(kCub), cug = _mm256_set1_ps(kCug);
+    const __m256 cvg = _mm256_set1_ps(kCvg), cvr = _mm256_set1_ps(kCvr);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 yy = _mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(y + i), c16), zero), cy);
+        __m256 uu = _mm256_sub_ps(_mm256_loadu_ps(u + i), c128);
+        __m256 vv = _mm256_sub_ps(_mm256_loadu_ps(v + i), c128);
+        __m256 bb = _mm256_fmadd_ps(cub, uu, yy);
+        __m256 gg = _mm256_fmadd_ps(cvg, vv, _mm256_fmadd_ps(cug, uu, yy));
+        __m256 rr = _mm256_fmadd_ps(cvr, vv, yy);
+        _mm256_storeu_ps(b + i, _mm256_min_ps(_mm256_max_ps(bb, zero), max));
+        _mm256_storeu_ps(g + i, _mm256_min_ps(_mm256_max_ps(gg, zero), max));
+        _mm256_storeu_ps(r + i, _mm256_min_ps(_mm256_max_ps(rr, zero), max));
+    }
+    yuvToBgrScalar(y + i, u + i, v + i, b + i, g + i, r + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+void blendAvx2(const float* a, const float* b, float wa, float wb, float* dst, int n) {
+    const __m256 va = _mm256_set1_ps(wa), vb = _mm256_set1_ps(wb);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(a + i), va);
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(b + i), vb, x));
+    }
+    blendScalar(a + i, b + i, wa, wb, dst + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,avx2,fma")))
+void yuvToBgrAvx512(const float* y, const float* u, const float* v, float* b, float* g, float* r, int n) {
+    const __m512 c16 = _mm512_set1_ps(16.0f), c128 = _mm512_set1_ps(128.0f);
+    const __m512 zero = _mm512_setzero_ps(), max = _mm512_set1_ps(255.0f);
+    const __m512 cy = _mm512_set1_ps(kCy), cub = _mm512_set1_ps(kCub), cug = _mm512_set1_ps(kCug);
+    const __m512 cvg = _mm512_set1_ps(kCvg), cvr = _mm512_set1_ps(kCvr);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 yy = _mm512_mul_ps(_mm512_max_ps(_mm512_sub_ps(_mm512_loadu_ps(y + i), c16), zero), cy);
+        __m512 uu = _mm512_sub_ps(_mm512_loadu_ps(u + i), c128);
+        __m512 vv = _mm512_sub_ps(_mm512_loadu_ps(v + i), c128);
+        __m512 bb = _mm512_fmadd_ps(cub, uu, yy);
+        __m512 gg = _mm512_fmadd_ps(cvg, vv, _mm512_fmadd_ps(cug, uu, yy));
+        __m512 rr = _mm512_fmadd_ps(cvr, vv, yy);
+        _mm512_storeu_ps(b + i, _mm512_min_ps(_mm512_max_ps(bb, zero), max));
+        _mm512_storeu_ps(g + i, _mm512_min_ps(_mm512_max_ps(gg, zero), max));
+        _mm512_storeu_ps(r + i, _mm512_min_ps(_mm512_max_ps(rr, zero), max));
+    }
+    yuvToBgrAvx2(y + i, u + i, v + i, b + i, g + i, r + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,avx2,fma")))
+void blendAvx512(const float* a, const float* b, float wa, float wb, float* dst, int n) {
+    const __m512 va = _mm512_set1_ps(wa), vb = _mm512_set1_ps(wb);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_mul_ps(_mm512_loadu_ps(a + i), va);
+        _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(_mm512_loadu_ps(b + i), vb, x));
+    }
+    blendAvx2(a + i, b + i, wa, wb, dst + i, n - i);
+}
+
+#elif defined(KERNEL_DISPATCH_NEON)
+
+void yuvToBgrNeon(const float* y, const float* u, const float* v, float* b, float* g, float* r, int n) {
+    const float32x4_t c16 = vdupq_n_f32(16.0f), c128 = vdupq_n_f32(128.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f), max = vdupq_n_f32(255.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t yy = vmulq_n_f32(vmaxq_f32(vsubq_f32(vld1q_f32(y + i), c16), zero), kCy);
+        float32x4_t uu = vsubq_f32(vld1q_f32(u + i), c128);
+        float32x4_t vv = vsubq_f32(vld1q_f32(v + i), c128);
+        float32x4_t bb = vmlaq_n_f32(yy, uu, kCub);
+        float32x4_t gg = vmlaq_n_f32(vmlaq_n_f32(yy, uu, kCug), vv, kCvg);
+        float32x4_t rr = vmlaq_n_f32(yy, vv, kCvr);
+        vst1q_f32(b + i, vminq_f32(vmaxq_f32(bb, zero), max));
+        vst1q_f32(g + i, vminq_f32(vmaxq_f32(gg, zero), max));
+        vst1q_f32(r + i, vminq_f32(vmaxq_f32(rr, zero), max));
+    }
+    yuvToBgrScalar(y + i, u + i, v + i, b + i, g + i, r + i, n - i);
+}
+
+void blendNeon(const float* a, const float* b, float wa, float wb, float* dst, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vmulq_n_f32(vld1q_f32(a + i), wa);
+        vst1q_f32(dst + i, vmlaq_n_f32(x, vld1q_f32(b + i), wb));
+    }
+    blendScalar(a + i, b + i, wa, wb, dst + i, n - i);
+}
+
+#endif
+
+RowOps rowOps(KernelIsa isa) {
+    switch (isa) {
+#if defined(KERNEL_DISPATCH_X86)
+    case KernelIsa::kSse4: return {yuvToBgrSse4, blendSse4};
+    case KernelIsa::kAvx2: return {yuvToBgrAvx2, blendAvx2};
+    case KernelIsa::kAvx512: return {yuvToBgrAvx512, blendAvx512};
+#elif defined(KERNEL_DISPATCH_NEON)
+    case KernelIsa::kNeon: return {yuvToBgrNeon, blendNeon};
+#endif
+    default: return {yuvToBgrScalar, blendScalar};
+    }
+}
+
+/**
+ * @struct Tap
+ * @brief 一个输出坐标的双线性取样位置
+ */
+struct Tap {
+    int i0;     ///< 左(上)侧源坐标
+    int i1;     ///< 右(下)侧源坐标
+    float w1;   ///< i1的权重
+};
+
+/**
+ * @brief 计算取样位置，与cv::resize(INTER_LINEAR)相同：像素中心对齐，越界时贴边
+ */
+void planTaps(int src, int dst, Tap* taps) {
+    const double scale = static_cast<double>(src) / dst;
+    for (int d = 0; d < dst; ++d) {
+        float f = static_cast<float>((d + 0.5) * scale - 0.5);
+        int i = static_cast<int>(std::floor(f));
+        f -= i;
+        if (i < 0) {
+            i = 0;
+            f = 0.0f;
+        }
+        if (i >= src - 1) {
+            i = src - 1;
+            f = 0.0f;
+        }
+        taps[d] = {i, std::min(i + 1, src - 1), f};
+    }
+}
+
+/**
+ * @struct RowScratch
+ * @brief 行解码的临时缓冲
+ */
+struct RowScratch {
+    std::vector<float> y, u, v;     ///< YUV分量
+    std::vector<float> b, g, r;     ///< 解码后的BGR平面
+};
+
+/**
+ * @struct ConvertBuffers
+ * @brief 区域转换的工作缓冲
+ * @details 每个线程一份，只增不减，稳态下转换不再分配内存
+ */
+struct ConvertBuffers {
+    std::vector<Tap> xtaps, ytaps;  ///< 水平、垂直方向的插值表
+    RowScratch scratch;             ///< 行解码缓冲
+    std::vector<float> cache;       ///< 两条已做水平缩放的源行
+
+    /**
+     * @brief 保证缓冲至少容纳指定元素数
+     */
+    template <typename T>
+    static T* reserve(std::vector<T>& buffer, size_t size) {
+        if (buffer.size() < size) buffer.resize(size);
+        return buffer.data();
+    }
+};
+
+/**
+ * @brief 将源图像第row行的[x, x + width)解码为BGR浮点平面
+ */
+template <TensorFormat Format>
+void decodeRow(const TensorSource& source, int row, int x, int width, RowScratch& s, const RowOps& ops);
+
+template <>
+void decodeRow<TensorFormat::kBGR>(const TensorSource& source, int row, int x, int width,
+                                   RowScratch& s, const RowOps&) {
+    const uint8_t* p = source.data + row * source.stride + x * 3;
+    for (int i = 0; i < width; ++i, p += 3) {
+        s.b[i] = p[0];
+        s.g[i] = p[1];
+        s.r[i] = p[2];
+    }
+}
+
+template <>
+void decodeRow<TensorFormat::kYUYV>(const TensorSource& source, int row, int x, int width,
+                                    RowScratch& s, const RowOps& ops) {
+    // 每两个像素(Y0 U Y1 V)共享一组色度，与OpenCV一样不做色度插值
+    const uint8_t* line = source.data + row * source.stride;
+    for (int i = 0; i < width; ++i) {
+        int px = x + i;
+        const uint8_t* pair = line + (px & ~1) * 2;
+        s.y[i] = line[px * 2];
+        s.u[i] = pair[1];
+        s.v[i] = pair[3];
+    }
+    ops.yuv_to_bgr(s.y.data(), s.u.data(), s.v.data(), s.b.data(), s.g.data(), s.r.data(), width);
+}
+
+template <>
+void decodeRow<TensorFormat::kNV12>(const TensorSource& source, int row, int x, int width,
+                                    RowScratch& s, const RowOps& ops) {
+    // 每2×2个像素共享一组色度
+    const uint8_t* luma = source.data + row * source.stride;
+    const uint8_t* chroma = source.uv + (row / 2) * source.uv_stride;
+    for (int i = 0; i < width; ++i) {
+        int px = x + i;
+        const uint8_t* uv = chroma + (px & ~1);
+        s.y[i] = luma[px];
+        s.u[i] = uv[0];
+        s.v[i] = uv[1];
+    }
+    ops.yuv_to_bgr(s.y.data(), s.u.data(), s.v.data(), s.b.data(), s.g.data(), s.r.data(), width);
+}
+
+/**
+ * @brief 转换一个区域
+ * @tparam Format 源格式
+ * @tparam W 编译期输出宽度，0表示使用运行时的out_w
+ * @tparam H 编译期输出高度，0表示使用运行时的out_h
+ */
+template <TensorFormat Format, int W, int H>
+void convertRegion(const TensorSource& source, const cv::Rect& region, int out_w, int out_h,
+                   float* dst, const RowOps& ops) {
+    const int width = W > 0 ? W : out_w;
+    const int height = H > 0 ? H : out_h;
+    const size_t plane = static_cast<size_t>(width) * height;
+
+    thread_local ConvertBuffers buffers;
+    Tap* xtaps = ConvertBuffers::reserve(buffers.xtaps, width);
+    Tap* ytaps = ConvertBuffers::reserve(buffers.ytaps, height);
+    planTaps(region.width, width, xtaps);
+    planTaps(region.height, height, ytaps);
+
+    RowScratch& scratch = buffers.scratch;
+    for (auto* buffer : {&scratch.y, &scratch.u, &scratch.v, &scratch.b, &scratch.g, &scratch.r}) {
+        ConvertBuffers::reserve(*buffer, region.width);
+    }
+
+    // 两条已做水平缩放的源行，每条为B、G、R三个输出宽度的平面
+    float* cache = ConvertBuffers::reserve(buffers.cache, static_cast<size_t>(width) * 6);
+    float* rows[2] = {cache, cache + width * 3};
+    int cached[2] = {-1, -1};
+
+    auto fetch = [&](int sy, int keep) -> const float* {
+        for (int k = 0; k < 2; ++k) {
+            if (cached[k] == sy) return rows[k];
+        }
+        int slot = cached[0] == keep ? 1 : 0;
+        decodeRow<Format>(source, region.y + sy, region.x, region.width, scratch, ops);
+        const float* planes[3] = {scratch.b.data(), scratch.g.data(), scratch.r.data()};
+        for (int c = 0; c < 3; ++c) {
+            const float* in = planes[c];
+            float* out = rows[slot] + c * width;
+            for (int dx = 0; dx < width; ++dx) {
+                const Tap& t = xtaps[dx];
+                out[dx] = in[t.i0] + (in[t.i1] - in[t.i0]) * t.w1;
+            }
+        }
+        cached[slot] = sy;
+        return rows[slot];
+    };
+
+    constexpr float kNorm = 1.0f / 255.0f;
+    for (int dy = 0; dy < height; ++dy) {
+        const Tap& t = ytaps[dy];
+        const float* top = fetch(t.i0, t.i1);
+        const float* bottom = fetch(t.i1, t.i0);
+        const float w_top = (1.0f - t.w1) * kNorm;
+        const float w_bottom = t.w1 * kNorm;
+        for (int c = 0; c < 3; ++c) {
+            ops.blend(top + c * width, bottom + c * width, w_top, w_bottom,
+                      dst + c * plane + static_cast<size_t>(dy) * width, width);
+        }
+    }
+}
+
+using ConvertFn = void (*)(const TensorSource&, const cv::Rect&, int, int, float*, const RowOps&);
+
+/**
+ * @brief 按目标尺寸选择特化版本，常用的正方形模型输入使用编译期尺寸
+ */
+template <TensorFormat Format>
+ConvertFn selectSize(const cv::Size& size) {
+    if (size.width == size.height) {
+        switch (size.width) {
+        case 320: return convertRegion<Format, 320, 320>;
+        case 416: return convertRegion<Format, 416, 416>;
+        case 512: return convertRegion<Format, 512, 512>;
+        case 640: return convertRegion<Format, 640, 640>;
+        default: break;
+        }
+    }
+    return convertRegion<Format, 0, 0>;
+}
+
+} // namespace
+
+TensorSource TensorSource::fromBgr(const cv::Mat& image) {
+    TensorSource source;
+    if (image.empty() || image.type() != CV_8UC3) return source;
+    source.format = TensorFormat::kBGR;
+    source.data = image.data;
+    source.stride = image.step;
+    source.width = image.cols;
+    source.height = image.rows;
+    return source;
+}
+
+TensorSource TensorSource::fromRaw(const RawFrame& raw) {
+    TensorSource source;
+    switch (raw.pixel_format) {
+    case V4L2_PIX_FMT_YUYV:
+        source.format = TensorFormat::kYUYV;
+        break;
+    case V4L2_PIX_FMT_NV12:
+        // 单平面NV12：UV平面紧跟在Y平面之后
+        source.format = TensorFormat::kNV12;
+        source.uv = raw.data + raw.bytes_per_line * raw.height;
+        source.uv_stride = raw.bytes_per_line;
+        break;
+    default:
+        return source;
+    }
+    source.data = raw.data;
+    source.stride = raw.bytes_per_line;
+    source.width = raw.width;
+    source.height = raw.height;
+    return source;
+}
+
+bool TensorKernels::convert(const TensorSource& source, const cv::Rect& region, const cv::Size& size,
+                            float* dst, KernelIsa isa) {
+    if (source.empty() || !dst || size.width <= 0 || size.height <= 0) return false;
+    if (region.width <= 0 || region.height <= 0 || region.x < 0 || region.y < 0
+        || region.x + region.width > source.width || region.y + region.height > source.height) {
+        return false;
+    }
+    if (source.format == TensorFormat::kNV12 && !source.uv) return false;
+
+    ConvertFn fn = nullptr;
+    switch (source.format) {
+    case TensorFormat::kBGR: fn = selectSize<TensorFormat::kBGR>(size); break;
+    case TensorFormat::kYUYV: fn = selectSize<TensorFormat::kYUYV>(size); break;
+    case TensorFormat::kNV12: fn = selectSize<TensorFormat::kNV12>(size); break;
+    }
+    fn(source, region, size.width, size.height, dst,
+       rowOps(KernelDispatch::supported(isa) ? isa : KernelIsa::kScalar));
+    return true;
+}
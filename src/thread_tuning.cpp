@@ -0,0 +1,126 @@
+/**
+ * @file thread_tuning.cpp
+ * @brief 流水线线程调度策略实现
+ */
+
+#include "thread_tuning.h"
+#include "alloc_stats.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+std::mutex g_mutex;                   ///< 保护调度配置
+SchedulingOptions g_options;          ///< 当前调度配置
+
+} // namespace
+
+ThreadPolicy ThreadPolicy::fromJson(const Poco::JSON::Object::Ptr& json) {
+    ThreadPolicy policy;
+    if (json.isNull()) return policy;
+
+    auto cpus = json->getArray("cpus");
+    if (!cpus.isNull()) {
+        for (size_t i = 0; i < cpus->size(); ++i) {
+            int cpu = cpus->getElement<int>(static_cast<unsigned>(i));
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                policy.cpus.push_back(cpu);
+            }
+        }
+    }
+    policy.realtime_priority = std::clamp(json->optValue<int>("realtime_priority", 0), 0, 99);
+    policy.nice = std::clamp(json->optValue<int>("nice", 0), -20, 19);
+    return policy;
+}
+
+SchedulingOptions SchedulingOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    SchedulingOptions options;
+    if (json.isNull()) return options;
+
+    for (const auto& name : json->getNames()) {
+        auto group = json->getObject(name);
+        if (!group.isNull()) {
+            options.groups[name] = ThreadPolicy::fromJson(group);
+        }
+    }
+    return options;
+}
+
+void ThreadTuning::configure(SchedulingOptions options) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_options = std::move(options);
+}
+
+bool ThreadTuning::apply(const char* group, const char* name) {
+    // 线程名上限16字节(含结尾0)
+    char short_name[16];
+    snprintf(short_name, sizeof(short_name), "%s", name);
+    pthread_setname_np(pthread_self(), short_name);
+#ifdef USE_ALLOC_STATS
+    AllocStats::setThreadGroup(group);
+#endif
+
+    ThreadPolicy policy;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_options.groups.find(group);
+        if (it == g_options.groups.end()) return true;
+        policy = it->second;
+    }
+
+    bool ok = true;
+    if (!policy.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : policy.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (ret != 0) {
+            std::cerr << "线程" << short_name << "设置CPU亲和性失败: " << strerror(ret) << std::endl;
+            ok = false;
+        }
+    }
+
+    bool realtime = false;
+    if (policy.realtime_priority > 0) {
+        sched_param param{};
+        param.sched_priority = policy.realtime_priority;
+        int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (ret == 0) {
+            realtime = true;
+        } else {
+            // 需要CAP_SYS_NICE或足够的RLIMIT_RTPRIO，否则退回普通调度
+            std::cerr << "线程" << short_name << "设置实时优先级失败: " << strerror(ret)
+                      << "，使用普通调度" << std::endl;
+            ok = false;
+        }
+    }
+
+    // nice值只对普通调度生效，Linux下按线程设置
+    if (!realtime && policy.nice != 0) {
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), policy.nice) != 0) {
+            std::cerr << "线程" << short_name << "设置nice值失败: " << strerror(errno) << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void ThreadTuning::applyOnce(const char* group, const char* name) {
+    thread_local bool applied = false;
+    if (!applied) {
+        applied = true;
+        apply(group, name);
+    }
+}
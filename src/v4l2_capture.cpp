@@ -5,15 +5,164 @@
  */
 
 #include "v4l2_capture.h"
+#include "color_kernels.h"
 #include <fcntl.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
 
-V4L2Capture::V4L2Capture() = default;
+namespace {
+
+/// 帧缓冲池槽位数：最新帧、各下游级信箱和正在处理的帧，其余覆盖各连接写队列中的在途帧
+constexpr size_t kPoolSlots = 24;
+
+/// 至少保留在驱动中的空闲缓冲数，低于该值时帧不携带原始图像，缓冲立即归还
+constexpr int kMinQueuedBuffers = 1;
+
+/// 每个驱动缓冲为原始图像引用的shared_ptr控制块预留的空间
+constexpr size_t kControlBlockSize = 128;
+
+} // namespace
+
+/**
+ * @struct V4L2Capture::BufferQueue
+ * @brief 驱动缓冲队列
+ * @details 持有设备描述符和所有缓冲。原始图像引用通过shared_ptr共享本对象，
+ *          捕获停止后仍被引用的缓冲保持有效，最后一个引用释放时才解除映射并关闭设备
+ */
+struct V4L2Capture::BufferQueue {
+    /**
+     * @struct Buffer
+     * @brief 单个驱动缓冲
+     */
+    struct Buffer {
+        void* start{nullptr};       ///< 缓冲起始地址
+        size_t length{0};           ///< 缓冲长度
+        int dmabuf_fd{-1};          ///< 导出的DMABUF描述符
+        RawFrame raw;               ///< 出借给下游的原始图像描述
+        alignas(std::max_align_t) unsigned char control[kControlBlockSize]; ///< 原始图像引用的控制块存储
+    };
+
+    /**
+     * @class ControlAllocator
+     * @brief 把原始图像引用的控制块放进缓冲自带存储的分配器
+     * @details 缓冲出借期间只有一个引用计数组，存储不会重入；分配器持有队列，
+     *          控制块释放完毕之后队列才可能随最后一个引用销毁
+     */
+    template <typename T>
+    class ControlAllocator {
+    public:
+        using value_type = T;
+
+        ControlAllocator(std::shared_ptr<BufferQueue> owner, uint32_t index)
+            : owner_(std::move(owner)), index_(index) {}
+
+        template <typename U>
+        ControlAllocator(const ControlAllocator<U>& other) : owner_(other.owner_), index_(other.index_) {}
+
+        T* allocate(size_t n) {
+            static_assert(sizeof(T) <= kControlBlockSize, "控制块超出缓冲预留空间");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "控制块对齐要求过高");
+            if (n != 1) throw std::bad_alloc();
+            return reinterpret_cast<T*>(owner_->buffers[index_].control);
+        }
+
+        void deallocate(T*, size_t) {}
+
+        template <typename U>
+        bool operator==(const ControlAllocator<U>& other) const {
+            return owner_ == other.owner_ && index_ == other.index_;
+        }
+
+        template <typename U>
+        bool operator!=(const ControlAllocator<U>& other) const { return !(*this == other); }
+
+    private:
+        template <typename U> friend class ControlAllocator;
+
+        std::shared_ptr<BufferQueue> owner_;    ///< 所属缓冲队列
+        uint32_t index_;                        ///< 缓冲序号
+    };
+
+    int fd{-1};                                 ///< 设备描述符
+    uint32_t memory{V4L2_MEMORY_MMAP};          ///< 缓冲方式
+    std::vector<Buffer> buffers;                ///< 驱动缓冲
+    std::atomic<int> queued{0};                 ///< 在驱动中排队的缓冲数
+    std::atomic<bool> streaming{false};         ///< 是否正在采集
+
+    /**
+     * @brief 缓冲入队，可在任意线程调用
+     */
+    bool enqueue(uint32_t index) {
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = memory;
+        buf.index = index;
+        if (memory == V4L2_MEMORY_USERPTR) {
+            buf.m.userptr = reinterpret_cast<unsigned long>(buffers[index].start);
+            buf.length = static_cast<uint32_t>(buffers[index].length);
+        }
+        if (ioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+            std::cerr << "缓冲区入队失败: " << strerror(errno) << std::endl;
+            return false;
+        }
+        ++queued;
+        return true;
+    }
+
+    /**
+     * @brief 停止采集，驱动不再写入任何缓冲
+     */
+    void streamOff() {
+        if (streaming.exchange(false)) {
+            enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            ioctl(fd, VIDIOC_STREAMOFF, &type);
+        }
+    }
+
+    ~BufferQueue() {
+        streamOff();
+        for (auto& buffer : buffers) {
+            if (buffer.dmabuf_fd >= 0) close(buffer.dmabuf_fd);
+            if (!buffer.start) continue;
+            if (memory == V4L2_MEMORY_MMAP) {
+                munmap(buffer.start, buffer.length);
+            } else {
+                free(buffer.start);
+            }
+        }
+        if (fd >= 0) close(fd);
+    }
+};
+
+CaptureOptions CaptureOptions::fromJson(const Poco::JSON::Object::Ptr& json) {
+    CaptureOptions options;
+    if (json.isNull()) return options;
+
+    std::string memory = json->optValue<std::string>("memory", options.memory);
+    if (memory == "mmap" || memory == "userptr") {
+        options.memory = memory;
+    } else {
+        std::cerr << "未知的缓冲方式: " << memory << "，使用mmap" << std::endl;
+    }
+    options.buffers = std::clamp(json->optValue<int>("buffers", options.buffers), 2, 32);
+    options.export_dmabuf = json->optValue<bool>("export_dmabuf", options.export_dmabuf);
+    return options;
+}
+
+V4L2Capture::V4L2Capture(std::shared_ptr<RuntimeConfigStore> config, CaptureOptions options)
+    : options_(std::move(options))
+    , config_(config ? std::move(config) : std::make_shared<RuntimeConfigStore>()) {}
 
 V4L2Capture::~V4L2Capture() {
     stop();
@@ -28,46 +177,82 @@ bool V4L2Capture::start(int device_id) {
 
     // 启动视频流
     running_ = true;
-    capture_thread_ = std::thread(&V4L2Capture::captureLoop, this);
+    executor_ = std::make_unique<CoroExecutor>(ExecutorOptions{"capture", "capture", 1});
+    executor_->start();
+    executor_->spawn(captureTask());
     return true;
 }
 
 void V4L2Capture::stop() {
-    // 停止捕获线程
+    // 停止捕获任务：执行器取消对设备描述符的等待，任务随之退出
     if (running_) {
         running_ = false;
-        if (capture_thread_.joinable()) {
-            capture_thread_.join();
-        }
+        executor_->stop();
+        executor_.reset();
+        fanout_.closeAll();
     }
 
-    // 释放设备资源
-    if (buffer_) {
-        munmap(buffer_, buffer_size_);
-        buffer_ = nullptr;
+    // 停止采集；仍被下游引用的缓冲在最后一个引用释放后随队列一起释放。
+    // stats()可能在其他线程同时读取，队列指针只以原子操作替换
+    if (auto queue = std::atomic_exchange(&queue_, std::shared_ptr<BufferQueue>())) {
+        queue->streamOff();
     }
+}
+
+std::string V4L2Capture::getLatestFrame() {
+    auto frame = getLatestEncodedFrame();
+    return frame ? std::string(frame->jpeg.begin(), frame->jpeg.end()) : std::string();
+}
+
+EncodedFramePtr V4L2Capture::getLatestEncodedFrame() {
+    return std::atomic_load(&latest_frame_);
+}
 
-    if (fd_ >= 0) {
-        close(fd_);
-        fd_ = -1;
+CaptureStats V4L2Capture::stats() const {
+    CaptureStats s;
+    s.frames_published = sequence_.load(std::memory_order_relaxed);
+    if (auto frame_pool = std::atomic_load(&pool_)) {
+        auto pool = frame_pool->stats();
+        s.pool_capacity = pool.capacity;
+        s.pool_in_use = pool.in_use;
+        s.pool_exhausted = pool.exhausted;
     }
+    s.dequeue_latency = dequeue_latency_.snapshot();
+    s.late_dequeues = late_dequeues_.load(std::memory_order_relaxed);
+    s.publish_latency = publish_latency_.snapshot();
+    s.driver_drops = driver_drops_.load(std::memory_order_relaxed);
+    if (auto queue = std::atomic_load(&queue_)) {
+        s.buffers = queue->buffers.size();
+        int held = static_cast<int>(queue->buffers.size()) - queue->queued.load(std::memory_order_relaxed);
+        s.buffers_held = static_cast<size_t>(std::max(held, 0));
+    }
+    s.raw_fallbacks = raw_fallbacks_.load(std::memory_order_relaxed);
+    s.stages = fanout_.stats();
+    return s;
 }
 
-std::string V4L2Capture::getLatestFrame() {
-    std::lock_guard<std::mutex> lock(frame_mutex_);
-    return latest_frame_;
+std::shared_ptr<FrameMailbox> V4L2Capture::subscribe(const std::string& stage,
+                                                     const MailboxOptions& defaults) {
+    return fanout_.subscribe(stage, defaults);
+}
+
+void V4L2Capture::setPipelineOptions(PipelineOptions options) {
+    fanout_.configure(std::move(options));
 }
 
 bool V4L2Capture::initDevice(int device_id) {
     char dev_name[64];
     snprintf(dev_name, sizeof(dev_name), "/dev/video%d", device_id);
     
-    // 打开设备
-    fd_ = open(dev_name, O_RDWR);
-    if (fd_ < 0) {
+    // 打开设备；非阻塞方式，取帧前等待描述符可读。
+    // 队列在本地完整建立后才发布，stats()不会看到初始化到一半的队列；失败时随局部引用释放
+    auto queue = std::make_shared<BufferQueue>();
+    queue->fd = open(dev_name, O_RDWR | O_NONBLOCK);
+    if (queue->fd < 0) {
         std::cerr << "无法打开设备: " << dev_name << std::endl;
         return false;
     }
+    int fd = queue->fd;
 
     // 设置视频格式
     struct v4l2_format fmt = {};
@@ -76,91 +261,233 @@ bool V4L2Capture::initDevice(int device_id) {
     fmt.fmt.pix.height = 480;        // 设置捕获高度
     fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;  // 使用YUYV格式
     
-    if (ioctl(fd_, VIDIOC_S_FMT, &fmt) < 0) {
+    if (ioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
         std::cerr << "设置视频格式失败" << std::endl;
         return false;
     }
 
-    // 请求缓冲区
-    struct v4l2_requestbuffers req = {};
-    req.count = 1;  // 请求一个缓冲区
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    
-    if (ioctl(fd_, VIDIOC_REQBUFS, &req) < 0) {
-        std::cerr << "请求缓冲区失败" << std::endl;
-        return false;
-    }
+    // 驱动可能调整分辨率，缓冲池按实际协商的格式分配；
+    // JPEG缓冲按每像素1字节预留，足以容纳常用质量下的编码结果
+    width_ = fmt.fmt.pix.width;
+    height_ = fmt.fmt.pix.height;
+    bytes_per_line_ = std::max<size_t>(fmt.fmt.pix.bytesperline, width_ * 2);
+    std::atomic_store(&pool_, FramePool::create(kPoolSlots, width_, height_, static_cast<size_t>(width_) * height_));
 
-    // 查询并映射缓冲区
-    buf_.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf_.memory = V4L2_MEMORY_MMAP;
-    buf_.index = 0;
-    
-    if (ioctl(fd_, VIDIOC_QUERYBUF, &buf_) < 0) {
-        std::cerr << "查询缓冲区失败" << std::endl;
-        return false;
+    // 请求缓冲区：USERPTR不被驱动支持时退回MMAP
+    size_t size_image = std::max<size_t>(fmt.fmt.pix.sizeimage, bytes_per_line_ * height_);
+    bool ok = false;
+    if (options_.memory == "userptr") {
+        ok = requestBuffers(*queue, V4L2_MEMORY_USERPTR, size_image);
+        if (!ok) {
+            std::cerr << "驱动不支持USERPTR缓冲，改用MMAP" << std::endl;
+        }
     }
-
-    // 内存映射
-    buffer_ = mmap(nullptr, buf_.length, PROT_READ | PROT_WRITE,
-                  MAP_SHARED, fd_, buf_.m.offset);
-    buffer_size_ = buf_.length;
-    
-    if (buffer_ == MAP_FAILED) {
-        std::cerr << "内存映射失败" << std::endl;
+    if (!ok && !requestBuffers(*queue, V4L2_MEMORY_MMAP, size_image)) {
         return false;
     }
 
-    // 将缓冲区加入队列
-    if (ioctl(fd_, VIDIOC_QBUF, &buf_) < 0) {
-        std::cerr << "缓冲区入队失败" << std::endl;
-        return false;
+    // 将所有缓冲区加入队列
+    for (uint32_t i = 0; i < queue->buffers.size(); ++i) {
+        if (!queue->enqueue(i)) {
+            return false;
+        }
     }
 
     // 开启视频流
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
+    if (ioctl(fd, VIDIOC_STREAMON, &type) < 0) {
         std::cerr << "启动视频流失败" << std::endl;
         return false;
     }
+    queue->streaming = true;
+
+    std::atomic_store(&queue_, queue);
+    return true;
+}
+
+bool V4L2Capture::requestBuffers(BufferQueue& queue, uint32_t memory, size_t size_image) {
+    int fd = queue.fd;
+    struct v4l2_requestbuffers req = {};
+    req.count = static_cast<uint32_t>(options_.buffers);
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = memory;
+    
+    // 驱动可能调整缓冲数
+    if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+        if (memory == V4L2_MEMORY_MMAP) {
+            std::cerr << "请求缓冲区失败" << std::endl;
+        }
+        return false;
+    }
+    queue.memory = memory;
+    queue.buffers.assign(req.count, BufferQueue::Buffer());
+
+    for (uint32_t i = 0; i < req.count; ++i) {
+        auto& buffer = queue.buffers[i];
+        if (memory == V4L2_MEMORY_USERPTR) {
+            // 驱动直接写入本程序分配的页对齐缓冲
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            buffer.length = (size_image + page - 1) / page * page;
+            buffer.start = aligned_alloc(page, buffer.length);
+            if (!buffer.start) {
+                std::cerr << "分配USERPTR缓冲失败" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        // 查询并映射缓冲区
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            std::cerr << "查询缓冲区失败" << std::endl;
+            return false;
+        }
+        void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            std::cerr << "内存映射失败" << std::endl;
+            return false;
+        }
+        buffer.start = start;
+        buffer.length = buf.length;
 
+        // 导出DMABUF，供其他级或进程(如硬件编码器、GPU)直接引用同一块内存
+        if (options_.export_dmabuf) {
+            struct v4l2_exportbuffer exp = {};
+            exp.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            exp.index = i;
+            exp.flags = O_RDONLY | O_CLOEXEC;
+            if (ioctl(fd, VIDIOC_EXPBUF, &exp) == 0) {
+                buffer.dmabuf_fd = exp.fd;
+            } else {
+                std::cerr << "导出DMABUF失败: " << strerror(errno) << std::endl;
+            }
+        }
+    }
     return true;
 }
 
-void V4L2Capture::captureLoop() {
-    while (running_) {
+RawFramePtr V4L2Capture::holdBuffer(const v4l2_buffer& buf) {
+    // 驱动中至少保留kMinQueuedBuffers个空闲缓冲，否则慢速下游会让采集停顿
+    if (queue_->queued.load(std::memory_order_relaxed) < kMinQueuedBuffers) {
+        raw_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    auto& buffer = queue_->buffers[buf.index];
+    RawFrame& raw = buffer.raw;
+    raw.data = static_cast<const uint8_t*>(buffer.start);
+    raw.size = buf.bytesused;
+    raw.width = width_;
+    raw.height = height_;
+    raw.bytes_per_line = bytes_per_line_;
+    raw.pixel_format = V4L2_PIX_FMT_YUYV;
+    raw.dmabuf_fd = buffer.dmabuf_fd;
+    raw.index = buf.index;
+
+    // 最后一个引用释放时缓冲重新入队。描述和控制块都放在缓冲自带的存储里，出借时不分配内存；
+    // 分配器持有队列，停止采集后也能安全释放
+    BufferQueue* queue = queue_.get();
+    return RawFramePtr(&raw, [queue](const RawFrame* frame) {
+        if (queue->streaming) {
+            queue->enqueue(frame->index);
+        }
+    }, BufferQueue::ControlAllocator<RawFrame>(queue_, buf.index));
+}
+
+CoroTask<void> V4L2Capture::captureTask() {
+    RuntimeConfigReader config_reader(config_);
+    auto next_publish = std::chrono::steady_clock::now();
+
+    // 编码参数跨帧复用，JPEG直接编码到帧缓冲池槽位预留的缓冲
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 90};
+    uint32_t last_device_sequence = 0;
+    bool have_device_sequence = false;
+
+    BufferQueue& queue = *queue_;
+    for (;;) {
+        // 挂起到设备有新帧，执行器停止时等待被取消
+        uint32_t events = co_await executor_->ready(queue.fd, EPOLLIN);
+        if (events == 0) break;
+        if (events & EPOLLERR) {
+            // 所有缓冲都在下游手中时驱动报告POLLERR，稍后重试
+            bool fired = co_await executor_->sleepFor(std::chrono::milliseconds(1));
+            if (!fired) break;
+            continue;
+        }
+
         // 从队列中取出缓冲区
-        if (ioctl(fd_, VIDIOC_DQBUF, &buf_) < 0) {
-            std::cerr << "取出缓冲区失败" << std::endl;
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = queue.memory;
+        if (ioctl(queue.fd, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno != EAGAIN) {
+                std::cerr << "取出缓冲区失败: " << strerror(errno) << std::endl;
+            }
             continue;
         }
+        --queue.queued;
 
-        // 将YUYV格式转换为JPEG
-        cv::Mat yuyv_mat(480, 640, CV_8UC2, buffer_);
-        cv::Mat bgr_mat;
-        cv::cvtColor(yuyv_mat, bgr_mat, cv::COLOR_YUV2BGR_YUYV);
-        
-        std::vector<uchar> jpeg_buffer;
-        std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 90};
-        cv::imencode(".jpg", bgr_mat, jpeg_buffer, params);
+        // 驱动帧序号不连续说明驱动在没有空闲缓冲时丢了帧(按帧率跳过的帧也会出队，不计入)
+        if (have_device_sequence && buf.sequence != last_device_sequence + 1) {
+            driver_drops_.fetch_add(buf.sequence - last_device_sequence - 1, std::memory_order_relaxed);
+        }
+        last_device_sequence = buf.sequence;
+        have_device_sequence = true;
 
-        // 更新最新帧
-        {
-            std::lock_guard<std::mutex> lock(frame_mutex_);
-            latest_frame_ = std::string(
-                reinterpret_cast<char*>(jpeg_buffer.data()),
-                jpeg_buffer.size()
-            );
+        // 出队延迟：驱动以CLOCK_MONOTONIC(即steady_clock)记录帧完成时间，与取出时刻之差即捕获线程的调度延迟
+        const RuntimeConfig& config = config_reader.get();
+        auto interval = std::chrono::microseconds(1000000 / config.target_fps);
+        auto dequeued = std::chrono::steady_clock::now();
+        auto capture_time = dequeued;
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+            capture_time = std::chrono::steady_clock::time_point(
+                std::chrono::seconds(buf.timestamp.tv_sec) + std::chrono::microseconds(buf.timestamp.tv_usec));
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(dequeued - capture_time);
+            dequeue_latency_.record(latency.count());
+            if (latency > interval) {
+                late_dequeues_.fetch_add(1, std::memory_order_relaxed);
+            }
         }
 
-        // 将缓冲区重新加入队列
-        if (ioctl(fd_, VIDIOC_QBUF, &buf_) < 0) {
-            std::cerr << "缓冲区入队失败" << std::endl;
+        // 控制帧率：未到发布时间的帧直接归还驱动，不做转换和编码。
+        // 留出四分之一间隔的余量，避免帧到达时间的抖动导致误丢帧
+        if (dequeued + interval / 4 < next_publish) {
+            queue.enqueue(buf.index);
+            continue;
         }
+        next_publish = std::max(next_publish + interval, dequeued);
+
+        // 从缓冲池取帧，颜色转换直接写入池中预分配的图像
+        auto frame = pool_->acquire();
+        ColorKernels::yuyvToBgr(static_cast<const uint8_t*>(queue.buffers[buf.index].start), bytes_per_line_,
+                                frame->image.data, frame->image.step, width_, height_);
 
-        // 控制帧率
-        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        // 将BGR图像编码为JPEG
+        params[1] = config.jpeg_quality;
+        cv::imencode(".jpg", frame->image, frame->jpeg, params);
+
+        // 更新最新帧，并投递到各下游级的信箱
+        frame->width = frame->image.cols;
+        frame->height = frame->image.rows;
+        frame->capture_time = capture_time;
+        frame->device_sequence = buf.sequence;
+        // 原始图像随帧下发，最后一个引用释放时缓冲才归还驱动；空闲缓冲不足时立即归还
+        frame->raw = holdBuffer(buf);
+        if (!frame->raw) {
+            queue.enqueue(buf.index);
+        }
+        auto published_at = std::chrono::steady_clock::now();
+        frame->wall_time = std::chrono::system_clock::now()
+            - std::chrono::duration_cast<std::chrono::system_clock::duration>(published_at - capture_time);
+        frame->sequence = sequence_.fetch_add(1, std::memory_order_relaxed) + 1;
+        publish_latency_.record(
+            std::chrono::duration_cast<std::chrono::microseconds>(published_at - capture_time).count());
+        EncodedFramePtr published = std::move(frame);
+        std::atomic_store(&latest_frame_, published);
+        fanout_.publish(published);
     }
 }
 
@@ -1,31 +1,163 @@
 #include "web_server.h"
+#include "thread_tuning.h"
+#include "frame_mailbox.h"
+#include "kernel_dispatch.h"
+#include "alloc_stats.h"
 #include <Poco/Net/HTTPServerParams.h>
 #include <Poco/Net/ServerSocket.h>
 #include <Poco/Net/WebSocket.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
 #include <Poco/JSON/Object.h>
+#include <Poco/JSON/Array.h>
+#include <Poco/JSON/Parser.h>
+#include <Poco/URI.h>
+#include <Poco/DateTimeFormatter.h>
+#include <Poco/DateTimeFormat.h>
+#include <Poco/DateTimeParser.h>
+#include <Poco/NumberParser.h>
+#include <Poco/NumberFormatter.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
 #include <sstream>
 #include <iostream>
-#include <thread>
 #include <chrono>
+#include <unistd.h>
 
 using namespace Poco::Net;
-using namespace std::chrono_literals;
 
-WebServer::WebSocketHandler::WebSocketHandler(
-    std::shared_ptr<CaptureInterface> capture,
-    std::shared_ptr<ImageProcessor> processor)
-    : video_capture_(capture), processor_(processor) {}
+namespace {
+
+/**
+ * @brief 进程实例标识
+ * @details 帧序号在重启后从1开始，ETag中加入启动时间避免重启前后的缓存误判
+ */
+const std::string& instanceTag() {
+    static const std::string tag = Poco::NumberFormatter::formatHex(
+        static_cast<Poco::UInt64>(std::chrono::system_clock::now().time_since_epoch().count()));
+    return tag;
+}
+
+/**
+ * @brief 解析时间参数
+ * @param text Unix纪元毫秒数或ISO8601时间
+ * @param us 输出Unix纪元微秒数
+ */
+bool parseTime(const std::string& text, int64_t& us) {
+    Poco::Int64 ms;
+    if (Poco::NumberParser::tryParse64(text, ms)) {
+        us = ms * 1000;
+        return true;
+    }
+    Poco::DateTime time;
+    int tz;
+    if (Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::ISO8601_FORMAT, text, time, tz)) {
+        // 解析结果为带时区偏移的本地时间，换算为UTC
+        us = time.timestamp().epochMicroseconds() - static_cast<int64_t>(tz) * 1000000;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 解析消息格式名称(json/binary/h264)
+ */
+bool parseFormat(const std::string& text, WebServer::StreamFormat& format) {
+    if (text == "json") {
+        format = WebServer::kFormatJson;
+    } else if (text == "binary") {
+        format = WebServer::kFormatBinary;
+    } else if (text == "h264") {
+        format = WebServer::kFormatH264;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 解析分辨率档位名称(full/half/quarter)
+ */
+bool parseTier(const std::string& text, WebServer::StreamTier& tier) {
+    if (text == "full") {
+        tier = WebServer::kTierFull;
+    } else if (text == "half") {
+        tier = WebServer::kTierHalf;
+    } else if (text == "quarter") {
+        tier = WebServer::kTierQuarter;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 延迟统计转为JSON(微秒)
+ */
+Poco::JSON::Object latencyToJson(const LatencyHistogram::Snapshot& latency) {
+    Poco::JSON::Object json;
+    json.set("count", latency.count);
+    json.set("mean_us", latency.mean_us);
+    json.set("p50_us", latency.p50_us);
+    json.set("p99_us", latency.p99_us);
+    json.set("max_us", latency.max_us);
+    return json;
+}
+
+constexpr int kDefaultPageSize = 1000;     ///< 检测记录查询默认每页条数
+constexpr int kMaxPageSize = 10000;        ///< 检测记录查询每页条数上限
+constexpr int64_t kMaxHistogramBuckets = 10000;  ///< 直方图区间数上限
+constexpr size_t kTierPoolSlots = 16;       ///< 每个缩放档位的帧缓冲池槽位数，覆盖各连接写队列中的在途帧
+
+} // namespace
+
+WebServer::WebSocketHandler::WebSocketHandler(WebServer& owner)
+    : owner_(owner) {}
 
 void WebServer::WebSocketHandler::handleRequest(
     HTTPServerRequest& request, HTTPServerResponse& response) {
     
     if (request.find("Upgrade") != request.end() 
         && Poco::icompare(request["Upgrade"], "websocket") == 0) {
+        StreamFormat format = kFormatJson;
+        StreamTier tier = kTierFull;
+        for (const auto& param : Poco::URI(request.getURI()).getQueryParameters()) {
+            if (param.first == "format" && param.second == "binary") {
+                format = kFormatBinary;
+            } else if (param.first == "codec" && param.second == "h264") {
+                format = kFormatH264;
+            } else if (param.first == "tier") {
+                parseTier(param.second, tier);
+            }
+        }
+        // 未启用H.264时回退为二进制JPEG格式，客户端按首条消息的魔数区分
+        if (format == kFormatH264 && !owner_.h264_[tier]) {
+            format = kFormatBinary;
+        }
         WebSocket ws(request, response);
-        handleWebSocket(ws);
+        handleWebSocket(ws, format, tier);
     } else {
         // 处理普通HTTP请求
-        if (request.getURI() == "/") {
+        const std::string path = Poco::URI(request.getURI()).getPath();
+        if (path == "/stream.mjpg") {
+            handleMjpegStream(request, response);
+        } else if (path == "/snapshot.jpg") {
+            handleSnapshot(request, response);
+        } else if (path == "/api/classes") {
+            handleClasses(response);
+        } else if (path == "/api/config") {
+            handleConfig(request, response);
+        } else if (path == "/api/recording") {
+            handleRecording(request, response);
+        } else if (path == "/api/events") {
+            handleEvents(response);
+        } else if (path == "/api/stats") {
+            handleStats(response);
+        } else if (path == "/api/detections") {
+            handleDetections(request, response);
+        } else if (path == "/api/detections/histogram") {
+            handleDetectionHistogram(request, response);
+        } else if (path == "/") {
             response.setContentType("text/html");
             std::ostream& out = response.send();
             out << R"(
@@ -38,7 +170,7 @@ void WebServer::WebSocketHandler::handleRequest(
         .container { display: flex; gap: 20px; }
         .video-container { position: relative; flex: 2; }
         .controls { flex: 1; padding: 20px; background: #f5f5f5; border-radius: 8px; }
-        #video-canvas { width: 640px; height: 480px; background: #000; }
+        #video-canvas, #video { width: 640px; height: 480px; background: #000; }
         #overlay-canvas { position: absolute; top: 0; left: 0; pointer-events: none; }
         .control-group { margin-bottom: 15px; }
         .btn { 
@@ -71,10 +203,12 @@ void WebServer::WebSocketHandler::handleRequest(
     <div class="container">
         <div class="video-container">
             <canvas id="video-canvas"></canvas>
+            <video id="video" muted autoplay playsinline hidden></video>
             <canvas id="overlay-canvas"></canvas>
             <div class="stats">
                 <div>FPS: <span id="fps">0</span></div>
                 <div>Objects: <span id="object-count">0</span></div>
+                <div>Latency: <span id="latency">-</span> ms</div>
             </div>
         </div>
         <div class="controls">
@@ -95,6 +229,15 @@ void WebServer::WebSocketHandler::handleRequest(
                 <h3>Video Controls</h3>
                 <button id="snapshot" class="btn">Take Snapshot</button>
                 <button id="record" class="btn">Start Recording</button>
+                <br><br>
+                <label>
+                    Resolution:
+                    <select id="tier">
+                        <option value="full">Full</option>
+                        <option value="half">Half</option>
+                        <option value="quarter">Quarter</option>
+                    </select>
+                </label>
             </div>
             <div class="control-group">
                 <h3>Detection Results</h3>
@@ -104,6 +247,7 @@ void WebServer::WebSocketHandler::handleRequest(
     </div>
     <script>
         const videoCanvas = document.getElementById('video-canvas');
+        const video = document.getElementById('video');
         const overlayCanvas = document.getElementById('overlay-canvas');
         const ctx = videoCanvas.getContext('2d');
         const overlayCtx = overlayCanvas.getContext('2d');
@@ -112,38 +256,189 @@ void WebServer::WebSocketHandler::handleRequest(
         let frameCount = 0;
         let lastTime = performance.now();
         let recording = false;
-        let mediaRecorder = null;
-        let recordedChunks = [];
+        let classNames = [];
+        let lastDetectionSeq = -1;
+        let mediaSource = null;
+        let sourceBuffer = null;
+        let pendingSegments = [];
+        let frameInfo = null;
+        let displayLatency = null;
+        
+        // 浏览器支持MSE播放H.264时请求fMP4推流
+        const h264Supported = window.MediaSource &&
+            MediaSource.isTypeSupported('video/mp4; codecs="avc1.42E01E"');
+        
+        // 从初始化段的avcC中取出profile和level，拼成MSE需要的codecs参数
+        function avcCodecString(bytes) {
+            for (let i = 0; i + 8 <= bytes.length; i++) {
+                if (bytes[i] === 0x61 && bytes[i + 1] === 0x76 &&
+                    bytes[i + 2] === 0x63 && bytes[i + 3] === 0x43) {
+                    const hex = b => b.toString(16).padStart(2, '0');
+                    return `avc1.${hex(bytes[i + 5])}${hex(bytes[i + 6])}${hex(bytes[i + 7])}`;
+                }
+            }
+            return 'avc1.42E01E';
+        }
+        
+        // fMP4分片依次追加到SourceBuffer，首条消息为初始化段
+        function appendSegment(buffer) {
+            if (!mediaSource) {
+                const codec = avcCodecString(new Uint8Array(buffer));
+                mediaSource = new MediaSource();
+                mediaSource.addEventListener('sourceopen', () => {
+                    sourceBuffer = mediaSource.addSourceBuffer(`video/mp4; codecs="${codec}"`);
+                    sourceBuffer.addEventListener('updateend', flushSegments);
+                    flushSegments();
+                });
+                video.src = URL.createObjectURL(mediaSource);
+                video.hidden = false;
+                videoCanvas.hidden = true;
+            }
+            pendingSegments.push(buffer);
+            // 分片之前的帧信息给出服务端时延，加上接收后的处理时间和播放位置落后缓冲末尾的时长
+            if (frameInfo) {
+                let lead = 0;
+                if (sourceBuffer && sourceBuffer.buffered.length > 0) {
+                    lead = sourceBuffer.buffered.end(sourceBuffer.buffered.length - 1) - video.currentTime;
+                }
+                displayLatency = frameInfo.ageMs + (performance.now() - frameInfo.receivedAt) + Math.max(lead, 0) * 1000;
+                frameInfo = null;
+            }
+            flushSegments();
+        }
+        
+        function flushSegments() {
+            if (!sourceBuffer || sourceBuffer.updating) return;
+            // 播放位置落后于缓冲末尾时直接追到最新帧，保持低延迟
+            const buffered = sourceBuffer.buffered;
+            if (buffered.length > 0) {
+                const end = buffered.end(buffered.length - 1);
+                if (end - video.currentTime > 0.5) video.currentTime = end - 0.05;
+                if (video.currentTime - buffered.start(0) > 30) {
+                    sourceBuffer.remove(0, video.currentTime - 10);
+                    return;
+                }
+            }
+            if (pendingSegments.length > 0) {
+                sourceBuffer.appendBuffer(pendingSegments.shift());
+                countFrame();
+            }
+        }
+        
+        function countFrame() {
+            frameCount++;
+            const now = performance.now();
+            if (now - lastTime >= 1000) {
+                document.getElementById('fps').textContent = frameCount.toFixed(1);
+                frameCount = 0;
+                lastTime = now;
+                reportLatency();
+            }
+        }
+        
+        // 每秒显示一次采集到显示的时延并上报服务端汇总
+        function reportLatency() {
+            if (displayLatency === null) return;
+            document.getElementById('latency').textContent = displayLatency.toFixed(0);
+            if (ws && ws.readyState === WebSocket.OPEN) {
+                ws.send(JSON.stringify({
+                    command: 'reportLatency',
+                    display_latency_us: Math.round(displayLatency * 1000)
+                }));
+            }
+        }
+        
+        // 解析二进制帧消息，格式见frame_protocol.h
+        function parseFrameMessage(buffer) {
+            const view = new DataView(buffer);
+            const headerSize = view.getUint8(5);
+            const count = view.getUint16(6, true);
+            const boxSize = view.getUint16(12, true);
+            const detectionSeq = Number(view.getBigUint64(32, true));
+            const ageMs = headerSize >= 48 ? view.getUint32(40, true) / 1000 : null;
+            const detections = [];
+            for (let i = 0; i < count; i++) {
+                const off = headerSize + i * boxSize;
+                const classId = view.getUint16(off, true);
+                detections.push({
+                    label: classNames[classId] || `#${classId}`,
+                    confidence: view.getUint16(off + 2, true) / 65535,
+                    x: view.getInt16(off + 4, true),
+                    y: view.getInt16(off + 6, true),
+                    width: view.getInt16(off + 8, true),
+                    height: view.getInt16(off + 10, true)
+                });
+            }
+            const jpeg = new Uint8Array(buffer, headerSize + count * boxSize);
+            return {detectionSeq, detections, jpeg, ageMs};
+        }
+        
+        async function drawFrame(jpeg) {
+            const blob = new Blob([jpeg], {type: 'image/jpeg'});
+            const img = await createImageBitmap(blob);
+            
+            ctx.drawImage(img, 0, 0, videoCanvas.width, videoCanvas.height);
+            countFrame();
+        }
         
         function connectWebSocket() {
-            ws = new WebSocket(`ws://${location.host}/ws`);
+            const query = h264Supported ? 'codec=h264' : 'format=binary';
+            const tier = document.getElementById('tier').value;
+            ws = new WebSocket(`ws://${location.host}/ws?${query}&tier=${tier}`);
             ws.binaryType = 'arraybuffer';
+            mediaSource = null;
+            sourceBuffer = null;
+            pendingSegments = [];
+            frameInfo = null;
+            displayLatency = null;
             
             ws.onmessage = async (event) => {
+                const receivedAt = performance.now();
                 if (event.data instanceof ArrayBuffer) {
-                    const blob = new Blob([event.data], {type: 'image/jpeg'});
-                    const img = await createImageBitmap(blob);
-                    
-                    ctx.drawImage(img, 0, 0, videoCanvas.width, videoCanvas.height);
-                    frameCount++;
-                    
-                    const now = performance.now();
-                    if (now - lastTime >= 1000) {
-                        document.getElementById('fps').textContent = frameCount.toFixed(1);
-                        frameCount = 0;
-                        lastTime = now;
+                    // 魔数"CAMF"为JPEG帧消息，否则为fMP4分片
+                    const magic = new Uint8Array(event.data, 0, 4);
+                    if (String.fromCharCode(...magic) !== 'CAMF') {
+                        appendSegment(event.data);
+                        return;
+                    }
+                    const msg = parseFrameMessage(event.data);
+                    if (msg.detectionSeq !== lastDetectionSeq) {
+                        lastDetectionSeq = msg.detectionSeq;
+                        updateDetections(msg.detections);
+                    }
+                    await drawFrame(msg.jpeg);
+                    if (msg.ageMs !== null) {
+                        displayLatency = msg.ageMs + (performance.now() - receivedAt);
                     }
                 } else {
                     const data = JSON.parse(event.data);
-                    updateDetections(data.detections);
+                    if (data.type === 'frameInfo') {
+                        frameInfo = {ageMs: data.age_us / 1000, receivedAt};
+                    } else if (data.type === 'detections') {
+                        updateDetections(data.detections);
+                    } else if (data.type === 'config') {
+                        syncConfig(data.config);
+                    }
                 }
             };
             
+            ws.onopen = () => {
+                ws.send(JSON.stringify({command: 'getConfig'}));
+            };
+            
             ws.onclose = () => {
                 setTimeout(connectWebSocket, 1000);
             };
         }
         
+        // 其他客户端或REST接口修改配置后同步界面
+        function syncConfig(config) {
+            document.getElementById('enable-detection').checked = config.detection_enabled;
+            document.getElementById('confidence').value = Math.round(config.confidence_threshold * 100);
+            document.getElementById('confidence-value').textContent =
+                config.confidence_threshold.toFixed(2);
+        }
+        
         function updateDetections(detections) {
             overlayCtx.clearRect(0, 0, overlayCanvas.width, overlayCanvas.height);
             document.getElementById('object-count').textContent = detections.length;
@@ -180,6 +475,10 @@ void WebServer::WebSocketHandler::handleRequest(
             overlayCanvas.width = 640;
             overlayCanvas.height = 480;
             
+            fetch('/api/classes')
+                .then(r => r.json())
+                .then(names => { classNames = names; })
+                .catch(() => {});
             connectWebSocket();
             
             // 事件监听器
@@ -199,12 +498,21 @@ void WebServer::WebSocketHandler::handleRequest(
                 }));
             };
             
+            // 切换分辨率档位不需要重连，检测框坐标始终是原始分辨率
+            document.getElementById('tier').onchange = (e) => {
+                ws.send(JSON.stringify({
+                    command: 'setStream',
+                    format: h264Supported ? 'h264' : 'binary',
+                    tier: e.target.value
+                }));
+            };
+            
             document.getElementById('snapshot').onclick = () => {
                 const canvas = document.createElement('canvas');
                 canvas.width = videoCanvas.width;
                 canvas.height = videoCanvas.height;
                 const ctx = canvas.getContext('2d');
-                ctx.drawImage(videoCanvas, 0, 0);
+                ctx.drawImage(video.hidden ? videoCanvas : video, 0, 0, canvas.width, canvas.height);
                 ctx.drawImage(overlayCanvas, 0, 0);
                 
                 const link = document.createElement('a');
@@ -213,43 +521,30 @@ void WebServer::WebSocketHandler::handleRequest(
                 link.click();
             };
             
-            document.getElementById('record').onclick = (e) => {
-                if (!recording) {
-                    startRecording();
-                    e.target.textContent = 'Stop Recording';
-                } else {
-                    stopRecording();
-                    e.target.textContent = 'Start Recording';
-                }
-                recording = !recording;
+            document.getElementById('record').onclick = () => {
+                setRecording(!recording);
             };
+            setRecording(null);
         }
         
-        function startRecording() {
-            const stream = videoCanvas.captureStream();
-            recordedChunks = [];
-            mediaRecorder = new MediaRecorder(stream, {mimeType: 'video/webm'});
-            
-            mediaRecorder.ondataavailable = (e) => {
-                if (e.data.size > 0) {
-                    recordedChunks.push(e.data);
-                }
+        // 录像在服务端进行，enabled为null时只查询状态
+        function setRecording(enabled) {
+            const options = enabled === null ? {} : {
+                method: 'POST',
+                headers: {'Content-Type': 'application/json'},
+                body: JSON.stringify({enabled: enabled})
             };
-            
-            mediaRecorder.onstop = () => {
-                const blob = new Blob(recordedChunks, {type: 'video/webm'});
-                const url = URL.createObjectURL(blob);
-                const link = document.createElement('a');
-                link.href = url;
-                link.download = 'recording.webm';
-                link.click();
-            };
-            
-            mediaRecorder.start();
-        }
-        
-        function stopRecording() {
-            mediaRecorder.stop();
+            fetch('/api/recording', options)
+                .then(r => r.ok ? r.json() : Promise.reject(r.status))
+                .then(status => {
+                    recording = status.recording;
+                    const button = document.getElementById('record');
+                    button.textContent = recording ? 'Stop Recording' : 'Start Recording';
+                    button.title = status.current_file || '';
+                })
+                .catch(() => {
+                    document.getElementById('record').disabled = true;
+                });
         }
         
         init();
@@ -264,89 +559,494 @@ void WebServer::WebSocketHandler::handleRequest(
     }
 }
 
-void WebServer::WebSocketHandler::handleWebSocket(WebSocket& ws) {
-    try {
-        ws.setBlocking(false);
-        ws.setReceiveTimeout(Poco::Timespan(0, 100000)); // 100ms
+void WebServer::WebSocketHandler::handleWebSocket(WebSocket& ws, StreamFormat format, StreamTier tier) {
+    // Poco的WebSocket析构时会关闭自己的描述符，反应器持有一份dup后的副本
+    int fd = ::dup(ws.impl()->sockfd());
+    uint64_t conn_id = 0;
+    if (fd >= 0) {
+#ifdef USE_H264
+        // H.264观看者由推流器加入，保证先收到初始化段
+        conn_id = format == kFormatH264 ? owner_.h264_[tier]->addViewer(fd)
+                                        : owner_.reactor_->addWebSocket(fd, streamKey(format, tier));
+#else
+        conn_id = owner_.reactor_->addWebSocket(fd, streamKey(format, tier));
+#endif
+    }
+    if (conn_id == 0) {
+        std::cerr << "WebSocket连接移交失败" << std::endl;
+    }
+}
 
-        char buffer[1024];
-        int flags;
-        int n;
-        
-        while (true) {
-            try {
-                n = ws.receiveFrame(buffer, sizeof(buffer), flags);
-                if (n > 0) {
-                    // 处理客户端命令
-                    std::string command(buffer, n);
-                    // TODO: 处理命令
-                }
-            } catch (const Poco::TimeoutException&) {
-                // 超时是正常的
+void WebServer::WebSocketHandler::handleMjpegStream(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    response.setContentType(std::string("multipart/x-mixed-replace; boundary=")
+                            + StreamReactor::kMjpegBoundary);
+    response.set("Cache-Control", "no-cache, no-store, must-revalidate");
+    response.set("Pragma", "no-cache");
+    response.setKeepAlive(false);
+    response.setContentLength(HTTPResponse::UNKNOWN_CONTENT_LENGTH);
+    response.send().flush();
+
+    // 响应头发出后脱离Poco会话，后续帧由反应器写出
+    StreamSocket socket = static_cast<HTTPServerRequestImpl&>(request).detachSocket();
+    int fd = ::dup(socket.impl()->sockfd());
+    uint64_t conn_id = fd < 0 ? 0 : owner_.reactor_->addMjpegStream(fd);
+    if (conn_id == 0) {
+        std::cerr << "MJPEG连接移交失败" << std::endl;
+        return;
+    }
+
+    // 先推送当前帧，避免客户端等待下一帧
+    auto frame = owner_.video_capture_->getLatestEncodedFrame();
+    if (frame) {
+        owner_.reactor_->sendMjpeg(conn_id, SharedBytes(frame, frame->jpeg.data(), frame->jpeg.size()));
+    }
+}
+
+void WebServer::WebSocketHandler::handleSnapshot(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    auto frame = owner_.video_capture_->getLatestEncodedFrame();
+    if (!frame) {
+        response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        response.send();
+        return;
+    }
+
+    int width = 0;
+    Poco::URI uri(request.getURI());
+    for (const auto& param : uri.getQueryParameters()) {
+        if (param.first == "w") {
+            Poco::NumberParser::tryParse(param.second, width);
+        }
+    }
+    width = SnapshotCache::normalizeWidth(frame, width);
+
+    // 校验值由帧序号和输出宽度决定，帧不变时客户端缓存始终有效
+    std::string etag = "\"" + instanceTag() + "-" + std::to_string(frame->sequence);
+    if (width > 0) etag += "-w" + std::to_string(width);
+    etag += "\"";
+    Poco::Timestamp modified = Poco::Timestamp::fromEpochTime(
+        std::chrono::system_clock::to_time_t(frame->wall_time));
+
+    response.set("ETag", etag);
+    response.set("Last-Modified",
+                 Poco::DateTimeFormatter::format(modified, Poco::DateTimeFormat::HTTP_FORMAT));
+    response.set("Cache-Control", "no-cache");
+
+    // If-None-Match优先于If-Modified-Since
+    bool not_modified = false;
+    if (request.has("If-None-Match")) {
+        const std::string& tags = request.get("If-None-Match");
+        not_modified = tags == "*" || tags.find(etag) != std::string::npos;
+    } else if (request.has("If-Modified-Since")) {
+        Poco::DateTime since;
+        int tz;
+        if (Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::HTTP_FORMAT,
+                                           request.get("If-Modified-Since"), since, tz)) {
+            not_modified = modified <= since.timestamp();
+        }
+    }
+    if (not_modified) {
+        response.setStatusAndReason(HTTPResponse::HTTP_NOT_MODIFIED);
+        response.send();
+        return;
+    }
+
+    auto jpeg = owner_.snapshots_.get(frame, width);
+    if (!jpeg) {
+        response.setStatusAndReason(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+        response.send();
+        return;
+    }
+    response.setContentType("image/jpeg");
+    response.sendBuffer(jpeg.data, jpeg.size);
+}
+
+void WebServer::WebSocketHandler::handleClasses(HTTPServerResponse& response) {
+    Poco::JSON::Array names;
+    for (const auto& name : owner_.processor_->classNames()) {
+        names.add(name);
+    }
+    response.setContentType("application/json");
+    names.stringify(response.send());
+}
+
+void WebServer::WebSocketHandler::handleConfig(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    auto config = owner_.processor_->config();
+
+    if (request.getMethod() == HTTPRequest::HTTP_POST
+        || request.getMethod() == HTTPRequest::HTTP_PUT) {
+        std::string error;
+        try {
+            Poco::JSON::Parser parser;
+            auto json = parser.parse(request.stream()).extract<Poco::JSON::Object::Ptr>();
+            if (!config->applyJson(*json, error)) {
+                throw std::invalid_argument(error);
             }
+        } catch (const Poco::Exception& e) {
+            error = e.displayText();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!error.empty()) {
+            response.setStatusAndReason(HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("text/plain");
+            response.send() << error;
+            return;
+        }
+    } else if (request.getMethod() != HTTPRequest::HTTP_GET) {
+        response.setStatusAndReason(HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+        response.send();
+        return;
+    }
 
-            // 获取并发送新帧
-            auto frame = video_capture_->getLatestFrame();
-            if (!frame.empty()) {
-                try {
-                    ws.sendFrame(frame.data(), frame.size(), WebSocket::FRAME_BINARY);
-                    
-                    // 处理图像识别
-                    cv::Mat img = cv::imdecode(
-                        cv::Mat(1, frame.size(), CV_8UC1, (void*)frame.data()),
-                        cv::IMREAD_COLOR
-                    );
-                    
-                    if (!img.empty()) {
-                        auto detections = processor_->processFrame(img);
-                        
-                        // 发送检测结果
-                        Poco::JSON::Object json;
-                        json.set("type", "detections");
-                        Poco::JSON::Array dets;
-                        
-                        for (const auto& det : detections) {
-                            Poco::JSON::Object d;
-                            d.set("label", det.label);
-                            d.set("confidence", det.confidence);
-                            d.set("x", det.bbox.x);
-                            d.set("y", det.bbox.y);
-                            d.set("width", det.bbox.width);
-                            d.set("height", det.bbox.height);
-                            dets.add(d);
-                        }
-                        
-                        json.set("detections", dets);
-                        std::stringstream ss;
-                        json.stringify(ss);
-                        ws.sendFrame(ss.str().data(), ss.str().size(), WebSocket::FRAME_TEXT);
-                    }
-                } catch (const std::exception&) {
-                    break; // 连接可能已关闭
-                }
+    response.setContentType("application/json");
+    RuntimeConfigStore::toJson(*config->requested()).stringify(response.send());
+}
+
+void WebServer::WebSocketHandler::handleRecording(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    auto& recorder = owner_.recorder_;
+    if (!recorder) {
+        response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        response.send();
+        return;
+    }
+
+    if (request.getMethod() == HTTPRequest::HTTP_POST
+        || request.getMethod() == HTTPRequest::HTTP_PUT) {
+        try {
+            Poco::JSON::Parser parser;
+            auto json = parser.parse(request.stream()).extract<Poco::JSON::Object::Ptr>();
+            recorder->setRecording(json->getValue<bool>("enabled"));
+        } catch (const Poco::Exception& e) {
+            response.setStatusAndReason(HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("text/plain");
+            response.send() << e.displayText();
+            return;
+        }
+    } else if (request.getMethod() != HTTPRequest::HTTP_GET) {
+        response.setStatusAndReason(HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+        response.send();
+        return;
+    }
+
+    response.setContentType("application/json");
+    SegmentRecorder::toJson(recorder->status()).stringify(response.send());
+}
+
+void WebServer::WebSocketHandler::handleEvents(HTTPServerResponse& response) {
+    if (!owner_.events_) {
+        response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        response.send();
+        return;
+    }
+    response.setContentType("application/json");
+    EventRecorder::toJson(owner_.events_->status()).stringify(response.send());
+}
+
+void WebServer::WebSocketHandler::handleStats(HTTPServerResponse& response) {
+    CaptureStats capture = owner_.video_capture_->stats();
+    Poco::JSON::Object capture_json;
+    capture_json.set("frames_published", capture.frames_published);
+    Poco::JSON::Object pool_json;
+    pool_json.set("capacity", capture.pool_capacity);
+    pool_json.set("in_use", capture.pool_in_use);
+    pool_json.set("exhausted", capture.pool_exhausted);
+    capture_json.set("pool", pool_json);
+    capture_json.set("dequeue_latency", latencyToJson(capture.dequeue_latency));
+    capture_json.set("late_dequeues", capture.late_dequeues);
+    capture_json.set("publish_latency", latencyToJson(capture.publish_latency));
+    capture_json.set("driver_drops", capture.driver_drops);
+    Poco::JSON::Object buffers_json;
+    buffers_json.set("count", capture.buffers);
+    buffers_json.set("held", capture.buffers_held);
+    buffers_json.set("raw_fallbacks", capture.raw_fallbacks);
+    capture_json.set("buffers", buffers_json);
+    Poco::JSON::Array stages_json;
+    for (const auto& stage : capture.stages) {
+        Poco::JSON::Object stage_json;
+        stage_json.set("stage", stage.stage);
+        stage_json.set("policy", stage.policy == MailboxPolicy::kQueue ? "queue" : "latest");
+        stage_json.set("depth", stage.depth);
+        stage_json.set("pushed", stage.pushed);
+        stage_json.set("delivered", stage.delivered);
+        stage_json.set("dropped", stage.dropped);
+        stages_json.add(stage_json);
+    }
+    capture_json.set("stages", stages_json);
+
+    StreamReactor::Stats reactor = owner_.reactor_->stats();
+    Poco::JSON::Object reactor_json;
+    reactor_json.set("connections", reactor.connections);
+    reactor_json.set("messages_sent", reactor.messages_sent);
+    reactor_json.set("bytes_sent", reactor.bytes_sent);
+    reactor_json.set("messages_dropped", reactor.messages_dropped);
+    reactor_json.set("resyncs", reactor.resyncs);
+    reactor_json.set("slow_closed", reactor.slow_closed);
+
+    Poco::JSON::Array tiers_json;
+    for (uint32_t tier = kTierHalf; tier < kTierCount; ++tier) {
+        auto pool = std::atomic_load(&owner_.tier_pools_[tier]);
+        if (!pool) continue;
+        FramePool::Stats stats = pool->stats();
+        Poco::JSON::Object tier_json;
+        tier_json.set("tier", tier == kTierHalf ? "half" : "quarter");
+        tier_json.set("capacity", stats.capacity);
+        tier_json.set("in_use", stats.in_use);
+        tier_json.set("exhausted", stats.exhausted);
+        tiers_json.add(tier_json);
+    }
+
+    Poco::JSON::Object latency_json;
+    latency_json.set("camera_id", owner_.camera_id_);
+    latency_json.set("capture_to_inference", latencyToJson(owner_.inference_latency_.snapshot()));
+    latency_json.set("capture_to_send", latencyToJson(owner_.send_latency_.snapshot()));
+    latency_json.set("capture_to_display", latencyToJson(owner_.display_latency_.snapshot()));
+    Poco::JSON::Array clients_json;
+    {
+        std::lock_guard<std::mutex> lock(owner_.client_latency_mutex_);
+        for (const auto& client : owner_.client_latency_) {
+            Poco::JSON::Object client_json;
+            client_json.set("connection", client.first);
+            client_json.set("capture_to_display", latencyToJson(client.second->snapshot()));
+            clients_json.add(client_json);
+        }
+    }
+    latency_json.set("clients", clients_json);
+
+    Poco::JSON::Object kernels_json;
+    Poco::JSON::Array features_json;
+    for (const auto& name : KernelDispatch::features().names()) {
+        features_json.add(name);
+    }
+    kernels_json.set("cpu_features", features_json);
+    for (int i = 0; i < static_cast<int>(KernelId::kCount); ++i) {
+        auto kernel = static_cast<KernelId>(i);
+        kernels_json.set(KernelDispatch::kernelName(kernel), KernelDispatch::isaName(KernelDispatch::select(kernel)));
+    }
+
+    Poco::JSON::Object model_json;
+    Poco::JSON::Array sizes_json;
+    for (int size : owner_.processor_->inputSizes()) {
+        sizes_json.add(size);
+    }
+    model_json.set("sizes", sizes_json);
+    model_json.set("input_size", owner_.processor_->activeInputSize());
+    model_json.set("backend", owner_.processor_->backendName());
+
+    Poco::JSON::Object json;
+    json.set("capture", capture_json);
+    json.set("reactor", reactor_json);
+    json.set("latency", latency_json);
+    json.set("kernels", kernels_json);
+    json.set("model", model_json);
+    json.set("tier_pools", tiers_json);
+#ifdef USE_ALLOC_STATS
+    if (AllocStats::enabled()) {
+        Poco::JSON::Array allocations_json;
+        for (const auto& group : AllocStats::snapshot()) {
+            Poco::JSON::Object group_json;
+            group_json.set("group", group.name);
+            group_json.set("allocations", group.allocations);
+            group_json.set("bytes", group.bytes);
+            allocations_json.add(group_json);
+        }
+        json.set("allocations", allocations_json);
+    }
+#endif
+    if (owner_.governor_) {
+        json.set("governor", PipelineGovernor::toJson(owner_.governor_->status()));
+    }
+    response.setContentType("application/json");
+    json.stringify(response.send());
+}
+
+bool WebServer::WebSocketHandler::parseDetectionQuery(
+    const Poco::URI& uri, DetectionQuery& query, std::string& error) const {
+    for (const auto& param : uri.getQueryParameters()) {
+        const std::string& key = param.first;
+        const std::string& value = param.second;
+        bool ok = true;
+        if (key == "from") {
+            ok = parseTime(value, query.from_us);
+        } else if (key == "to") {
+            ok = parseTime(value, query.to_us);
+        } else if (key == "camera") {
+            ok = Poco::NumberParser::tryParse(value, query.camera);
+        } else if (key == "class") {
+            // 类别可以是ID或名称
+            if (!Poco::NumberParser::tryParse(value, query.class_id)) {
+                const auto& names = owner_.processor_->classNames();
+                auto it = std::find(names.begin(), names.end(), value);
+                ok = it != names.end();
+                if (ok) query.class_id = static_cast<int>(it - names.begin());
             }
-            
-            std::this_thread::sleep_for(30ms);
+        } else if (key == "min_confidence") {
+            double confidence;
+            ok = Poco::NumberParser::tryParseFloat(value, confidence);
+            query.min_confidence = static_cast<float>(confidence);
+        }
+        if (!ok) {
+            error = "参数无效: " + key + "=" + value;
+            return false;
         }
     }
-    catch (const std::exception& e) {
-        std::cerr << "WebSocket handler error: " << e.what() << std::endl;
+    if (query.from_us >= query.to_us) {
+        error = "时间范围无效";
+        return false;
     }
+    return true;
 }
 
-WebServer::HandlerFactory::HandlerFactory(
-    std::shared_ptr<CaptureInterface> capture,
-    std::shared_ptr<ImageProcessor> processor)
-    : video_capture_(capture), processor_(processor) {}
+void WebServer::WebSocketHandler::handleDetections(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    auto& store = owner_.store_;
+    if (!store) {
+        response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        response.send();
+        return;
+    }
+
+    Poco::URI uri(request.getURI());
+    DetectionQuery query;
+    DetectionCursor cursor;
+    int limit = kDefaultPageSize;
+    std::string error;
+    bool ok = parseDetectionQuery(uri, query, error);
+    for (const auto& param : uri.getQueryParameters()) {
+        if (!ok) break;
+        if (param.first == "limit") {
+            ok = Poco::NumberParser::tryParse(param.second, limit) && limit > 0;
+            limit = std::min(limit, kMaxPageSize);
+        } else if (param.first == "cursor") {
+            // 游标格式：分段ID-行号
+            unsigned long long row = 0;
+            long long segment = 0;
+            ok = sscanf(param.second.c_str(), "%lld-%llu", &segment, &row) == 2;
+            cursor.segment = segment;
+            cursor.row = row;
+        }
+        if (!ok) error = "参数无效: " + param.first + "=" + param.second;
+    }
+    if (!ok) {
+        response.setStatusAndReason(HTTPResponse::HTTP_BAD_REQUEST);
+        response.setContentType("text/plain");
+        response.send() << error;
+        return;
+    }
+
+    // 记录边扫描边输出，不在内存中汇总
+    response.setContentType("application/json");
+    response.setChunkedTransferEncoding(true);
+    std::ostream& out = response.send();
+    out << "{\"records\":[";
+
+    int count = 0;
+    DetectionCursor next;
+    char line[256];
+    store->scan(query, [&](const DetectionRecord& r, const DetectionCursor& position) {
+        snprintf(line, sizeof(line),
+                 "%s{\"timestamp\":%lld,\"camera\":%u,\"class_id\":%u,\"confidence\":%.3f,"
+                 "\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"track_id\":%u}",
+                 count > 0 ? "," : "", static_cast<long long>(r.timestamp_us),
+                 r.camera, r.class_id, r.confidence, r.x, r.y, r.width, r.height, r.track_id);
+        out << line;
+        next = position;
+        return ++count < limit;
+    }, cursor);
+
+    out << "],\"count\":" << count << ",\"next_cursor\":";
+    if (count == limit) {
+        out << "\"" << next.segment << "-" << next.row << "\"";
+    } else {
+        out << "null";
+    }
+    out << "}";
+}
+
+void WebServer::WebSocketHandler::handleDetectionHistogram(
+    HTTPServerRequest& request, HTTPServerResponse& response) {
+    auto& store = owner_.store_;
+    if (!store) {
+        response.setStatusAndReason(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        response.send();
+        return;
+    }
+
+    Poco::URI uri(request.getURI());
+    DetectionQuery query;
+    // 直方图默认统计最近24小时
+    query.to_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    query.from_us = query.to_us - 24LL * 3600 * 1000000;
+    int bucket_seconds = 3600;
+    std::string error;
+    bool ok = parseDetectionQuery(uri, query, error);
+    for (const auto& param : uri.getQueryParameters()) {
+        if (ok && param.first == "bucket") {
+            ok = Poco::NumberParser::tryParse(param.second, bucket_seconds) && bucket_seconds > 0;
+            if (!ok) error = "参数无效: bucket=" + param.second;
+        }
+    }
+    int64_t bucket_us = static_cast<int64_t>(bucket_seconds) * 1000000;
+    int64_t buckets = ok ? (query.to_us - query.from_us + bucket_us - 1) / bucket_us : 0;
+    if (ok && buckets > kMaxHistogramBuckets) {
+        ok = false;
+        error = "区间数过多，请增大bucket或缩小时间范围";
+    }
+    if (!ok) {
+        response.setStatusAndReason(HTTPResponse::HTTP_BAD_REQUEST);
+        response.setContentType("text/plain");
+        response.send() << error;
+        return;
+    }
+
+    std::vector<uint64_t> counts(static_cast<size_t>(buckets), 0);
+    uint64_t total = 0;
+    store->scan(query, [&](const DetectionRecord& r, const DetectionCursor&) {
+        ++counts[static_cast<size_t>((r.timestamp_us - query.from_us) / bucket_us)];
+        ++total;
+        return true;
+    });
+
+    response.setContentType("application/json");
+    response.setChunkedTransferEncoding(true);
+    std::ostream& out = response.send();
+    out << "{\"from\":" << query.from_us << ",\"to\":" << query.to_us
+        << ",\"bucket\":" << bucket_seconds << ",\"total\":" << total << ",\"counts\":[";
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (i > 0) out << ",";
+        out << counts[i];
+    }
+    out << "]}";
+}
+
+WebServer::HandlerFactory::HandlerFactory(WebServer& owner)
+    : owner_(owner) {}
 
 HTTPRequestHandler* WebServer::HandlerFactory::createRequestHandler(
     const HTTPServerRequest&) {
-    return new WebSocketHandler(video_capture_, processor_);
+    // 工厂在Poco线程池的工作线程中调用，借此为工作线程应用调度策略
+    ThreadTuning::applyOnce("http", "http-worker");
+    return new WebSocketHandler(owner_);
 }
 
-WebServer::WebServer(std::shared_ptr<CaptureInterface> video_capture)
+WebServer::WebServer(std::shared_ptr<CaptureInterface> video_capture,
+                     std::shared_ptr<RuntimeConfigStore> config,
+                     const ModelOptions& model_options)
     : video_capture_(video_capture)
-    , processor_(std::make_shared<ImageProcessor>()) {}
+    , processor_(std::make_shared<ImageProcessor>(config, model_options))
+    , reactor_(std::make_unique<StreamReactor>()) {
+    reactor_->setMessageCallback([this](uint64_t conn_id, const std::string& message) {
+        handleCommand(conn_id, message);
+    });
+    reactor_->setCloseCallback([this](uint64_t conn_id) {
+        std::lock_guard<std::mutex> lock(client_latency_mutex_);
+        client_latency_.erase(conn_id);
+    });
+}
 
 WebServer::~WebServer() {
     stop();
@@ -354,14 +1054,52 @@ WebServer::~WebServer() {
 
 void WebServer::start(int port) {
     try {
+        if (!reactor_->start()) {
+            throw std::runtime_error("无法启动WebSocket反应器");
+        }
+
+        // WebSocket连接握手后即移交反应器，Poco线程只处理短时HTTP请求
         auto* params = new HTTPServerParams;
         params->setMaxQueued(100);
         params->setMaxThreads(4);
 
         ServerSocket socket(port);
         server_ = std::make_unique<HTTPServer>(
-            new HandlerFactory(video_capture_, processor_), socket, params);
+            new HandlerFactory(*this), socket, params);
         server_->start();
+
+#ifdef USE_H264
+        // 各档位共用同一时间零点，切换档位时播放端时间轴连续
+        if (h264_options_.enabled) {
+            auto origin = std::chrono::system_clock::now();
+            for (uint32_t tier = 0; tier < kTierCount; ++tier) {
+                auto& streamer = h264_[tier];
+                streamer = std::make_unique<H264Streamer>(
+                    reactor_.get(), streamKey(kFormatH264, static_cast<StreamTier>(tier)),
+                    processor_->config(), h264_options_, origin);
+                if (!streamer->start()) {
+                    streamer.reset();
+                }
+            }
+        }
+#endif
+
+        // 推流和推理分属不同的调度隔离组，各用一个执行器；推流的两个任务互不阻塞
+        running_ = true;
+        streaming_ = std::make_unique<CoroExecutor>(ExecutorOptions{"streaming", "streaming", 2});
+        inference_ = std::make_unique<CoroExecutor>(ExecutorOptions{"detection", "inference", 1});
+        streaming_->start();
+        inference_->start();
+        streaming_->spawn(broadcastTask());
+        streaming_->spawn(simulcastTask());
+        inference_->spawn(detectionTask());
+
+        if (governor_options_.enabled) {
+            governor_ = std::make_unique<PipelineGovernor>(
+                video_capture_, processor_->config(), &send_latency_, &inference_latency_,
+                processor_->inputSizes(), governor_options_);
+            governor_->start();
+        }
     } catch (const std::exception& e) {
         std::cerr << "Failed to start server: " << e.what() << std::endl;
         throw;
@@ -373,4 +1111,321 @@ void WebServer::stop() {
         server_->stop();
         server_.reset();
     }
+    if (governor_) {
+        governor_->stop();
+    }
+
+    running_ = false;
+    if (streaming_) {
+        streaming_->stop();
+    }
+    if (inference_) {
+        inference_->stop();
+    }
+    for (auto& streamer : h264_) {
+        if (streamer) streamer->stop();
+    }
+    reactor_->stop();
+}
+
+void WebServer::handleCommand(uint64_t conn_id, const std::string& message) {
+    auto config = processor_->config();
+    Poco::JSON::Object::Ptr json;
+    try {
+        Poco::JSON::Parser parser;
+        json = parser.parse(message).extract<Poco::JSON::Object::Ptr>();
+    } catch (const Poco::Exception& e) {
+        std::cerr << "无法解析客户端命令: " << e.displayText() << std::endl;
+        return;
+    }
+
+    const std::string command = json->optValue<std::string>("command", "");
+    std::string error;
+    bool changed = true;
+    try {
+        if (command == "setDetection") {
+            bool enabled = json->getValue<bool>("enabled");
+            config->update([enabled](RuntimeConfig& c) { c.detection_enabled = enabled; });
+        } else if (command == "setConfidence") {
+            float threshold = static_cast<float>(json->getValue<double>("threshold"));
+            config->update([threshold](RuntimeConfig& c) { c.confidence_threshold = threshold; });
+        } else if (command == "setConfig") {
+            auto fields = json->getObject("config");
+            if (fields.isNull() || !config->applyJson(*fields, error)) {
+                changed = false;
+            }
+        } else if (command == "setStream") {
+            changed = false;
+            StreamFormat format = kFormatJson;
+            StreamTier tier = kTierFull;
+            if (!parseFormat(json->optValue<std::string>("format", "json"), format)
+                || !parseTier(json->optValue<std::string>("tier", "full"), tier)) {
+                error = "无效的格式或档位";
+            } else {
+                setStream(conn_id, format, tier);
+            }
+        } else if (command == "reportLatency") {
+            changed = false;
+            recordDisplayLatency(conn_id, json->getValue<int64_t>("display_latency_us"));
+        } else if (command == "getConfig") {
+            changed = false;
+            reactor_->send(conn_id, makeConfigMessage(), false);
+        } else {
+            changed = false;
+            error = "未知命令: " + command;
+        }
+    } catch (const Poco::Exception& e) {
+        changed = false;
+        error = e.displayText();
+    }
+
+    if (!error.empty()) {
+        std::cerr << "客户端命令执行失败: " << error << std::endl;
+    }
+    if (changed) {
+        // 通知所有客户端同步界面
+        broadcastText(makeConfigMessage(), false, false);
+    }
+}
+
+void WebServer::recordDisplayLatency(uint64_t conn_id, int64_t latency_us) {
+    display_latency_.record(latency_us);
+    std::lock_guard<std::mutex> lock(client_latency_mutex_);
+    auto& histogram = client_latency_[conn_id];
+    if (!histogram) histogram = std::make_unique<LatencyHistogram>();
+    histogram->record(latency_us);
+}
+
+void WebServer::setStream(uint64_t conn_id, StreamFormat format, StreamTier tier) {
+    if (format == kFormatH264 && !h264_[tier]) {
+        format = kFormatBinary;
+    }
+#ifdef USE_H264
+    if (format == kFormatH264) {
+        // 由推流器切换，保证先收到该档位的初始化段
+        h264_[tier]->attachViewer(conn_id);
+        return;
+    }
+#endif
+    reactor_->setStreamKey(conn_id, streamKey(format, tier));
+}
+
+void WebServer::broadcastText(std::shared_ptr<const std::string> message, bool droppable,
+                              bool detections_only) {
+    for (uint32_t tier = 0; tier < kTierCount; ++tier) {
+        for (uint32_t format = 0; format < kFormatCount; ++format) {
+            if (detections_only && format == kFormatBinary) continue;
+            reactor_->broadcast(message, false, droppable,
+                                streamKey(static_cast<StreamFormat>(format), static_cast<StreamTier>(tier)));
+        }
+    }
+}
+
+size_t WebServer::detectionSubscribers() const {
+    size_t count = 0;
+    for (uint32_t tier = 0; tier < kTierCount; ++tier) {
+        count += reactor_->subscriberCount(streamKey(kFormatJson, static_cast<StreamTier>(tier)));
+        count += reactor_->subscriberCount(streamKey(kFormatH264, static_cast<StreamTier>(tier)));
+    }
+    return count;
+}
+
+std::shared_ptr<const std::string> WebServer::makeConfigMessage() const {
+    Poco::JSON::Object json;
+    json.set("type", "config");
+    json.set("config", RuntimeConfigStore::toJson(*processor_->config()->requested()));
+    std::ostringstream ss;
+    json.stringify(ss);
+    return std::make_shared<const std::string>(ss.str());
+}
+
+CoroTask<void> WebServer::broadcastTask() {
+    auto mailbox = video_capture_->subscribe("broadcast", MailboxOptions{MailboxPolicy::kLatest});
+    for (;;) {
+        auto frame = co_await streaming_->receive(*mailbox);
+        if (!frame) break;
+
+        if (reactor_->connectionCount() == 0) continue;
+        broadcastFrame(kTierFull, frame);
+    }
+    mailbox->close();
+}
+
+void WebServer::broadcastFrame(StreamTier tier, const EncodedFramePtr& frame) {
+    auto age = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - frame->capture_time);
+    send_latency_.record(age.count());
+
+    // 消息体直接引用帧内的JPEG数据，帧信息和前缀写入帧内预留的缓冲，都随帧的引用计数释放，
+    // 不做拷贝也不另行分配；JSON格式的JPEG帧无处携带时延，之前先发一条帧信息文本消息
+    SharedBytes payload(frame, frame->jpeg.data(), frame->jpeg.size());
+    uint32_t json_key = streamKey(kFormatJson, tier);
+    if (reactor_->subscriberCount(json_key) > 0) {
+        char info[96];
+        int n = snprintf(info, sizeof(info), "{\"type\":\"frameInfo\",\"sequence\":%" PRIu64 ",\"age_us\":%" PRId64 "}",
+                         frame->sequence, static_cast<int64_t>(age.count()));
+        frame->info.assign(info, static_cast<size_t>(n));
+        reactor_->broadcast(SharedBytes(frame, frame->info.data(), frame->info.size()), false, true, json_key);
+    }
+    reactor_->broadcast(payload, true, true, json_key);
+
+    // 二进制格式：检测框作为前缀与JPEG合并为一条消息，前缀每帧只编码一次
+    uint32_t binary_key = streamKey(kFormatBinary, tier);
+    if (reactor_->subscriberCount(binary_key) > 0) {
+        std::shared_ptr<const DetectionSet> detections;
+        {
+            std::lock_guard<std::mutex> lock(detections_mutex_);
+            detections = latest_detections_;
+        }
+        FrameProtocol::encodePrefix(*frame, detections.get(), age, frame->prefix);
+        reactor_->broadcastPrefixed(SharedBytes(frame, frame->prefix.data(), frame->prefix.size()),
+                                    payload, binary_key);
+    }
+
+    if (tier == kTierFull) {
+        reactor_->broadcastMjpeg(std::move(payload));
+    }
+}
+
+CoroTask<void> WebServer::simulcastTask() {
+    RuntimeConfigReader config_reader(processor_->config());
+    auto mailbox = video_capture_->subscribe("simulcast", MailboxOptions{MailboxPolicy::kLatest});
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 90};
+    for (;;) {
+        auto frame = co_await streaming_->receive(*mailbox);
+        if (!frame) break;
+
+        // 原始分辨率的JPEG由捕获端编码，其余档位按订阅情况决定
+        bool jpeg_wanted[kTierCount] = {};
+        bool h264_wanted[kTierCount] = {};
+        int top = -1;
+        for (uint32_t tier = 0; tier < kTierCount; ++tier) {
+            auto t = static_cast<StreamTier>(tier);
+            jpeg_wanted[tier] = tier != kTierFull
+                && (reactor_->subscriberCount(streamKey(kFormatJson, t)) > 0
+                    || reactor_->subscriberCount(streamKey(kFormatBinary, t)) > 0);
+            h264_wanted[tier] = h264_[tier] && h264_[tier]->active();
+            if (jpeg_wanted[tier] || h264_wanted[tier]) top = static_cast<int>(tier);
+        }
+        if (top < 0) continue;
+
+        cv::Mat level = frame->image;
+        if (level.empty()) {
+            level = cv::imdecode(frame->jpeg, cv::IMREAD_COLOR);
+            if (level.empty()) continue;
+        }
+
+        params[1] = config_reader.get().jpeg_quality;
+        for (int tier = 0; tier <= top; ++tier) {
+            // 缩放结果直接写入该档位缓冲池预分配的图像，JPEG编码到槽位预留的缓冲
+            std::shared_ptr<EncodedFrame> scaled;
+            if (tier > 0) {
+                cv::Size size((level.cols + 1) / 2, (level.rows + 1) / 2);
+                auto pool = tier_pools_[tier];
+                if (!pool || tier_sizes_[tier] != size) {
+                    pool = FramePool::create(kTierPoolSlots, size.width, size.height,
+                                             static_cast<size_t>(size.area()));
+                    std::atomic_store(&tier_pools_[tier], pool);
+                    tier_sizes_[tier] = size;
+                }
+                scaled = pool->acquire();
+                cv::pyrDown(level, scaled->image, size);
+                level = scaled->image;
+            }
+            if (jpeg_wanted[tier]) {
+                cv::imencode(".jpg", level, scaled->jpeg, params);
+                scaled->sequence = frame->sequence;
+                scaled->width = level.cols;
+                scaled->height = level.rows;
+                scaled->wall_time = frame->wall_time;
+                scaled->capture_time = frame->capture_time;
+                scaled->device_sequence = frame->device_sequence;
+                broadcastFrame(static_cast<StreamTier>(tier), scaled);
+            }
+            if (h264_wanted[tier]) {
+                if (h264_[tier]->encode(level, *frame)) {
+                    send_latency_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - frame->capture_time).count());
+                } else {
+                    std::cerr << "H.264编码失败，档位" << tier << "停止推流" << std::endl;
+                }
+            }
+        }
+    }
+    mailbox->close();
+}
+
+CoroTask<void> WebServer::detectionTask() {
+    RuntimeConfigReader config_reader(processor_->config());
+    auto mailbox = video_capture_->subscribe("detection", MailboxOptions{MailboxPolicy::kLatest});
+    auto last_inference = std::chrono::steady_clock::time_point();
+    for (;;) {
+        // 推理帧率受限时挂起到下次推理时刻，间隔内到达的帧被信箱覆盖，醒来后取到的总是最新画面
+        const int inference_fps = config_reader.get().inference_fps;
+        if (inference_fps > 0) {
+            bool fired = co_await inference_->sleepUntil(
+                last_inference + std::chrono::microseconds(1000000 / inference_fps));
+            if (!fired) break;
+        }
+        auto frame = co_await inference_->receive(*mailbox);
+        if (!frame) break;
+
+        // 无WebSocket客户端且检测结果无人使用时不做推理
+        if (!events_ && !store_
+            && reactor_->connectionCount(StreamReactor::Protocol::WebSocket) == 0) continue;
+        last_inference = std::chrono::steady_clock::now();
+
+        try {
+            // 优先复用捕获端颜色转换后的图像，省去JPEG解码；带驱动缓冲的帧直接从驱动缓冲生成输入张量
+            cv::Mat img = frame->image;
+            if (img.empty()) {
+                img = cv::imdecode(frame->jpeg, cv::IMREAD_COLOR);
+            }
+            if (img.empty()) continue;
+
+            auto result = std::make_shared<DetectionSet>();
+            result->frame_sequence = frame->sequence;
+            result->frame_time = frame->wall_time;
+            result->detections = processor_->processFrame(img, frame->raw);
+            inference_latency_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - frame->capture_time).count());
+            {
+                std::lock_guard<std::mutex> lock(detections_mutex_);
+                latest_detections_ = result;
+            }
+            if (events_) {
+                events_->onDetections(*result);
+            }
+            if (store_) {
+                store_->append(camera_id_, *result);
+            }
+
+            // JSON和H.264格式的客户端单独接收检测结果文本帧
+            if (detectionSubscribers() == 0) continue;
+
+            Poco::JSON::Object json;
+            json.set("type", "detections");
+            json.set("sequence", frame->sequence);
+            Poco::JSON::Array dets;
+
+            for (const auto& det : result->detections) {
+                Poco::JSON::Object d;
+                d.set("label", det.label);
+                d.set("confidence", det.confidence);
+                d.set("x", det.bbox.x);
+                d.set("y", det.bbox.y);
+                d.set("width", det.bbox.width);
+                d.set("height", det.bbox.height);
+                dets.add(d);
+            }
+
+            json.set("detections", dets);
+            std::ostringstream ss;
+            json.stringify(ss);
+            broadcastText(std::make_shared<const std::string>(ss.str()), true, true);
+        } catch (const std::exception& e) {
+            std::cerr << "目标检测失败: " << e.what() << std::endl;
+        }
+    }
+    mailbox->close();
 } 
\ No newline at end of file